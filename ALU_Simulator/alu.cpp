@@ -33,7 +33,7 @@ void ALU::trace(Opcode op, uint32_t shift_amount) const{
     }
 
     std::cout<< " Result = 0x" << std::setw(8) << result;
-    std::cout<< " [Z = " << flag.Z <<" N = " << flag.N <<" C = " << flag.C<<" Z = " << flag.Z << "] " ;
+    std::cout<< " [Z = " << flag.Z <<" N = " << flag.N <<" C = " << flag.C<<" V = " << flag.V << "] " ;
     
     // Restore the old cout format
     std::cout.copyfmt(old_state); 
@@ -80,7 +80,7 @@ void ALU::step(Opcode op, uint32_t shift_amount){
             uint32_t signB = (B >> 31) & 1u;
             uint32_t signresult = (result >> 31) & 1u;
 
-            flag.Z = (signA == signB) && (signA != signresult);
+            flag.V = (signA == signB) && (signA != signresult);
 
             break;
         }
@@ -101,7 +101,8 @@ void ALU::step(Opcode op, uint32_t shift_amount){
             uint32_t signB = (B >> 31) & 1u;
             uint32_t signresult = (result >> 31) & 1u;
 
-            flag.Z = (signA == signB) && (signA != signresult);
+            // A - B overflows when the signs differ and the result's sign is not A's
+            flag.V = (signA != signB) && (signA != signresult);
 
             break;
 
@@ -119,9 +120,9 @@ void ALU::step(Opcode op, uint32_t shift_amount){
             break; 
         } 
         
-        case Opcode::XOR_: result = A ^ B;
-        case Opcode::OR_ : result = A | B;
-        case Opcode::AND_ : result = A & B;
+        case Opcode::XOR_: result = A ^ B; break;
+        case Opcode::OR_ : result = A | B; break;
+        case Opcode::AND_ : result = A & B; break;
 
         case Opcode::SHL : {
             shift_amount &= 31u; 
@@ -1,5 +1,6 @@
 #pragma once
 #include<cstdint>
+#include<cstddef>
 #include<string>
 
 // enum of flag
@@ -20,6 +21,27 @@ struct Flag{
 
 // why not class? becuase flags dont have any behaviour it is just a bundle of data variables. struct makes more sense here. and also not to worry about private and public.
 
+// Packed flags, one byte per operation (step_batch output) : N Z C V in bits 3..0, ARM NZCV order.
+enum : uint8_t{
+    FLAG_V = 1u << 0,
+    FLAG_C = 1u << 1,
+    FLAG_Z = 1u << 2,
+    FLAG_N = 1u << 3
+};
+
+inline uint8_t pack_flags(const Flag& f){
+    return (uint8_t)((f.N ? FLAG_N : 0) | (f.Z ? FLAG_Z : 0) | (f.C ? FLAG_C : 0) | (f.V ? FLAG_V : 0));
+}
+
+inline Flag unpack_flags(uint8_t nzcv){
+    Flag f;
+    f.N = (nzcv & FLAG_N) != 0;
+    f.Z = (nzcv & FLAG_Z) != 0;
+    f.C = (nzcv & FLAG_C) != 0;
+    f.V = (nzcv & FLAG_V) != 0;
+    return f;
+}
+
 
 // class for ALU
 class ALU{
@@ -40,6 +62,16 @@ public :
     // should be always enabled to help us log the results. and this happens in the step function at last.
     void step(Opcode op, uint32_t shift_amount = 0);
 
+    // Batched step (alu_batch.cpp) : the same operation on n operand pairs, no ALU state
+    // used or changed, no trace. result[i] and nzcv[i] (packed flags) are what step() would
+    // give for A[i], B[i], shift[i]. B or shift may be nullptr, read as all 0 (B is unused
+    // by SHL / SHR, shift by everything else). Output arrays must not overlap the inputs.
+    // AVX-512 or AVX2 kernels when the build enables them (-mavx512f / -mavx2, -march=native),
+    // a scalar loop otherwise; batch_isa() says which one was compiled in.
+    static void step_batch(Opcode op, const uint32_t* A, const uint32_t* B, const uint32_t* shift,
+                           uint32_t* result, uint8_t* nzcv, size_t n);
+    static const char* batch_isa();
+
 private :
 
 // Golden rule : everything you see outside the ALU put them in public as you need to interact with it. Put the rest of helper functions in the private section.
@@ -0,0 +1,229 @@
+#include "alu.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// ALU::step_batch : the flag rules of step() (see Readme "Flag semantics"), written
+// without branches so that 16 (AVX-512) or 8 (AVX2) operations go through at once.
+//
+//   ADD : C = carry out, i.e. r < A (unsigned)     V = sign of (A ^ r) & (B ^ r)
+//   SUB : C = no borrow, A >= B (unsigned)         V = sign of (A ^ B) & (A ^ r)
+//   MUL : C = high 32 bits of A * B (unsigned) != 0
+//         V = high 32 bits of A * B (signed) != sign extension of r
+//   SHL : C = bit 32 - s of A, SHR : bit s - 1 of A, 0 when s == 0 (s = shift & 31)
+//   Z / N from r for every operation, C / V stay 0 for AND / OR / XOR.
+
+// one operation, also the tail of the vector loops
+static inline uint8_t step_one(Opcode op, uint32_t a, uint32_t b, uint32_t s, uint32_t& r) {
+    bool c = false, v = false;
+    switch (op) {
+        case Opcode::ADD:
+            r = a + b;
+            c = r < a;
+            v = (((a ^ r) & (b ^ r)) >> 31) != 0;
+            break;
+        case Opcode::SUB:
+            r = a - b;
+            c = a >= b;
+            v = (((a ^ b) & (a ^ r)) >> 31) != 0;
+            break;
+        case Opcode::MUL: {
+            const uint64_t u = (uint64_t)a * (uint64_t)b;
+            const int64_t p = (int64_t)(int32_t)a * (int64_t)(int32_t)b;
+            r = (uint32_t)u;
+            c = (u >> 32) != 0;
+            v = p != (int64_t)(int32_t)r;
+            break;
+        }
+        case Opcode::AND_: r = a & b; break;
+        case Opcode::OR_:  r = a | b; break;
+        case Opcode::XOR_: r = a ^ b; break;
+        case Opcode::SHL:
+            s &= 31u;
+            r = a << s;
+            c = s != 0 && ((a >> (32 - s)) & 1u) != 0;
+            break;
+        case Opcode::SHR:
+            s &= 31u;
+            r = a >> s;
+            c = s != 0 && ((a >> (s - 1)) & 1u) != 0;
+            break;
+        default:
+            r = 0;
+            break;
+    }
+    return (uint8_t)((r >> 31 ? FLAG_N : 0) | (r == 0 ? FLAG_Z : 0) | (c ? FLAG_C : 0) | (v ? FLAG_V : 0));
+}
+
+#if defined(__AVX512F__)
+// GCC's plain forms of these intrinsics pass _mm512_undefined_epi32() (a self-initialised
+// variable) as the merge source, which -Wmaybe-uninitialized reports once they are inlined.
+// The maskz_ forms under a full mask are the same instructions with a zero source instead.
+static inline __m512i srli64(__m512i x, unsigned k)        { return _mm512_maskz_srli_epi64(0xFF, x, k); }
+static inline __m512i mul_epu32(__m512i x, __m512i y)      { return _mm512_maskz_mul_epu32(0xFF, x, y); }
+static inline __m512i mul_epi32(__m512i x, __m512i y)      { return _mm512_maskz_mul_epi32(0xFF, x, y); }
+static inline __m512i srai32(__m512i x, unsigned k)        { return _mm512_maskz_srai_epi32(0xFFFF, x, k); }
+static inline __m512i sllv32(__m512i x, __m512i count)     { return _mm512_maskz_sllv_epi32(0xFFFF, x, count); }
+static inline __m512i srlv32(__m512i x, __m512i count)     { return _mm512_maskz_srlv_epi32(0xFFFF, x, count); }
+static inline __m128i cvt_epi8(__m512i x)                  { return _mm512_maskz_cvtepi32_epi8(0xFFFF, x); }
+
+// 16 operations per iteration; flags are mask registers until the final pack (vpmovdb).
+// Returns how many were done (a multiple of 16).
+static size_t step_batch_simd(Opcode op, const uint32_t* A, const uint32_t* B, const uint32_t* S,
+                              uint32_t* R, uint8_t* F, size_t n) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i thirty_one = _mm512_set1_epi32(31);
+    const __m512i thirty_two = _mm512_set1_epi32(32);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512i a = _mm512_loadu_si512(A + i);
+        const __m512i b = B ? _mm512_loadu_si512(B + i) : zero;
+        const __m512i s = S ? _mm512_and_si512(_mm512_loadu_si512(S + i), thirty_one) : zero;
+        __m512i r = zero;
+        __mmask16 c = 0, v = 0;
+        switch (op) {
+            case Opcode::ADD:
+                r = _mm512_add_epi32(a, b);
+                c = _mm512_cmplt_epu32_mask(r, a);
+                v = _mm512_cmplt_epi32_mask(_mm512_and_si512(_mm512_xor_si512(a, r), _mm512_xor_si512(b, r)), zero);
+                break;
+            case Opcode::SUB:
+                r = _mm512_sub_epi32(a, b);
+                c = _mm512_cmpge_epu32_mask(a, b);
+                v = _mm512_cmplt_epi32_mask(_mm512_and_si512(_mm512_xor_si512(a, b), _mm512_xor_si512(a, r)), zero);
+                break;
+            case Opcode::MUL: {
+                r = _mm512_mullo_epi32(a, b);
+                // 64-bit products of the even lanes, then of the odd lanes moved down
+                const __m512i a_odd = srli64(a, 32), b_odd = srli64(b, 32);
+                const __m512i hi_u = _mm512_mask_blend_epi32(0xAAAA, srli64(mul_epu32(a, b), 32),
+                                                             mul_epu32(a_odd, b_odd));
+                const __m512i hi_s = _mm512_mask_blend_epi32(0xAAAA, srli64(mul_epi32(a, b), 32),
+                                                             mul_epi32(a_odd, b_odd));
+                c = _mm512_test_epi32_mask(hi_u, hi_u);
+                v = _mm512_cmpneq_epi32_mask(hi_s, srai32(r, 31));
+                break;
+            }
+            case Opcode::AND_: r = _mm512_and_si512(a, b); break;
+            case Opcode::OR_:  r = _mm512_or_si512(a, b); break;
+            case Opcode::XOR_: r = _mm512_xor_si512(a, b); break;
+            case Opcode::SHL:
+                r = sllv32(a, s);
+                c = _mm512_test_epi32_mask(srlv32(a, _mm512_sub_epi32(thirty_two, s)), one); // count 32 gives 0
+                break;
+            case Opcode::SHR:
+                r = srlv32(a, s);
+                c = _mm512_test_epi32_mask(srlv32(a, _mm512_sub_epi32(s, one)), one); // count -1 gives 0
+                break;
+            default:
+                break;
+        }
+        const __mmask16 z = _mm512_testn_epi32_mask(r, r);
+        const __mmask16 neg = _mm512_cmplt_epi32_mask(r, zero);
+        __m512i f = _mm512_maskz_mov_epi32(neg, _mm512_set1_epi32(FLAG_N));
+        f = _mm512_mask_or_epi32(f, z, f, _mm512_set1_epi32(FLAG_Z));
+        f = _mm512_mask_or_epi32(f, c, f, _mm512_set1_epi32(FLAG_C));
+        f = _mm512_mask_or_epi32(f, v, f, _mm512_set1_epi32(FLAG_V));
+        _mm512_storeu_si512(R + i, r);
+        _mm_storeu_si128((__m128i*)(F + i), cvt_epi8(f));
+    }
+    return i;
+}
+
+#elif defined(__AVX2__)
+// 8 operations per iteration; flags are all-ones / all-zeros lanes until the final pack.
+// AVX2 has no unsigned compare : both sides are flipped by 0x80000000 first.
+static size_t step_batch_simd(Opcode op, const uint32_t* A, const uint32_t* B, const uint32_t* S,
+                              uint32_t* R, uint8_t* F, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi32(-1);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i sign = _mm256_set1_epi32((int)0x80000000u);
+    const __m256i thirty_one = _mm256_set1_epi32(31);
+    const __m256i thirty_two = _mm256_set1_epi32(32);
+    // low byte of each lane to the bottom of its 128-bit half, then both halves together
+    const __m256i low_bytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i halves = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i a = _mm256_loadu_si256((const __m256i*)(A + i));
+        const __m256i b = B ? _mm256_loadu_si256((const __m256i*)(B + i)) : zero;
+        const __m256i s = S ? _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(S + i)), thirty_one) : zero;
+        __m256i r = zero, c = zero, v = zero;
+        switch (op) {
+            case Opcode::ADD:
+                r = _mm256_add_epi32(a, b);
+                c = _mm256_cmpgt_epi32(_mm256_xor_si256(a, sign), _mm256_xor_si256(r, sign));
+                v = _mm256_srai_epi32(_mm256_and_si256(_mm256_xor_si256(a, r), _mm256_xor_si256(b, r)), 31);
+                break;
+            case Opcode::SUB:
+                r = _mm256_sub_epi32(a, b);
+                c = _mm256_xor_si256(_mm256_cmpgt_epi32(_mm256_xor_si256(b, sign), _mm256_xor_si256(a, sign)), ones);
+                v = _mm256_srai_epi32(_mm256_and_si256(_mm256_xor_si256(a, b), _mm256_xor_si256(a, r)), 31);
+                break;
+            case Opcode::MUL: {
+                r = _mm256_mullo_epi32(a, b);
+                const __m256i a_odd = _mm256_srli_epi64(a, 32), b_odd = _mm256_srli_epi64(b, 32);
+                const __m256i hi_u = _mm256_blend_epi32(_mm256_srli_epi64(_mm256_mul_epu32(a, b), 32),
+                                                        _mm256_mul_epu32(a_odd, b_odd), 0xAA);
+                const __m256i hi_s = _mm256_blend_epi32(_mm256_srli_epi64(_mm256_mul_epi32(a, b), 32),
+                                                        _mm256_mul_epi32(a_odd, b_odd), 0xAA);
+                c = _mm256_xor_si256(_mm256_cmpeq_epi32(hi_u, zero), ones);
+                v = _mm256_xor_si256(_mm256_cmpeq_epi32(hi_s, _mm256_srai_epi32(r, 31)), ones);
+                break;
+            }
+            case Opcode::AND_: r = _mm256_and_si256(a, b); break;
+            case Opcode::OR_:  r = _mm256_or_si256(a, b); break;
+            case Opcode::XOR_: r = _mm256_xor_si256(a, b); break;
+            case Opcode::SHL:
+                r = _mm256_sllv_epi32(a, s);
+                c = _mm256_srlv_epi32(a, _mm256_sub_epi32(thirty_two, s)); // count 32 gives 0
+                c = _mm256_cmpeq_epi32(_mm256_and_si256(c, one), one);
+                break;
+            case Opcode::SHR:
+                r = _mm256_srlv_epi32(a, s);
+                c = _mm256_srlv_epi32(a, _mm256_sub_epi32(s, one));        // count -1 gives 0
+                c = _mm256_cmpeq_epi32(_mm256_and_si256(c, one), one);
+                break;
+            default:
+                break;
+        }
+        const __m256i z = _mm256_cmpeq_epi32(r, zero);
+        const __m256i neg = _mm256_srai_epi32(r, 31);
+        __m256i f = _mm256_and_si256(neg, _mm256_set1_epi32(FLAG_N));
+        f = _mm256_or_si256(f, _mm256_and_si256(z, _mm256_set1_epi32(FLAG_Z)));
+        f = _mm256_or_si256(f, _mm256_and_si256(c, _mm256_set1_epi32(FLAG_C)));
+        f = _mm256_or_si256(f, _mm256_and_si256(v, _mm256_set1_epi32(FLAG_V)));
+        f = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(f, low_bytes), halves);
+        _mm256_storeu_si256((__m256i*)(R + i), r);
+        _mm_storel_epi64((__m128i*)(F + i), _mm256_castsi256_si128(f));
+    }
+    return i;
+}
+
+#else
+static size_t step_batch_simd(Opcode, const uint32_t*, const uint32_t*, const uint32_t*,
+                              uint32_t*, uint8_t*, size_t) {
+    return 0;
+}
+#endif
+
+void ALU::step_batch(Opcode op, const uint32_t* A, const uint32_t* B, const uint32_t* shift,
+                     uint32_t* result, uint8_t* nzcv, size_t n) {
+    size_t i = step_batch_simd(op, A, B, shift, result, nzcv, n);
+    for (; i < n; i++)
+        nzcv[i] = step_one(op, A[i], B ? B[i] : 0, shift ? shift[i] : 0, result[i]);
+}
+
+const char* ALU::batch_isa() {
+#if defined(__AVX512F__)
+    return "avx512";
+#elif defined(__AVX2__)
+    return "avx2";
+#else
+    return "scalar";
+#endif
+}
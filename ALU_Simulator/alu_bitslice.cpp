@@ -0,0 +1,167 @@
+#include "alu_bitslice.h"
+
+// 2:1 multiplexer per instance : sel bit i set picks if_set for instance i
+static inline uint64_t mux(uint64_t sel, uint64_t if_set, uint64_t if_clear){
+    return (sel & if_set) | (~sel & if_clear);
+}
+
+// 32-bit ripple-carry adder, 64 instances wide : out = x + (invert_y ? ~y : y) + carry_in.
+// carry_msb is the carry into bit 31, carry_out the carry out of it (V = their XOR).
+static void ripple_add(const uint64_t* x, const uint64_t* y, bool invert_y, uint64_t carry_in,
+                       uint64_t* out, uint64_t& carry_msb, uint64_t& carry_out){
+    const uint64_t inv = invert_y ? ~0ull : 0ull;
+    uint64_t c = carry_in;
+    for(int j = 0; j < 32; j++){
+        const uint64_t xj = x[j]; // out may be x
+        const uint64_t yj = y[j] ^ inv;
+        const uint64_t s = xj ^ yj;
+        if(j == 31) carry_msb = c;
+        out[j] = s ^ c;
+        c = (xj & yj) | (c & s); // full adder carry : majority of x, y, c
+    }
+    carry_out = c;
+}
+
+void BitSliceALU::add(const Slice32& x, const Slice32& y, uint64_t carry_in){
+    // SUB comes in as x + ~y + 1 (carry_in all ones), so invert when carry_in is set
+    uint64_t carry_msb = 0, carry_out = 0;
+    ripple_add(x.bit.data(), y.bit.data(), carry_in != 0, carry_in, result.bit.data(), carry_msb, carry_out);
+    flag.C = carry_out;             // ADD : carry out, SUB : no borrow (A >= B)
+    flag.V = carry_msb ^ carry_out; // signed overflow
+}
+
+// Barrel shifter : 5 stages shifting by 1, 2, 4, 8, 16 where the instance's shift bit is set.
+// One extra bit above the word catches what leaves bit 31 : after the last stage it is
+// bit 32 - s of A, the SHL carry (0 when s == 0, nothing moved).
+void BitSliceALU::shift_left(){
+    uint64_t r[33];
+    for(int j = 0; j < 32; j++) r[j] = A.bit[j];
+    r[32] = 0;
+    for(int k = 0; k < 5; k++){
+        const uint64_t sel = shift_amount.bit[k];
+        const int d = 1 << k;
+        for(int j = 32; j >= 0; j--) // top down : r[j - d] is still the previous stage
+            r[j] = mux(sel, j >= d ? r[j - d] : 0, r[j]);
+    }
+    for(int j = 0; j < 32; j++) result.bit[j] = r[j];
+    flag.C = r[32];
+}
+
+// Same with the extra bit below the word : it ends as bit s - 1 of A, the SHR carry.
+void BitSliceALU::shift_right(){
+    uint64_t e[33]; // e[j + 1] = bit j
+    e[0] = 0;
+    for(int j = 0; j < 32; j++) e[j + 1] = A.bit[j];
+    for(int k = 0; k < 5; k++){
+        const uint64_t sel = shift_amount.bit[k];
+        const int d = 1 << k;
+        for(int j = 0; j <= 32; j++) // bottom up : e[j + d] is still the previous stage
+            e[j] = mux(sel, j + d <= 32 ? e[j + d] : 0, e[j]);
+    }
+    for(int j = 0; j < 32; j++) result.bit[j] = e[j + 1];
+    flag.C = e[0];
+}
+
+// Shift-and-add : 32 partial products A & B[i] added at bit i into a 64-bit product.
+// Before step i the product is below 2^(i+32), so each add carries into bit i + 32 only.
+void BitSliceALU::multiply(){
+    uint64_t p[64] = {};
+    for(int i = 0; i < 32; i++){
+        const uint64_t b = B.bit[i];
+        uint64_t c = 0;
+        for(int j = 0; j < 32; j++){
+            const uint64_t pp = A.bit[j] & b;
+            const uint64_t s = p[i + j] ^ pp;
+            const uint64_t nc = (p[i + j] & pp) | (c & s);
+            p[i + j] = s ^ c;
+            c = nc;
+        }
+        p[i + 32] = c;
+    }
+    for(int j = 0; j < 32; j++) result.bit[j] = p[j];
+
+    // C : unsigned high half != 0
+    uint64_t hi_any = 0;
+    for(int j = 32; j < 64; j++) hi_any |= p[j];
+    flag.C = hi_any;
+
+    // V : signed high half = unsigned high - (A < 0 ? B : 0) - (B < 0 ? A : 0);
+    // the product fits in int32 when that is the sign extension of result bit 31
+    const uint64_t a_neg = A.bit[31], b_neg = B.bit[31];
+    uint64_t t[32], hs[32], unused_msb, unused_out;
+    for(int j = 0; j < 32; j++) t[j] = B.bit[j] & a_neg;
+    ripple_add(p + 32, t, true, ~0ull, hs, unused_msb, unused_out);
+    for(int j = 0; j < 32; j++) t[j] = A.bit[j] & b_neg;
+    ripple_add(hs, t, true, ~0ull, hs, unused_msb, unused_out);
+    uint64_t v = 0;
+    for(int j = 0; j < 32; j++) v |= hs[j] ^ p[31];
+    flag.V = v;
+}
+
+void BitSliceALU::step(Opcode op){
+
+    flag = SliceFlags{};
+
+    switch(op){
+        case Opcode::ADD: add(A, B, 0); break;
+        case Opcode::SUB: add(A, B, ~0ull); break;
+        case Opcode::MUL: multiply(); break;
+
+        case Opcode::AND_: for(int j = 0; j < 32; j++) result.bit[j] = A.bit[j] & B.bit[j]; break;
+        case Opcode::OR_ : for(int j = 0; j < 32; j++) result.bit[j] = A.bit[j] | B.bit[j]; break;
+        case Opcode::XOR_: for(int j = 0; j < 32; j++) result.bit[j] = A.bit[j] ^ B.bit[j]; break;
+
+        case Opcode::SHL: shift_left(); break;
+        case Opcode::SHR: shift_right(); break;
+
+        default:
+            result = Slice32{};
+            break;
+    }
+
+    // Z : no result bit set, N : bit 31
+    uint64_t any = 0;
+    for(int j = 0; j < 32; j++) any |= result.bit[j];
+    flag.Z = ~any;
+    flag.N = result.bit[31];
+};
+
+// ---------------- transpose ----------------
+
+// 64 x 64 bit matrix transpose in place (Hacker's Delight 7-3) : 6 rounds of block swaps,
+// 32 x 32 blocks first, then 16 x 16 and so on. a[r] bit c <-> a[c] bit r.
+static void transpose64(uint64_t a[64]){
+    uint64_t m = 0x00000000FFFFFFFFull;
+    for(int j = 32; j != 0; j >>= 1, m ^= m << j){
+        for(int k = 0; k < 64; k = ((k | j) + 1) & ~j){
+            const uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k] ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+Slice32 to_slices(const uint32_t* values, size_t count){
+    uint64_t a[64] = {};
+    for(size_t i = 0; i < count && i < 64; i++) a[i] = values[i];
+    transpose64(a);
+    Slice32 s;
+    for(int j = 0; j < 32; j++) s.bit[j] = a[j];
+    return s;
+}
+
+void from_slices(const Slice32& s, uint32_t* values, size_t count){
+    uint64_t a[64] = {};
+    for(int j = 0; j < 32; j++) a[j] = s.bit[j];
+    transpose64(a);
+    for(size_t i = 0; i < count && i < 64; i++) values[i] = (uint32_t)a[i];
+}
+
+Flag lane_flags(const SliceFlags& f, unsigned lane){
+    Flag out;
+    out.N = (f.N >> lane) & 1u;
+    out.Z = (f.Z >> lane) & 1u;
+    out.C = (f.C >> lane) & 1u;
+    out.V = (f.V >> lane) & 1u;
+    return out;
+}
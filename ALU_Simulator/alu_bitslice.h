@@ -0,0 +1,57 @@
+#pragma once
+#include<array>
+#include<cstddef>
+#include<cstdint>
+#include "alu.h"
+
+// Bit-sliced ALU : 64 independent ALU instances evaluated at once.
+//
+// A Slice32 holds one 32-bit value for each of 64 instances, turned sideways :
+// bit[j] has bit j of every instance, instance i in bit position i. Every opcode is
+// then a gate-level circuit (ripple-carry adder, barrel shifter, shift-and-add multiplier)
+// where each AND / OR / XOR on a uint64_t is one gate for all 64 instances.
+// Results and flags are the same as ALU::step for each instance (see Readme "Flag semantics").
+//
+// Fault injection is a bit flip in a slice : bit[j] ^= 1ull << i changes bit j of instance i only.
+
+struct Slice32{
+    std::array<uint64_t, 32> bit{};
+};
+
+// one mask per flag, bit i : the flag of instance i
+struct SliceFlags{
+    uint64_t N = 0;
+    uint64_t Z = 0;
+    uint64_t C = 0;
+    uint64_t V = 0;
+};
+
+class BitSliceALU{
+
+public :
+
+    Slice32 A{};
+    Slice32 B{};
+    Slice32 shift_amount{}; // per instance, only bits 0..4 are used (masked to 0..31 like step)
+
+    Slice32 result{};
+    SliceFlags flag{};
+
+    // the same opcode for all 64 instances
+    void step(Opcode op);
+
+private :
+
+    void add(const Slice32& x, const Slice32& y, uint64_t carry_in); // result = x + y + carry_in, C, V
+    void shift_left();
+    void shift_right();
+    void multiply();
+};
+
+// ---------------- transpose helpers ----------------
+// Normal layout <-> slices, for up to 64 values (instance i = values[i]; missing instances are 0).
+Slice32 to_slices(const uint32_t* values, size_t count);
+void from_slices(const Slice32& s, uint32_t* values, size_t count);
+
+// flags of one instance
+Flag lane_flags(const SliceFlags& f, unsigned lane);
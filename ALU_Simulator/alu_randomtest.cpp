@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 #include <random>
+#include <vector>
 #include "alu.h"
+#include "alu_bitslice.h"
+#include "alu_width.h"
+#include "alu_verify.h"
 
 TEST(ALU_Random, AddAgainstGolden) {
     uint32_t seed = 12345;  // seed value
@@ -27,3 +31,140 @@ TEST(ALU_Random, AddAgainstGolden) {
         }
     }
 }
+
+// step_batch (SIMD kernels + scalar tail) against step(), every opcode.
+// A quarter of the operands are edge values; odd sizes exercise the tail.
+TEST(ALU_Random, BatchAgainstStep) {
+    uint32_t seed = 777;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> dist;
+    const uint32_t edge[] = {0, 1, 2, 31, 32, 0x7FFFFFFF, 0x80000000, 0x80000001, 0xFFFFFFFF, 0x10000};
+
+    const Opcode ops[] = {Opcode::ADD, Opcode::SUB, Opcode::MUL, Opcode::AND_,
+                          Opcode::OR_, Opcode::XOR_, Opcode::SHR, Opcode::SHL};
+    for (size_t n : {size_t(1), size_t(15), size_t(17), size_t(4099)}) {
+        std::vector<uint32_t> A(n), B(n), S(n), result(n);
+        std::vector<uint8_t> nzcv(n);
+        for (size_t i = 0; i < n; ++i) {
+            A[i] = (dist(rng) % 4 == 0) ? edge[dist(rng) % 10] : dist(rng);
+            B[i] = (dist(rng) % 4 == 0) ? edge[dist(rng) % 10] : dist(rng);
+            S[i] = dist(rng) % 40; // some above 31 : masked
+        }
+        for (Opcode op : ops) {
+            ALU::step_batch(op, A.data(), B.data(), S.data(), result.data(), nzcv.data(), n);
+
+            ALU alu;
+            alu.trace_enables = false;
+            for (size_t i = 0; i < n; ++i) {
+                alu.A = A[i];
+                alu.B = B[i];
+                alu.step(op, S[i]);
+                if (result[i] != alu.result || nzcv[i] != pack_flags(alu.flag)) {
+                    FAIL() << "Seed=" << seed << " isa=" << ALU::batch_isa() << " op=" << (int)op
+                           << " A=" << A[i] << " B=" << B[i] << " sh=" << S[i];
+                }
+            }
+        }
+    }
+}
+
+// BitSliceALU (64 instances per step) against step() on each instance, every opcode.
+TEST(ALU_Random, BitSliceAgainstStep) {
+    uint32_t seed = 4242;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> dist;
+    const uint32_t edge[] = {0, 1, 2, 31, 32, 0x7FFFFFFF, 0x80000000, 0x80000001, 0xFFFFFFFF, 0x10000};
+
+    const Opcode ops[] = {Opcode::ADD, Opcode::SUB, Opcode::MUL, Opcode::AND_,
+                          Opcode::OR_, Opcode::XOR_, Opcode::SHR, Opcode::SHL};
+    for (int round = 0; round < 200; ++round) {
+        uint32_t A[64], B[64], S[64], R[64];
+        for (int i = 0; i < 64; ++i) {
+            A[i] = (dist(rng) % 4 == 0) ? edge[dist(rng) % 10] : dist(rng);
+            B[i] = (dist(rng) % 4 == 0) ? edge[dist(rng) % 10] : dist(rng);
+            S[i] = dist(rng) % 40;
+        }
+        BitSliceALU sliced;
+        sliced.A = to_slices(A, 64);
+        sliced.B = to_slices(B, 64);
+        sliced.shift_amount = to_slices(S, 64);
+
+        for (Opcode op : ops) {
+            sliced.step(op);
+            from_slices(sliced.result, R, 64);
+
+            ALU alu;
+            alu.trace_enables = false;
+            for (unsigned i = 0; i < 64; ++i) {
+                alu.A = A[i];
+                alu.B = B[i];
+                alu.step(op, S[i]);
+                if (R[i] != alu.result || pack_flags(lane_flags(sliced.flag, i)) != pack_flags(alu.flag)) {
+                    FAIL() << "Seed=" << seed << " op=" << (int)op << " lane=" << i
+                           << " A=" << A[i] << " B=" << B[i] << " sh=" << S[i];
+                }
+            }
+        }
+    }
+}
+
+// ALUn<32> against step(), every opcode
+TEST(ALU_Random, Width32AgainstStep) {
+    uint32_t seed = 4242;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> dist;
+    const uint32_t edge[] = {0, 1, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 0xFFFF};
+    const Opcode ops[] = {Opcode::ADD, Opcode::SUB, Opcode::MUL, Opcode::AND_,
+                          Opcode::OR_, Opcode::XOR_, Opcode::SHL, Opcode::SHR};
+
+    ALU alu;
+    alu.trace_enables = false;
+    ALU32 w;
+    for (int i = 0; i < 20000; ++i) {
+        const uint32_t A = (i % 4 == 0) ? edge[dist(rng) % 6] : dist(rng);
+        const uint32_t B = (i % 4 == 1) ? edge[dist(rng) % 6] : dist(rng);
+        const uint32_t sh = dist(rng);
+        for (Opcode op : ops) {
+            alu.A = w.A = A;
+            alu.B = w.B = B;
+            alu.step(op, sh);
+            w.step(op, sh);
+            if (w.result != alu.result || pack_flags(w.flag) != pack_flags(alu.flag)) {
+                FAIL() << "Seed=" << seed << " op=" << (int)op << " A=" << A << " B=" << B << " sh=" << sh;
+            }
+        }
+    }
+}
+
+// verification engine : 8-bit exhaustive, every opcode sees its flags both ways
+TEST(ALU_Verify, Exhaustive8) {
+    const VerifyReport r = verify_exhaustive<8>(2);
+
+    EXPECT_EQ(r.mismatch_count(), 0u);
+    EXPECT_EQ(r.checks(), 6u * 65536u + 2u * 256u * 16u);
+    for (Opcode op : {Opcode::ADD, Opcode::SUB, Opcode::MUL}) {
+        const OpcodeCoverage& c = r.op[(int)op];
+        for (int f = 0; f < 4; f++) {
+            EXPECT_GT(c.flag_set[f], 0u) << "op " << (int)op << " flag " << f;
+            EXPECT_LT(c.flag_set[f], c.checks) << "op " << (int)op << " flag " << f;
+        }
+    }
+}
+
+// stratified 32-bit sampling reaches the flag boundaries, same report for any thread count
+TEST(ALU_Verify, Stratified32) {
+    const VerifyReport one = verify_stratified(60000, 1, 7);
+    const VerifyReport three = verify_stratified(60000, 3, 7);
+
+    EXPECT_EQ(one.mismatch_count(), 0u);
+    EXPECT_EQ(one.checks(), 8u * 60000u);
+    const OpcodeCoverage& sub = one.op[(int)Opcode::SUB];
+    EXPECT_GT(sub.flag_set[1], 1000u); // Z : B == A
+    EXPECT_GT(sub.flag_set[3], 1000u); // V
+    EXPECT_GT(one.op[(int)Opcode::MUL].flag_set[3], 1000u);
+    for (size_t k = 0; k < opcode_count; k++) {
+        EXPECT_EQ(one.op[k].nzcv_seen, three.op[k].nzcv_seen);
+        for (int f = 0; f < 4; f++) EXPECT_EQ(one.op[k].flag_set[f], three.op[k].flag_set[f]);
+    }
+    EXPECT_EQ(one.mismatches.size(), three.mismatches.size());
+}
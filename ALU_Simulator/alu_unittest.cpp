@@ -1,6 +1,7 @@
 #include <gtest/gtest.h> // Includes googletest framework
 // provides TEST, EXPECT_EQ, ASSERT_*, FAIL()
 #include "alu.h"
+#include "alu_width.h"
 
 TEST(ALU_Add, Basic) { 
     // Test - Googletest Macro
@@ -27,3 +28,114 @@ TEST(ALU_Add, Overflow) {
     EXPECT_TRUE(alu.flag.C);
     EXPECT_TRUE(alu.flag.Z);
 }
+
+TEST(ALU_Sub, SignedOverflow) {
+    ALU alu;
+    alu.trace_enables = false;
+    alu.A = 0x80000000; // INT32_MIN - 1
+    alu.B = 1;
+    alu.step(Opcode::SUB);
+
+    EXPECT_EQ(alu.result, 0x7FFFFFFFu);
+    EXPECT_TRUE(alu.flag.V);
+    EXPECT_TRUE(alu.flag.C); // no borrow
+    EXPECT_FALSE(alu.flag.Z);
+}
+
+TEST(ALU_Logic, NoFallThrough) {
+    ALU alu;
+    alu.trace_enables = false;
+    alu.A = 0xF0F0F0F0;
+    alu.B = 0x0FF00FF0;
+    alu.step(Opcode::XOR_);
+
+    EXPECT_EQ(alu.result, 0xFF00FF00u); // not A << 0 from the SHL case
+    EXPECT_TRUE(alu.flag.N);
+}
+
+TEST(ALU_Batch, PackedFlags) {
+    const uint32_t A[3] = {0xFFFFFFFF, 0x7FFFFFFF, 5};
+    const uint32_t B[3] = {1, 1, 7};
+    uint32_t result[3];
+    uint8_t nzcv[3];
+    ALU::step_batch(Opcode::ADD, A, B, nullptr, result, nzcv, 3);
+
+    EXPECT_EQ(result[0], 0u);
+    EXPECT_EQ(nzcv[0], FLAG_Z | FLAG_C);
+    EXPECT_EQ(result[1], 0x80000000u);
+    EXPECT_EQ(nzcv[1], FLAG_N | FLAG_V);
+    EXPECT_EQ(result[2], 12u);
+    EXPECT_EQ(nzcv[2], 0);
+}
+
+// ALUn<Width> folds at compile time
+static_assert(ALU8::eval(Opcode::ADD, 0xFF, 0x01).result == 0, "8-bit ADD wraps");
+static_assert(ALU8::eval(Opcode::ADD, 0xFF, 0x01).flag.C, "8-bit ADD carry");
+static_assert(ALU8::eval(Opcode::ADD, 0x7F, 0x01).flag.V, "8-bit ADD signed overflow");
+static_assert(ALU16::eval(Opcode::SUB, 0x8000, 1).flag.V, "16-bit SUB signed overflow");
+static_assert(ALU8::eval(Opcode::SHL, 0x81, 0, 9).result == 0x02, "shift amount masked to 0..7");
+static_assert(ALU32::eval(Opcode::MUL, 70000, 70000).flag.C, "32-bit MUL carry");
+#if defined(__SIZEOF_INT128__)
+static_assert(ALU64::eval(Opcode::MUL, 1ull << 32, 1ull << 32).flag.C, "64-bit MUL high half");
+#endif
+
+// every 8-bit operand pair against the flag rules in plain int arithmetic
+TEST(ALU_Width, Exhaustive8) {
+    auto s8 = [](int x) { return x >= 128 ? x - 256 : x; };
+    auto fits = [](int x) { return x >= -128 && x <= 127; };
+
+    for (int a = 0; a < 256; a++) {
+        for (int b = 0; b < 256; b++) {
+            const auto add = ALU8::eval(Opcode::ADD, (uint8_t)a, (uint8_t)b);
+            ASSERT_EQ(add.result, (a + b) & 0xFF);
+            ASSERT_EQ(add.flag.C, a + b > 0xFF);
+            ASSERT_EQ(add.flag.V, !fits(s8(a) + s8(b)));
+
+            const auto sub = ALU8::eval(Opcode::SUB, (uint8_t)a, (uint8_t)b);
+            ASSERT_EQ(sub.result, (a - b) & 0xFF);
+            ASSERT_EQ(sub.flag.C, a >= b);
+            ASSERT_EQ(sub.flag.V, !fits(s8(a) - s8(b)));
+
+            const auto mul = ALU8::eval(Opcode::MUL, (uint8_t)a, (uint8_t)b);
+            ASSERT_EQ(mul.result, (a * b) & 0xFF);
+            ASSERT_EQ(mul.flag.C, a * b > 0xFF);
+            ASSERT_EQ(mul.flag.V, !fits(s8(a) * s8(b)));
+            ASSERT_EQ(mul.flag.Z, ((a * b) & 0xFF) == 0);
+            ASSERT_EQ(mul.flag.N, ((a * b) & 0x80) != 0);
+
+            const auto x = ALU8::eval(Opcode::XOR_, (uint8_t)a, (uint8_t)b);
+            ASSERT_EQ(x.result, a ^ b);
+            ASSERT_FALSE(x.flag.C || x.flag.V);
+        }
+        for (unsigned sh = 0; sh < 16; sh++) {
+            const unsigned s = sh & 7;
+            const auto shl = ALU8::eval(Opcode::SHL, (uint8_t)a, 0, sh);
+            ASSERT_EQ(shl.result, (a << s) & 0xFF);
+            ASSERT_EQ(shl.flag.C, s != 0 && ((a >> (8 - s)) & 1));
+            const auto shr = ALU8::eval(Opcode::SHR, (uint8_t)a, 0, sh);
+            ASSERT_EQ(shr.result, a >> s);
+            ASSERT_EQ(shr.flag.C, s != 0 && ((a >> (s - 1)) & 1));
+        }
+    }
+}
+
+#if defined(__SIZEOF_INT128__)
+TEST(ALU_Width, Mul64) {
+    ALU64 alu;
+    alu.A = 0xFFFFFFFFFFFFFFFFull; // -1
+    alu.B = 0x8000000000000000ull; // INT64_MIN
+    alu.step(Opcode::MUL);
+
+    EXPECT_EQ(alu.result, 0x8000000000000000ull);
+    EXPECT_TRUE(alu.flag.C);  // unsigned product needs 128 bits
+    EXPECT_TRUE(alu.flag.V);  // -INT64_MIN does not fit
+    EXPECT_TRUE(alu.flag.N);
+
+    alu.A = 0xFFFFFFFFFFFFFFFFull; // -1
+    alu.B = 5;
+    alu.step(Opcode::MUL);
+    EXPECT_EQ(alu.result, (uint64_t)-5);
+    EXPECT_TRUE(alu.flag.C);
+    EXPECT_FALSE(alu.flag.V); // -5 fits
+}
+#endif
@@ -0,0 +1,348 @@
+#include "alu_verify.h"
+#include "alu_width.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+const Opcode binary_ops[] = {Opcode::ADD, Opcode::SUB, Opcode::MUL, Opcode::AND_, Opcode::OR_, Opcode::XOR_};
+const Opcode shift_ops[] = {Opcode::SHL, Opcode::SHR};
+const Opcode all_ops[opcode_count] = {Opcode::ADD, Opcode::SUB, Opcode::MUL, Opcode::AND_,
+                                      Opcode::OR_, Opcode::XOR_, Opcode::SHR, Opcode::SHL};
+
+constexpr size_t max_reported = 16; // mismatches kept per report
+constexpr size_t chunk_lanes = 1u << 14;
+
+const char* name_of(Opcode op){
+    switch(op){
+        case Opcode::ADD  : return "ADD";
+        case Opcode::SUB  : return "SUB";
+        case Opcode::MUL  : return "MUL";
+        case Opcode::AND_ : return "AND";
+        case Opcode::OR_  : return "OR";
+        case Opcode::XOR_ : return "XOR";
+        case Opcode::SHL  : return "SHL";
+        case Opcode::SHR  : return "SHR";
+        default:            return "???";
+    }
+}
+
+// per-thread buffers, one lane per check
+struct Lanes{
+    std::vector<uint32_t> A, B, shift;        // operands as the DUT sees them
+    std::vector<uint32_t> gA, gB, gshift;     // operands as the golden model sees them
+    std::vector<uint32_t> raw, raw2;          // step_batch results
+    std::vector<uint8_t> raw_nzcv, raw2_nzcv;
+    std::vector<uint32_t> golden;
+    std::vector<uint8_t> golden_nzcv;
+
+    void resize(size_t n){
+        for(auto* v : {&A, &B, &shift, &gA, &gB, &gshift, &raw, &raw2, &golden}) v->resize(n);
+        for(auto* v : {&raw_nzcv, &raw2_nzcv, &golden_nzcv}) v->resize(n);
+    }
+};
+
+inline void tally(VerifyReport& r, Opcode op, uint32_t A, uint32_t B, uint32_t shift,
+                  uint32_t result, uint8_t nzcv, uint32_t golden, uint8_t golden_nzcv){
+    OpcodeCoverage& c = r.op[(int)op];
+    c.checks++;
+    c.flag_set[0] += (golden_nzcv & FLAG_N) != 0;
+    c.flag_set[1] += (golden_nzcv & FLAG_Z) != 0;
+    c.flag_set[2] += (golden_nzcv & FLAG_C) != 0;
+    c.flag_set[3] += (golden_nzcv & FLAG_V) != 0;
+    c.nzcv_seen |= (uint16_t)(1u << golden_nzcv);
+    if(result != golden || nzcv != golden_nzcv){
+        c.mismatches++;
+        if(r.mismatches.size() < max_reported)
+            r.mismatches.push_back({op, A, B, shift, result, golden, nzcv, golden_nzcv});
+    }
+}
+
+void merge(VerifyReport& into, const VerifyReport& from){
+    for(size_t k = 0; k < opcode_count; k++){
+        OpcodeCoverage& a = into.op[k];
+        const OpcodeCoverage& b = from.op[k];
+        a.checks += b.checks;
+        a.mismatches += b.mismatches;
+        for(int f = 0; f < 4; f++) a.flag_set[f] += b.flag_set[f];
+        a.nzcv_seen |= b.nzcv_seen;
+    }
+    for(const Mismatch& m : from.mismatches)
+        if(into.mismatches.size() < max_reported) into.mismatches.push_back(m);
+}
+
+// Runs work(chunk, report, lanes) for chunk = 0 .. chunks - 1 on the worker threads, each
+// taking the next chunk as it frees up, and merges the per-thread reports. Mismatches are
+// kept per chunk and merged in chunk order, so the list does not depend on the scheduling.
+template<typename Work>
+void run_parallel(VerifyReport& report, unsigned threads, size_t chunks, Work work){
+    if(threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned)std::max<size_t>(1, std::min<size_t>(threads, chunks));
+    report.threads = threads;
+
+    std::atomic<size_t> next{0};
+    std::vector<VerifyReport> local(threads);
+    std::vector<std::vector<Mismatch>> found(chunks);
+    auto worker = [&](unsigned t){
+        Lanes lanes;
+        for(size_t c; (c = next.fetch_add(1)) < chunks;){
+            work(c, local[t], lanes);
+            found[c].swap(local[t].mismatches); // local[t].mismatches is empty again
+        }
+    };
+
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for(unsigned t = 1; t < threads; t++) pool.emplace_back(worker, t);
+    worker(0);
+    for(std::thread& th : pool) th.join();
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    for(const VerifyReport& r : local) merge(report, r);
+    for(const std::vector<Mismatch>& f : found)
+        for(const Mismatch& m : f)
+            if(report.mismatches.size() < max_reported) report.mismatches.push_back(m);
+}
+
+// ---------------- exhaustive, reduced width ----------------
+
+// Golden results for n Width-bit checks from 32-bit step_batch lanes (see alu_verify.h).
+template<unsigned Width>
+void golden_narrow(Opcode op, Lanes& L, size_t n){
+    constexpr unsigned k = 32 - Width; // lift : operand << k
+    constexpr uint32_t mask = (1u << Width) - 1;
+    constexpr uint32_t msb = 1u << (Width - 1);
+    auto sext = [](uint32_t x){ return (int32_t)(x << k) >> k; };
+
+    if(op == Opcode::MUL){
+        // unsigned and signed products both fit in 32 bits : C and V from the full product
+        for(size_t i = 0; i < n; i++){
+            L.gA[i] = (uint32_t)sext(L.A[i]);
+            L.gB[i] = (uint32_t)sext(L.B[i]);
+        }
+        ALU::step_batch(op, L.A.data(), L.B.data(), nullptr, L.raw.data(), L.raw_nzcv.data(), n);
+        ALU::step_batch(op, L.gA.data(), L.gB.data(), nullptr, L.raw2.data(), L.raw2_nzcv.data(), n);
+        for(size_t i = 0; i < n; i++){
+            const uint32_t r = L.raw[i] & mask;
+            Flag f;
+            f.C = (L.raw[i] >> Width) != 0;
+            f.V = (int32_t)L.raw2[i] != sext(r);
+            f.N = (r & msb) != 0;
+            f.Z = r == 0;
+            L.golden[i] = r;
+            L.golden_nzcv[i] = pack_flags(f);
+        }
+        return;
+    }
+
+    for(size_t i = 0; i < n; i++){
+        L.gA[i] = L.A[i] << k;
+        L.gB[i] = L.B[i] << k;
+        L.gshift[i] = L.shift[i] & (Width - 1); // the narrow ALU's masking
+    }
+    ALU::step_batch(op, L.gA.data(), L.gB.data(), L.gshift.data(), L.raw.data(), L.raw_nzcv.data(), n);
+
+    if(op == Opcode::SHR){
+        // the last bit shifted out sits just below the lifted result
+        for(size_t i = 0; i < n; i++){
+            const uint32_t r = L.raw[i] >> k;
+            Flag f;
+            f.C = ((L.raw[i] >> (k - 1)) & 1u) != 0;
+            f.N = (r & msb) != 0;
+            f.Z = r == 0;
+            L.golden[i] = r;
+            L.golden_nzcv[i] = pack_flags(f);
+        }
+        return;
+    }
+
+    // ADD SUB AND OR XOR SHL : the low k bits stay 0, the 32-bit flags are the narrow ones
+    for(size_t i = 0; i < n; i++){
+        L.golden[i] = L.raw[i] >> k;
+        L.golden_nzcv[i] = L.raw_nzcv[i];
+    }
+}
+
+// ---------------- stratified, 32 bits ----------------
+
+enum Stratum{ UNIFORM, EDGE, NEAR_EQUAL, CARRY_EDGE, SIGNED_EDGE, MUL_EDGE, stratum_count };
+
+uint32_t edge_value(std::mt19937& rng){
+    static const uint32_t base[] = {0, 1, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 0x0000FFFF, 0x00010000};
+    const uint32_t d = rng() % 5 - 2; // -2 .. 2
+    switch(rng() % 3){
+        case 0 : return base[rng() % 7] + d;
+        case 1 : return (1u << (rng() % 32)) + d;
+        default: return 0u - (1u << (rng() % 32));
+    }
+}
+
+// random bit length, so small and large magnitudes are equally likely
+uint32_t magnitude(std::mt19937& rng){
+    return rng() >> (rng() % 32);
+}
+
+void sample(Stratum s, std::mt19937& rng, uint32_t& A, uint32_t& B, uint32_t& shift){
+    const uint32_t d = rng() % 5 - 2;
+    switch(s){
+        case UNIFORM     : A = rng(); B = rng(); break;
+        case EDGE        : A = edge_value(rng); B = edge_value(rng); break;
+        case NEAR_EQUAL  : A = (rng() & 1) ? rng() : edge_value(rng); B = A + d; break;
+        case CARRY_EDGE  : A = (rng() & 1) ? rng() : magnitude(rng); B = 0u - A + d; break;
+        case SIGNED_EDGE :
+            A = rng();
+            B = (rng() & 1) ? 0x80000000u - A + d   // ADD : A + B ~ 2^31
+                            : A - 0x80000000u + d;  // SUB : A - B ~ 2^31
+            break;
+        case MUL_EDGE : {
+            A = std::max(1u, magnitude(rng));
+            B = ((rng() & 1) ? 0xFFFFFFFFu / A : 0x7FFFFFFFu / A) + d; // product ~ 2^32 or ~ 2^31
+            if(rng() & 1) A = 0u - A; // negative products too
+            break;
+        }
+        default: A = B = 0; break;
+    }
+    static const uint32_t edge_shift[] = {0, 1, 31, 32, 33, 63};
+    shift = (rng() & 1) ? edge_shift[rng() % 6] : rng();
+}
+
+} // namespace
+
+uint64_t VerifyReport::checks() const{
+    uint64_t n = 0;
+    for(const OpcodeCoverage& c : op) n += c.checks;
+    return n;
+}
+
+uint64_t VerifyReport::mismatch_count() const{
+    uint64_t n = 0;
+    for(const OpcodeCoverage& c : op) n += c.mismatches;
+    return n;
+}
+
+double VerifyReport::checks_per_second() const{
+    return seconds > 0 ? checks() / seconds : 0;
+}
+
+template<unsigned Width>
+VerifyReport verify_exhaustive(unsigned threads, uint32_t a_begin, uint32_t a_end){
+    static_assert(Width >= 2 && Width <= 16, "checks are lifted onto 32-bit lanes");
+    using Narrow = ALUn<Width>;
+    using word = typename Narrow::word;
+    constexpr uint32_t values = 1u << Width;
+    if(a_begin > a_end || a_end > values) throw std::invalid_argument("verify_exhaustive: A range out of range");
+
+    // whole rows of B per chunk, at least chunk_lanes lanes
+    const uint32_t rows = std::max<uint32_t>(1, (uint32_t)(chunk_lanes >> Width));
+    const size_t chunks = (a_end - a_begin + rows - 1) / rows;
+
+    VerifyReport report;
+    report.mode = "exhaustive";
+    report.width = Width;
+    run_parallel(report, threads, chunks, [&](size_t c, VerifyReport& r, Lanes& L){
+        const uint32_t a0 = a_begin + (uint32_t)c * rows;
+        const uint32_t a1 = std::min(a0 + rows, a_end);
+
+        size_t n = (size_t)(a1 - a0) << Width;
+        L.resize(n);
+        for(size_t i = 0; i < n; i++){
+            L.A[i] = a0 + (uint32_t)(i >> Width);
+            L.B[i] = (uint32_t)i & (values - 1);
+            L.shift[i] = 0;
+        }
+        for(Opcode op : binary_ops){
+            golden_narrow<Width>(op, L, n);
+            for(size_t i = 0; i < n; i++){
+                const auto out = Narrow::eval(op, (word)L.A[i], (word)L.B[i]);
+                tally(r, op, L.A[i], L.B[i], 0, out.result, pack_flags(out.flag), L.golden[i], L.golden_nzcv[i]);
+            }
+        }
+
+        n = (size_t)(a1 - a0) * 2 * Width;
+        for(size_t i = 0; i < n; i++){
+            L.A[i] = a0 + (uint32_t)(i / (2 * Width));
+            L.B[i] = 0;
+            L.shift[i] = (uint32_t)(i % (2 * Width));
+        }
+        for(Opcode op : shift_ops){
+            golden_narrow<Width>(op, L, n);
+            for(size_t i = 0; i < n; i++){
+                const auto out = Narrow::eval(op, (word)L.A[i], 0, L.shift[i]);
+                tally(r, op, L.A[i], 0, L.shift[i], out.result, pack_flags(out.flag), L.golden[i], L.golden_nzcv[i]);
+            }
+        }
+    });
+    return report;
+}
+
+template VerifyReport verify_exhaustive<8>(unsigned, uint32_t, uint32_t);
+template VerifyReport verify_exhaustive<16>(unsigned, uint32_t, uint32_t);
+
+VerifyReport verify_stratified(uint64_t samples_per_opcode, unsigned threads, uint32_t seed){
+    const size_t per_op = (size_t)((samples_per_opcode + chunk_lanes - 1) / chunk_lanes);
+    const size_t chunks = per_op * opcode_count;
+
+    VerifyReport report;
+    report.mode = "stratified";
+    report.width = 32;
+    run_parallel(report, threads, chunks, [&](size_t c, VerifyReport& r, Lanes& L){
+        const Opcode op = all_ops[c % opcode_count];
+        const uint64_t first = (uint64_t)(c / opcode_count) * chunk_lanes;
+        const size_t n = (size_t)std::min<uint64_t>(chunk_lanes, samples_per_opcode - first);
+
+        std::seed_seq seq{seed, (uint32_t)c};
+        std::mt19937 rng(seq);
+        L.resize(n);
+        for(size_t i = 0; i < n; i++)
+            sample((Stratum)((first + i) % stratum_count), rng, L.A[i], L.B[i], L.shift[i]);
+
+        ALU::step_batch(op, L.A.data(), L.B.data(), L.shift.data(), L.golden.data(), L.golden_nzcv.data(), n);
+
+        ALU alu;
+        alu.trace_enables = false;
+        for(size_t i = 0; i < n; i++){
+            alu.A = L.A[i];
+            alu.B = L.B[i];
+            alu.step(op, L.shift[i]);
+            tally(r, op, L.A[i], L.B[i], L.shift[i], alu.result, pack_flags(alu.flag), L.golden[i], L.golden_nzcv[i]);
+        }
+    });
+    return report;
+}
+
+void print_report(std::ostream& os, const VerifyReport& r){
+    std::ios old_state(nullptr);
+    old_state.copyfmt(os);
+
+    os << "ALU verification : " << r.mode << ", " << r.width << "-bit, " << r.threads << " thread(s), golden step_batch ("
+       << ALU::batch_isa() << ")\n";
+    os << "  op        checks  mismatch           N           Z           C           V  NZCV seen\n";
+    for(Opcode op : all_ops){
+        const OpcodeCoverage& c = r.op[(int)op];
+        if(c.checks == 0) continue;
+        int combos = 0;
+        for(uint16_t m = c.nzcv_seen; m; m &= (uint16_t)(m - 1)) combos++;
+        os << "  " << std::left << std::setw(4) << name_of(op) << std::right
+           << std::setw(12) << c.checks << std::setw(10) << c.mismatches;
+        for(uint64_t f : c.flag_set) os << std::setw(12) << f;
+        os << std::setw(8) << combos << "/16\n";
+    }
+    os << "  " << r.checks() << " checks, " << r.mismatch_count() << " mismatches in " << std::fixed
+       << std::setprecision(3) << r.seconds << " s : " << std::setprecision(1) << r.checks_per_second() / 1e6
+       << " M checks/s\n";
+
+    os << std::hex << std::setfill('0');
+    for(const Mismatch& m : r.mismatches){
+        os << "  MISMATCH " << name_of(m.op) << " A = 0x" << std::setw(8) << m.A << " B = 0x" << std::setw(8) << m.B
+           << std::dec << " sh = " << m.shift << std::hex
+           << " : 0x" << std::setw(8) << m.result << " nzcv " << std::setw(1) << (unsigned)m.nzcv
+           << ", golden 0x" << std::setw(8) << m.golden_result << " nzcv " << std::setw(1) << (unsigned)m.golden_nzcv << "\n";
+    }
+    os.copyfmt(old_state);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include<cstddef>
+#include<cstdint>
+#include<iosfwd>
+#include<vector>
+#include "alu.h"
+
+// Verification engine : the scalar ALUs checked against step_batch (the vectorized golden
+// model), spread over std::thread workers. Two modes :
+//
+// verify_exhaustive<Width>  every A, B pair of ALUn<Width> (8 or 16 bits) for ADD SUB MUL AND OR XOR,
+//                           every A with shift 0 .. 2 Width - 1 for SHL SHR (masking included).
+//                           The golden side lifts each narrow check onto one 32-bit lane :
+//                           operands in the top Width bits, so carry, borrow, signed overflow, N and Z
+//                           come out of the 32-bit flags unchanged (MUL and SHR are rebuilt from
+//                           the full 32-bit product / the bit below the result).
+//
+// verify_stratified         ALU::step over sampled 32-bit operands, spread evenly over strata that
+//                           sit on flag boundaries : uniform, edge values, B ~ A (SUB zero / borrow),
+//                           A + B ~ 2^32 (carry), A +- B ~ 2^31 (signed overflow), products ~ 2^32
+//                           and ~ 2^31 (MUL C / V); half the shift amounts are 0, 1, 31, 32, 33, 63.
+//
+// Work is cut into fixed chunks with their own seed, and mismatches are listed in chunk order,
+// so a run gives the same report for any thread count. threads = 0 : std::thread::hardware_concurrency().
+
+constexpr size_t opcode_count = 8; // Opcode::ADD .. Opcode::SHL
+
+struct OpcodeCoverage{
+    uint64_t checks = 0;
+    uint64_t mismatches = 0;
+    uint64_t flag_set[4] = {}; // how often N, Z, C, V came out set (golden)
+    uint16_t nzcv_seen = 0;    // bit k : packed flags value k seen (golden)
+};
+
+struct Mismatch{
+    Opcode op;
+    uint32_t A, B, shift;
+    uint32_t result, golden_result;
+    uint8_t nzcv, golden_nzcv;
+};
+
+struct VerifyReport{
+    const char* mode = "";
+    unsigned width = 32;
+    unsigned threads = 1;
+    OpcodeCoverage op[opcode_count]; // indexed by (int)Opcode
+    std::vector<Mismatch> mismatches; // the first few only
+    double seconds = 0;
+
+    uint64_t checks() const;
+    uint64_t mismatch_count() const;
+    double checks_per_second() const;
+};
+
+// Width 8 or 16; A limited to a_begin .. a_end - 1 (B always exhaustive) to split a 16-bit run.
+// Throws std::invalid_argument if the range is outside 0 .. 2^Width.
+template<unsigned Width>
+VerifyReport verify_exhaustive(unsigned threads = 0, uint32_t a_begin = 0, uint32_t a_end = 1u << Width);
+
+VerifyReport verify_stratified(uint64_t samples_per_opcode, unsigned threads = 0, uint32_t seed = 1);
+
+// per-opcode table : checks, mismatches, flag counts, NZCV combinations seen; then checks/s
+void print_report(std::ostream& os, const VerifyReport& r);
@@ -0,0 +1,155 @@
+#pragma once
+#include<cstdint>
+#include "alu.h" // Opcode, Flag
+
+// Width-templated ALU : the same opcodes and flag rules as ALU (see Readme "Flag semantics")
+// for 8, 16, 32 or 64-bit operands. Header only, everything constexpr, so a step on
+// constant operands folds at compile time :
+//
+//     constexpr auto r = ALUn<8>::eval(Opcode::ADD, 0xFF, 0x01);   // r.result == 0, r.flag.C
+//
+// Sizes follow the width :
+//     shift amount masked to Width - 1 (0..7 for 8 bits, 0..63 for 64 bits)
+//     N = bit Width - 1, V = result outside the signed Width-bit range
+// ALUn<32> gives exactly what ALU::step gives (no trace, no step_batch).
+
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 alu_uint128;
+__extension__ typedef __int128 alu_int128;
+#endif
+
+// Per width : the word, its signed form, and the double-width type that holds the
+// carry out of ADD / SUB and the full MUL product.
+template<unsigned Width> struct ALUWord;
+
+template<> struct ALUWord<8>{
+    using word = uint8_t;
+    using signed_word = int8_t;
+    using wide = uint16_t;
+    using signed_wide = int16_t;
+};
+
+template<> struct ALUWord<16>{
+    using word = uint16_t;
+    using signed_word = int16_t;
+    using wide = uint32_t;
+    using signed_wide = int32_t;
+};
+
+template<> struct ALUWord<32>{
+    using word = uint32_t;
+    using signed_word = int32_t;
+    using wide = uint64_t;
+    using signed_wide = int64_t;
+};
+
+#if defined(__SIZEOF_INT128__)
+template<> struct ALUWord<64>{
+    using word = uint64_t;
+    using signed_word = int64_t;
+    using wide = alu_uint128; // 128-bit product for MUL
+    using signed_wide = alu_int128;
+};
+#endif
+
+template<unsigned Width>
+class ALUn{
+
+public :
+
+    using word = typename ALUWord<Width>::word;
+
+    static constexpr unsigned width = Width;
+    static constexpr word msb = (word)((word)1 << (Width - 1));
+
+    struct Output{
+        word result = 0;
+        Flag flag{};
+    };
+
+    word A = 0;
+    word B = 0;
+
+    word result = 0;
+    Flag flag{};
+
+    // same contract as ALU::step, without the trace
+    constexpr void step(Opcode op, unsigned shift_amount = 0){
+        const Output out = eval(op, A, B, shift_amount);
+        result = out.result;
+        flag = out.flag;
+    }
+
+    // pure form : no state, usable in constant expressions
+    static constexpr Output eval(Opcode op, word A, word B, unsigned shift_amount = 0){
+        using wide = typename ALUWord<Width>::wide;
+        using signed_word = typename ALUWord<Width>::signed_word;
+        using signed_wide = typename ALUWord<Width>::signed_wide;
+
+        Output out;
+        const bool signA = (A & msb) != 0;
+        const bool signB = (B & msb) != 0;
+
+        switch(op){
+            case Opcode::ADD: {
+                const wide temp = (wide)((wide)A + (wide)B);
+                out.result = (word)temp;
+                out.flag.C = ((temp >> Width) & 1u) != 0;
+                const bool signR = (out.result & msb) != 0;
+                out.flag.V = (signA == signB) && (signA != signR);
+                break;
+            }
+
+            case Opcode::SUB: {
+                out.result = (word)(A - B);
+                out.flag.C = (A >= B); // no borrow
+                const bool signR = (out.result & msb) != 0;
+                out.flag.V = (signA != signB) && (signA != signR);
+                break;
+            }
+
+            case Opcode::MUL: {
+                const wide temp = (wide)((wide)A * (wide)B);
+                out.result = (word)temp;
+                out.flag.C = (temp >> Width) != 0;
+                // signed product in the double-width type : |product| <= 2^(2 Width - 2), never overflows
+                const signed_wide flow = (signed_wide)((signed_wide)(signed_word)A * (signed_wide)(signed_word)B);
+                out.flag.V = flow != (signed_wide)(signed_word)out.result;
+                break;
+            }
+
+            case Opcode::XOR_: out.result = (word)(A ^ B); break;
+            case Opcode::OR_ : out.result = (word)(A | B); break;
+            case Opcode::AND_: out.result = (word)(A & B); break;
+
+            case Opcode::SHL: {
+                shift_amount &= Width - 1;
+                out.result = (word)(A << shift_amount);
+                out.flag.C = (shift_amount == 0) ? false : ((A >> (Width - shift_amount)) & 1u) != 0;
+                break;
+            }
+
+            case Opcode::SHR: {
+                shift_amount &= Width - 1;
+                out.result = (word)(A >> shift_amount);
+                out.flag.C = (shift_amount == 0) ? false : ((A >> (shift_amount - 1)) & 1u) != 0;
+                break;
+            }
+
+            default:
+                out.result = 0;
+                break;
+        }
+
+        out.flag.Z = (out.result == 0);
+        out.flag.N = (out.result & msb) != 0;
+        return out;
+    }
+};
+
+using ALU8  = ALUn<8>;
+using ALU16 = ALUn<16>;
+using ALU32 = ALUn<32>;
+#if defined(__SIZEOF_INT128__)
+using ALU64 = ALUn<64>;
+#endif
@@ -1,18 +1,188 @@
 #pragma once // this tells the preprocessor to ignore this header if it is already included
-#include<cstdint> 
+#include<cstdint>
+#include<cassert>
 
-// unit32_t has fixed 32 bit 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// unit32_t has fixed 32 bit
 // unsigned as bits depended on the platform
 // both represents the same, use undigned when you are just counting or dont care about the bits
 
-uint32_t get_bits(uint32_t x, unsigned hi, unsigned lo); // t means type
-
-uint32_t set_bits(uint32_t x, unsigned hi, unsigned lo, uint32_t value);
+// get_bits / set_bits / sign_extend are inline (below) : instruction decoders call them per fetch
 
 uint32_t rotr32(uint32_t x,unsigned n);
 
 uint32_t rotl32(uint32_t x,unsigned n);
 
-int32_t sign_extend(uint32_t x, unsigned nbits);
 
+// ---------------- Bit fields ----------------
+
+inline uint32_t get_bits(uint32_t x, unsigned hi, unsigned lo){ // t means type
+
+    assert(lo <= hi);
+    assert(hi < 32);
+    // lo is unsigned type it starts with 0 so we dont need to add assert(lo >= 0)
+
+    unsigned width = hi - lo + 1;
+
+    uint32_t mask;
+
+    if(width == 32){
+        mask = 0xFFFFFFFFu;
+    }
+    else{
+        mask = (1u << width) - 1u; // as 1u << 32 is not defiend we used above if clause
+    }
+
+    return (x >> lo) & mask;
+}
+
+inline uint32_t set_bits(uint32_t x, unsigned hi, unsigned lo, uint32_t value){
+
+    assert(lo <= hi);
+    assert(hi < 32);
+
+    unsigned width = hi - lo + 1;
+
+    uint32_t mask;
+
+    if(width == 32){
+        mask = 0xFFFFFFFFu;
+    }
+    else{
+        mask = ((1u << width) - 1u) << lo;
+    }
+
+    x = x & ~mask; // clear target bits before inserting
+
+    uint32_t shift = (value << lo) & mask;
+
+    return x | shift;
+}
+
+// convert unsigned to signed
+inline int32_t sign_extend(uint32_t x, unsigned nbits){
+
+    assert(nbits >= 1);
+    assert(nbits <= 32);
+
+    uint32_t signbit = (1u << (nbits - 1));
+
+    return (int32_t)((x ^ signbit) - signbit);
+}
+
+
+// ---------------- Bit scans ----------------
+// These sit on hot paths (lane masks, decoders) so they are defined inline
+// here instead of in bit_utils.cpp. ctz / clz map to a single instruction
+// (TZCNT / LZCNT or BSF / BSR) on GCC, Clang and MSVC. popcount is POPCNT only
+// when the target has it (-mpopcnt, -march=native on x86; MSVC assumes it):
+// without it GCC / Clang call a libgcc helper for the builtin, so the SWAR code
+// below is used instead. Other targets keep the builtin (e.g. CNT on AArch64).
+// ctz / clz of 0 is defined as the bit width (32 or 64), like TZCNT / LZCNT.
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__POPCNT__) || !(defined(__x86_64__) || defined(__i386__)))
+#define BIT_UTILS_POPCOUNT_BUILTIN 1
+#endif
+
+inline unsigned popcount32(uint32_t x){
+#if defined(BIT_UTILS_POPCOUNT_BUILTIN)
+    return (unsigned)__builtin_popcount(x);
+#elif defined(_MSC_VER)
+    return (unsigned)__popcnt(x);
+#else
+    // SWAR: add bit pairs, then nibbles, then sum the bytes with a multiply
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    return (unsigned)((x * 0x01010101u) >> 24);
+#endif
+}
+
+inline unsigned popcount64(uint64_t x){
+#if defined(BIT_UTILS_POPCOUNT_BUILTIN)
+    return (unsigned)__builtin_popcountll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return (unsigned)__popcnt64(x);
+#else
+    // same SWAR steps on 64 bits
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (unsigned)((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+inline unsigned ctz32(uint32_t x){
+    if(x == 0) return 32;
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(x);
+#elif defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (unsigned)i;
+#else
+    return popcount32((x & (0u - x)) - 1u); // ones below the lowest set bit
+#endif
+}
+
+inline unsigned ctz64(uint64_t x){
+    if(x == 0) return 64;
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return (unsigned)i;
+#else
+    return ((uint32_t)x != 0) ? ctz32((uint32_t)x) : 32 + ctz32((uint32_t)(x >> 32));
+#endif
+}
+
+inline unsigned clz32(uint32_t x){
+    if(x == 0) return 32;
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_clz(x);
+#elif defined(_MSC_VER)
+    unsigned long i;
+    _BitScanReverse(&i, x);
+    return 31u - (unsigned)i;
+#else
+    // smear the highest set bit to the right, then count what is left
+    x |= x >> 1; x |= x >> 2; x |= x >> 4; x |= x >> 8; x |= x >> 16;
+    return 32u - popcount32(x);
+#endif
+}
+
+inline unsigned clz64(uint64_t x){
+    if(x == 0) return 64;
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_clzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long i;
+    _BitScanReverse64(&i, x);
+    return 63u - (unsigned)i;
+#else
+    return ((x >> 32) != 0) ? clz32((uint32_t)(x >> 32)) : 32 + clz32((uint32_t)x);
+#endif
+}
+
+// ---------------- Set-bit iteration ----------------
+// Calls f(index) for every set bit of x, lowest first.
+// Cost is one ctz + one clear per set bit, independent of the width of x.
+//
+//     for_each_set_bit(mask, [&](unsigned lane){ ... });
+
+inline uint64_t clear_lowest_set_bit(uint64_t x){
+    return x & (x - 1); // x - 1 flips the lowest set bit and the zeros below it
+}
 
+template <class F>
+inline void for_each_set_bit(uint64_t x, F&& f){
+    while(x != 0){
+        f(ctz64(x));
+        x = clear_lowest_set_bit(x);
+    }
+}
@@ -32,5 +32,18 @@ int main() {
     std::cout << "sign_extend(0x80, 8) = " << sign_extend(b, 8) << "\n";
     std::cout << "sign_extend(0xF0, 8) = " << sign_extend(c, 8) << "\n";
 
+    // 5) bit scan tests
+    uint32_t m = 0x00F00010u;
+    std::cout << "popcount32(0x00F00010) = " << popcount32(m) << "\n";   // 5
+    std::cout << "ctz32(0x00F00010) = " << ctz32(m) << "\n";             // 4
+    std::cout << "clz32(0x00F00010) = " << clz32(m) << "\n";             // 8
+    std::cout << "ctz32(0) = " << ctz32(0) << "\n";                      // 32
+    std::cout << "clz64(1) = " << clz64(1) << "\n";                      // 63
+
+    // 6) set-bit iteration: visits 4 20 21 22 23
+    std::cout << "set bits of 0x00F00010 :";
+    for_each_set_bit(m, [](unsigned i){ std::cout << " " << i; });
+    std::cout << "\n";
+
     return 0;
 }
@@ -2,14 +2,6 @@
 #include<iostream>
 #include<iomanip> // this gives tool to modify the ouput format
 
-// update_ZN Function
-// This function is private function of ALU class. It has to use its variables. So classic OOP format "Class_Name::Function" 
-// :: is scope resolution, telling this func belongs to this class
-void ALU::update_ZN(){
-    flag.Z = (result == 0);
-    flag.N = ((result >> 31) & 1u) == 1u;
-};
-
 // trace function
 void ALU::trace(Opcode op, uint32_t shift_amount) const{
     // store current O/P format
@@ -33,7 +25,8 @@ void ALU::trace(Opcode op, uint32_t shift_amount) const{
     }
 
     std::cout<< " Result = 0x" << std::setw(8) << result;
-    std::cout<< " [Z = " << flag.Z <<" N = " << flag.N <<" C = " << flag.C<<" Z = " << flag.Z << "] " ;
+    const Flag& f = flags();
+    std::cout<< " [Z = " << f.Z <<" N = " << f.N <<" C = " << f.C<<" V = " << f.V << "] " ;
     
     // Restore the old cout format
     std::cout.copyfmt(old_state); 
@@ -56,21 +49,16 @@ const char* ALU::op_name(Opcode op){
 };
 
 
-// step function
-void ALU::step(Opcode op, uint32_t shift_amount){
+// flags of one operation : file-local and inline so the eager path in step() does not pay a call
+static inline Flag compute_flags(Opcode op, uint32_t A, uint32_t B, uint32_t shift_amount, uint32_t result){
 
-    // reset flags to zero
-    // Flag flag{} initializes flags once when the ALU object is created.
-    // flag = Flag{} resets flags every time a step function is executed.
-    flag = Flag{};
+    // flags start at zero every step
+    Flag flag{};
 
     switch(op){
-        // 8 cases
         case Opcode::ADD: {
             // 64 bit is used to identify the carry bit
             uint64_t temp = (uint64_t)A + (uint64_t)B;
-            result = uint32_t(temp);
-            // we do addition as it is unsigned int.
 
             // checking unsigned overflow
             flag.C = (temp >> 32 & 1u) == 1u;
@@ -80,17 +68,12 @@ void ALU::step(Opcode op, uint32_t shift_amount){
             uint32_t signB = (B >> 31) & 1u;
             uint32_t signresult = (result >> 31) & 1u;
 
-            flag.Z = (signA == signB) && (signA != signresult);
+            flag.V = (signA == signB) && (signA != signresult);
 
             break;
         }
 
         case Opcode::SUB: {
-
-            uint64_t temp = (uint64_t)A - (uint64_t)B;
-            result = uint32_t(temp);
-            // we do addition as it is unsigned int.            
-            
             // checking unsigned overflow
             flag.C = (A >= B);
             // Subtraction does as A + (¬B + 1). So A > B means there will be a carry.
@@ -101,27 +84,62 @@ void ALU::step(Opcode op, uint32_t shift_amount){
             uint32_t signB = (B >> 31) & 1u;
             uint32_t signresult = (result >> 31) & 1u;
 
-            flag.Z = (signA == signB) && (signA != signresult);
+            // A - B overflows when the signs differ and the result's sign is not A's
+            flag.V = (signA != signB) && (signA != signresult);
 
             break;
-
         }
 
         case Opcode::MUL:{
             uint64_t temp = (uint64_t)A * (uint64_t)B;
-            result = (uint32_t)temp;
-
             flag.C = ((temp >> 32) != 0);
 
             int64_t flow = (int64_t)(int32_t)A * (int64_t)(int32_t)B;
             // we are typecasting from 32bit to 64bit
             flag.V = ((flow > INT32_MAX) || (flow < INT32_MIN));
-            break; 
-        } 
-        
-        case Opcode::XOR_: result = A ^ B;
-        case Opcode::OR_ : result = A | B;
-        case Opcode::AND_ : result = A & B;
+            break;
+        }
+
+        case Opcode::SHL : {
+            shift_amount &= 31u;
+            flag.C = (shift_amount == 0) ? 0 :(A >> (32 - shift_amount) & 1u) != 0 ;
+            break;
+        }
+
+        case Opcode::SHR : {
+            shift_amount &= 31u;
+            flag.C = (shift_amount == 0) ? 0 :(A >> (shift_amount - 1) & 1u) != 0 ;
+            break;
+        }
+
+        default: // logic ops : C and V stay 0
+            break;
+    }
+
+    // Z and N come from the result for every operation
+    flag.Z = (result == 0);
+    flag.N = ((result >> 31) & 1u) == 1u;
+
+    return flag;
+}
+
+// flags_of function (lazy mode, through flags())
+Flag ALU::flags_of(Opcode op, uint32_t A, uint32_t B, uint32_t shift_amount, uint32_t result){
+    return compute_flags(op, A, B, shift_amount, result);
+};
+
+// step function
+void ALU::step(Opcode op, uint32_t shift_amount){
+
+    switch(op){
+        // 8 cases
+        case Opcode::ADD: result = A + B; break; // wraps mod 2^32, the carry is in flags_of
+        case Opcode::SUB: result = A - B; break;
+        case Opcode::MUL: result = A * B; break; // low 32 bits of the product
+
+        case Opcode::XOR_: result = A ^ B; break;
+        case Opcode::OR_ : result = A | B; break;
+        case Opcode::AND_ : result = A & B; break;
 
         case Opcode::SHL : {
             shift_amount &= 31u; 
@@ -129,14 +147,12 @@ void ALU::step(Opcode op, uint32_t shift_amount){
             // last 5 bits of the number is only taken (32 is 5 bits)
             // this is equivalent to num % 32
             result = A << shift_amount;
-            flag.C = (shift_amount == 0) ? 0 :(A >> (32 - shift_amount) & 1u) != 0 ;
             break;
         }
 
         case Opcode::SHR : {
             shift_amount &= 31u;
             result = A >> shift_amount;
-            flag.C = (shift_amount == 0) ? 0 :(A >> (shift_amount - 1) & 1u) != 0 ;
             break;
         }
 
@@ -145,11 +161,18 @@ void ALU::step(Opcode op, uint32_t shift_amount){
             break;
     }
 
-    update_ZN();
+    if(lazy_flags){
+        // only remember what the flags need : A and B may change before they are read
+        last = Last{A, B, result, (uint8_t)op, (uint8_t)shift_amount};
+        flags_pending = true;
+    }
+    else{
+        flag = compute_flags(op, A, B, shift_amount, result);
+        flags_pending = false;
+    }
 
     if(trace_enables){
         trace(op,shift_amount);
     }
 
 };
-
@@ -32,19 +32,46 @@ public :
     Opcode op;
 
     uint32_t result = 0;
-    Flag flag{}; // Flag is a type which holds 4 bool values. flag is a variable of type Flag. 
-    // {} helps to initialise everything to zero. if we dont use it we have to manually initialise its objects to zero like flags.N = 0
-    // if no {}, object is created but data variables will have garbage values.
 
     bool trace_enables = true; // to print the state at current time.
     // should be always enabled to help us log the results. and this happens in the step function at last.
+
+    // Lazy flags : step() only computes result and records what the flags depend on
+    // (opcode, operands, result). N/Z/C/V are worked out the first time flags() is read
+    // after that step, with the same code as eager mode, so the values are identical.
+    // Worth it when most steps never have their flags read (the CPU only reads them for CMP).
+    bool lazy_flags = false;
+
     void step(Opcode op, uint32_t shift_amount = 0);
 
+    // flags of the last step (all 0 before the first one)
+    const Flag& flags() const{
+        if(flags_pending){
+            flag = flags_of((Opcode)last.op, last.A, last.B, last.shift, last.result);
+            flags_pending = false;
+        }
+        return flag;
+    }
+
 private :
 
 // Golden rule : everything you see outside the ALU put them in public as you need to interact with it. Put the rest of helper functions in the private section.
 
-    void update_ZN(); // sets Z and N values, this happens after the execution of the program so kept in private.
+    mutable Flag flag{}; // Flag is a type which holds 4 bool values. flag is a variable of type Flag.
+    // {} helps to initialise everything to zero. if we dont use it we have to manually initialise its objects to zero like flags.N = 0
+    // if no {}, object is created but data variables will have garbage values.
+    // mutable : flags() fills it in lazily, from a const function
+
+    // lazy mode : flag is out of date, last has what it needs. result is copied too :
+    // it is a public member, and a write to it before flags() must not change the flags.
+    mutable bool flags_pending = false;
+    struct Last{
+        uint32_t A = 0, B = 0, result = 0;
+        uint8_t op = 0, shift = 0; // kept small : recording must cost less than the flags
+    } last;
+
+    // N/Z/C/V of one operation. The only place flags are computed, eager or lazy.
+    static Flag flags_of(Opcode op, uint32_t A, uint32_t B, uint32_t shift_amount, uint32_t result);
     void trace(Opcode op, uint32_t shift_amount) const; // use const as we should not be able to change the variables inside. This will be just read only output.
     static const char* op_name(Opcode op);
     // Here this helper function does not use any class variables and just a helper. So we use static so we can easily access it with class name by not initialising an object.
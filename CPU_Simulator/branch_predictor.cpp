@@ -0,0 +1,187 @@
+#include "branch_predictor.h"
+#include <stdexcept>
+
+// 2-bit saturating counter
+static void train(uint8_t& c, bool taken) {
+    if (taken && c < 3) c++;
+    if (!taken && c > 0) c--;
+}
+
+static uint64_t history_mask(uint32_t bits) {
+    return bits >= 64 ? ~0ull : ((1ull << bits) - 1);
+}
+
+// XOR of the low len bits of h, folded into bits bits
+static uint32_t fold(uint64_t h, uint32_t len, uint32_t bits) {
+    h &= history_mask(len);
+    uint32_t f = 0;
+    for (uint32_t i = 0; i < len; i += bits) f ^= (uint32_t)(h >> i);
+    return f & (uint32_t)history_mask(bits);
+}
+
+// ---------------- Static ----------------
+std::string StaticPredictor::name() const {
+    switch (policy) {
+        case Policy::NotTaken: return "static-not-taken";
+        case Policy::Taken:    return "static-taken";
+        case Policy::BTFN:     return "static-btfn";
+    }
+    return "static";
+}
+
+Prediction StaticPredictor::predict(uint32_t pc, uint32_t target) {
+    Prediction p;
+    if (policy == Policy::Taken) p.taken = true;
+    if (policy == Policy::BTFN) p.taken = target <= pc; // loops branch backwards
+    return p;
+}
+
+// ---------------- Bimodal ----------------
+BimodalPredictor::BimodalPredictor(uint32_t index_bits)
+    : counters(1u << index_bits, 1), mask((1u << index_bits) - 1) {
+    if (index_bits == 0 || index_bits > 24) throw std::invalid_argument("BimodalPredictor: index_bits must be 1..24");
+}
+
+std::string BimodalPredictor::name() const {
+    return "bimodal";
+}
+
+Prediction BimodalPredictor::predict(uint32_t pc, uint32_t) {
+    Prediction p;
+    p.taken = counters[pc & mask] >= 2;
+    return p;
+}
+
+void BimodalPredictor::update(uint32_t pc, uint32_t, const Prediction&, bool taken) {
+    train(counters[pc & mask], taken);
+}
+
+// ---------------- Gshare ----------------
+GsharePredictor::GsharePredictor(uint32_t index_bits, uint32_t history_bits)
+    : counters(1u << index_bits, 1), mask((1u << index_bits) - 1), history_bits(history_bits) {
+    if (index_bits == 0 || index_bits > 24) throw std::invalid_argument("GsharePredictor: index_bits must be 1..24");
+    if (history_bits > 64) throw std::invalid_argument("GsharePredictor: history_bits must be <= 64");
+}
+
+std::string GsharePredictor::name() const {
+    return "gshare";
+}
+
+Prediction GsharePredictor::predict(uint32_t pc, uint32_t) {
+    Prediction p;
+    p.history = history;
+    p.taken = counters[(pc ^ fold(history, history_bits, 32)) & mask] >= 2;
+    history = (history << 1) | (p.taken ? 1 : 0);
+    return p;
+}
+
+void GsharePredictor::update(uint32_t pc, uint32_t, const Prediction& p, bool taken) {
+    train(counters[(pc ^ fold(p.history, history_bits, 32)) & mask], taken);
+    if (taken != p.taken) history = (p.history << 1) | (taken ? 1 : 0);
+}
+
+// ---------------- TAGE-lite ----------------
+TagePredictor::TagePredictor(uint32_t index_bits, uint32_t tag_bits, std::vector<uint32_t> history_lengths)
+    : base(1u << index_bits, 1), lengths(std::move(history_lengths)), index_bits(index_bits), tag_bits(tag_bits) {
+    if (index_bits == 0 || index_bits > 20) throw std::invalid_argument("TagePredictor: index_bits must be 1..20");
+    if (tag_bits < 2 || tag_bits > 16) throw std::invalid_argument("TagePredictor: tag_bits must be 2..16");
+    if (lengths.empty()) throw std::invalid_argument("TagePredictor: no tagged tables");
+    for (size_t i = 0; i < lengths.size(); i++) {
+        if (lengths[i] == 0 || lengths[i] > 64 || (i > 0 && lengths[i] <= lengths[i - 1]))
+            throw std::invalid_argument("TagePredictor: history lengths must grow, up to 64");
+    }
+    tables.assign(lengths.size(), std::vector<Entry>(1u << index_bits));
+}
+
+std::string TagePredictor::name() const {
+    return "tage-lite";
+}
+
+TagePredictor::Lookup TagePredictor::lookup(uint32_t pc, uint64_t hist) const {
+    Lookup l;
+    const uint32_t imask = (1u << index_bits) - 1;
+    const uint32_t tmask = (1u << tag_bits) - 1;
+    l.index.resize(tables.size());
+    l.tag.resize(tables.size());
+    for (size_t t = 0; t < tables.size(); t++) {
+        l.index[t] = (pc ^ (pc >> index_bits) ^ fold(hist, lengths[t], index_bits)) & imask;
+        l.tag[t] = (uint16_t)((pc ^ fold(hist, lengths[t], tag_bits) ^ (fold(hist, lengths[t], tag_bits - 1) << 1)) & tmask);
+    }
+    for (int t = (int)tables.size() - 1; t >= 0; t--) {
+        const Entry& e = tables[t][l.index[t]];
+        if (!e.valid || e.tag != l.tag[t]) continue;
+        if (l.provider < 0) l.provider = t;
+        else { l.alt = t; break; }
+    }
+    const bool base_pred = base[pc & imask] >= 2;
+    l.provider_pred = l.provider >= 0 ? tables[l.provider][l.index[l.provider]].ctr >= 0 : base_pred;
+    l.alt_pred = l.alt >= 0 ? tables[l.alt][l.index[l.alt]].ctr >= 0 : base_pred;
+    return l;
+}
+
+Prediction TagePredictor::predict(uint32_t pc, uint32_t) {
+    Prediction p;
+    p.history = history;
+    p.taken = lookup(pc, history).provider_pred;
+    history = (history << 1) | (p.taken ? 1 : 0);
+    return p;
+}
+
+void TagePredictor::update(uint32_t pc, uint32_t, const Prediction& p, bool taken) {
+    const Lookup l = lookup(pc, p.history);
+    const uint32_t imask = (1u << index_bits) - 1;
+
+    if (l.provider >= 0) {
+        Entry& e = tables[l.provider][l.index[l.provider]];
+        if (taken && e.ctr < 3) e.ctr++;
+        if (!taken && e.ctr > -4) e.ctr--;
+        if (l.provider_pred != l.alt_pred) {
+            if (l.provider_pred == taken && e.useful < 3) e.useful++;
+            if (l.provider_pred != taken && e.useful > 0) e.useful--;
+        }
+    } else {
+        train(base[pc & imask], taken);
+    }
+
+    // wrong : give the branch an entry with a longer history
+    if (l.provider_pred != taken && l.provider + 1 < (int)tables.size()) {
+        int start = l.provider + 1;
+        rng = rng * 1664525u + 1013904223u;
+        if ((rng >> 16) & 1 && start + 1 < (int)tables.size()) start++; // spread allocations
+        bool allocated = false;
+        for (int t = start; t < (int)tables.size() && !allocated; t++) {
+            Entry& e = tables[t][l.index[t]];
+            if (e.useful != 0) continue;
+            e.valid = true;
+            e.tag = l.tag[t];
+            e.ctr = taken ? 0 : -1;
+            allocated = true;
+        }
+        if (!allocated) {
+            for (int t = l.provider + 1; t < (int)tables.size(); t++) {
+                Entry& e = tables[t][l.index[t]];
+                if (e.useful > 0) e.useful--;
+            }
+        }
+    }
+
+    // age useful bits so stale entries can be replaced
+    if (++updates % (256 * 1024) == 0) {
+        for (auto& table : tables)
+            for (Entry& e : table) e.useful >>= 1;
+    }
+
+    if (taken != p.taken) history = (p.history << 1) | (taken ? 1 : 0);
+}
+
+std::unique_ptr<BranchPredictor> make_predictor(const std::string& name) {
+    if (name == "static" || name == "static-not-taken")
+        return std::make_unique<StaticPredictor>(StaticPredictor::Policy::NotTaken);
+    if (name == "static-taken") return std::make_unique<StaticPredictor>(StaticPredictor::Policy::Taken);
+    if (name == "btfn" || name == "static-btfn")
+        return std::make_unique<StaticPredictor>(StaticPredictor::Policy::BTFN);
+    if (name == "bimodal") return std::make_unique<BimodalPredictor>();
+    if (name == "gshare") return std::make_unique<GsharePredictor>();
+    if (name == "tage" || name == "tage-lite") return std::make_unique<TagePredictor>();
+    throw std::invalid_argument("unknown branch predictor " + name);
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<vector>
+
+// Branch predictors for the pipelined core (pipeline.h).
+// The pipeline asks for a prediction when it fetches a conditional branch
+// (BEQ/BNE/BLT) and reports the outcome when the branch resolves in EX,
+// in program order. Branches fetched down a wrong path are predicted but
+// never reported.
+
+// What predict() decided, handed back to update() for the same branch.
+struct Prediction{
+    bool taken = false;
+    uint64_t history = 0; // global history the prediction was made with
+};
+
+class BranchPredictor{
+public :
+    virtual ~BranchPredictor() = default;
+
+    virtual std::string name() const = 0;
+
+    // target : where the branch goes when taken (known at fetch, offsets are direct)
+    virtual Prediction predict(uint32_t pc, uint32_t target) = 0;
+
+    // real outcome. When it differs from p.taken, predictors with a global history
+    // rebuild it from p.history, dropping the wrong-path branches shifted in since.
+    virtual void update(uint32_t pc, uint32_t target, const Prediction& p, bool taken) = 0;
+};
+
+// No state : always not taken, always taken, or backward taken / forward not taken.
+class StaticPredictor : public BranchPredictor{
+public :
+    enum class Policy { NotTaken, Taken, BTFN };
+    explicit StaticPredictor(Policy p = Policy::NotTaken) : policy(p) {}
+
+    std::string name() const override;
+    Prediction predict(uint32_t pc, uint32_t target) override;
+    void update(uint32_t, uint32_t, const Prediction&, bool) override {}
+
+private :
+    Policy policy;
+};
+
+// 2-bit saturating counters indexed by the branch address.
+class BimodalPredictor : public BranchPredictor{
+public :
+    explicit BimodalPredictor(uint32_t index_bits = 10);
+
+    std::string name() const override;
+    Prediction predict(uint32_t pc, uint32_t target) override;
+    void update(uint32_t pc, uint32_t target, const Prediction& p, bool taken) override;
+
+private :
+    std::vector<uint8_t> counters; // 0..3, taken from 2
+    uint32_t mask;
+};
+
+// 2-bit counters indexed by branch address XOR global history.
+// The history is shifted at predict time (speculatively) and repaired on a misprediction.
+class GsharePredictor : public BranchPredictor{
+public :
+    explicit GsharePredictor(uint32_t index_bits = 12, uint32_t history_bits = 12);
+
+    std::string name() const override;
+    Prediction predict(uint32_t pc, uint32_t target) override;
+    void update(uint32_t pc, uint32_t target, const Prediction& p, bool taken) override;
+
+private :
+    std::vector<uint8_t> counters;
+    uint32_t mask;
+    uint32_t history_bits;
+    uint64_t history = 0;
+};
+
+// TAGE-lite : a bimodal base table plus tagged tables indexed with geometrically longer
+// global histories (4, 8, 16, 32, 64 branches by default). The longest matching table
+// predicts; on a misprediction an entry is allocated in a longer table.
+// No loop predictor / statistical corrector, and useful bits age by halving.
+class TagePredictor : public BranchPredictor{
+public :
+    explicit TagePredictor(uint32_t index_bits = 10, uint32_t tag_bits = 9,
+                           std::vector<uint32_t> history_lengths = {4, 8, 16, 32, 64});
+
+    std::string name() const override;
+    Prediction predict(uint32_t pc, uint32_t target) override;
+    void update(uint32_t pc, uint32_t target, const Prediction& p, bool taken) override;
+
+private :
+    struct Entry{
+        bool valid = false;
+        uint16_t tag = 0;
+        int8_t ctr = 0;    // -4..3, taken when >= 0
+        uint8_t useful = 0; // 0..3
+    };
+
+    // where the tables point for one branch and one history
+    struct Lookup{
+        std::vector<uint32_t> index;
+        std::vector<uint16_t> tag;
+        int provider = -1;  // longest matching table, -1 : base
+        int alt = -1;       // next matching one, -1 : base
+        bool provider_pred = false;
+        bool alt_pred = false;
+    };
+    Lookup lookup(uint32_t pc, uint64_t hist) const;
+
+    std::vector<uint8_t> base;          // bimodal, 2-bit counters
+    std::vector<std::vector<Entry>> tables;
+    std::vector<uint32_t> lengths;
+    uint32_t index_bits, tag_bits;
+    uint64_t history = 0;
+    uint64_t updates = 0;
+    uint32_t rng = 0x12345678u;         // allocation tie-break
+};
+
+std::unique_ptr<BranchPredictor> make_predictor(const std::string& name); // static, btfn, bimodal, gshare, tage
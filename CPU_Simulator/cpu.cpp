@@ -1,4 +1,5 @@
 #include "cpu.h"
+#include "encoding.h"
 #include <iostream> 
 #include <stdexcept> 
 
@@ -12,6 +13,14 @@ const char* CPU::iop_name(IOp op) {
         case IOp::SHL:  return "SHL";
         case IOp::SHR:  return "SHR";
         case IOp::ADDI: return "ADDI";
+        case IOp::CMP:  return "CMP";
+        case IOp::CMPI: return "CMPI";
+        case IOp::BEQ:  return "BEQ";
+        case IOp::BNE:  return "BNE";
+        case IOp::BLT:  return "BLT";
+        case IOp::JAL:  return "JAL";
+        case IOp::LW:   return "LW";
+        case IOp::SW:   return "SW";
         case IOp::HALT: return "HALT";
         default:        return "???";
     }
@@ -42,20 +51,48 @@ Opcode CPU::to_alu(IOp op) {
     }
 }
 
+// Z for equal, N != V for signed less than (flags of rs1 - rs2)
+bool CPU::branch_taken(IOp op, const Flag& f) {
+    switch (op) {
+        case IOp::BEQ: return f.Z;
+        case IOp::BNE: return !f.Z;
+        case IOp::BLT: return f.N != f.V;
+        default:       return false;
+    }
+}
+
 // constructor
 CPU::CPU() {
     alu.trace_enables = false;
+    alu.lazy_flags = true; // only CMP / CMPI read them
     R.fill(0);
 }
 
 void CPU::load_program(const std::vector<Instr>& program) {
-    mem = program;
+    mem = encode_program(program);
+    reset();
+}
+
+void CPU::load_program(const uint32_t* words, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (!valid_opcode(words[i]))
+            throw std::runtime_error("invalid opcode in program image");
+    }
+    mem.assign(words, words + count);
+    reset();
+}
+
+void CPU::reset() {
     R.fill(0);
+    F = Flag{};
     PC = 0;
     MAR = 0;
-    IR = Instr{};
-    MDR = Instr{};
+    IR = 0;
+    MDR = 0;
+    dec = Instr{};
     phase = Phase::FETCH1;
+    block_at.assign(mem.size(), -1); // translations of the old program are gone
+    blocks.clear();
 }
 
 void CPU::dump_regs() const {
@@ -97,56 +134,33 @@ void CPU::tick() {
             break;
 
         case Phase::DECODE:
+            dec = decode(IR);
             if (trace) {
                 std::cout<<std::endl;
-                std::cout << "DECODE: " << iop_name(IR.op)
-                          << " rd=R" << int(IR.rd)
-                          << " rs1=R" << int(IR.rs1)
-                          << " rs2=R" << int(IR.rs2)
-                          << " imm=" << IR.imm << "\n";
+                std::cout << "DECODE: " << iop_name(dec.op)
+                          << " rd=R" << int(dec.rd)
+                          << " rs1=R" << int(dec.rs1)
+                          << " rs2=R" << int(dec.rs2)
+                          << " imm=" << dec.imm << "\n";
             }
             phase = Phase::EXECUTE;
             break;
 
         case Phase::EXECUTE:
-            switch (IR.op) {
-                case IOp::HALT:
-                    phase = Phase::HALTED;
-                    return;
-
-                case IOp::ADDI:
-                    alu.A = R[IR.rs1];
-                    alu.B = (uint32_t)IR.imm;
-                    alu.step(Opcode::ADD);
-                    R[IR.rd] = alu.result;
-                    break;
-
-                case IOp::ADD:
-                case IOp::SUB:
-                case IOp::AND_:
-                case IOp::OR_:
-                case IOp::XOR_:
-                    alu.A = R[IR.rs1];
-                    alu.B = R[IR.rs2];
-                    alu.step(to_alu(IR.op));
-                    R[IR.rd] = alu.result;
-                    break;
-
-                case IOp::SHL:
-                case IOp::SHR:
-                    alu.A = R[IR.rs1];
-                    alu.step(to_alu(IR.op), (uint32_t)IR.imm);
-                    R[IR.rd] = alu.result;
-                    break;
+            if (dec.op == IOp::HALT) {
+                phase = Phase::HALTED;
+                return;
             }
+            execute(dec);
 
             if (trace) {
                 std::cout<<std::endl;
                 std::cout << "ALU result=" << alu.result
-                          << " [Z=" << alu.flag.Z
-                          << " N=" << alu.flag.N
-                          << " C=" << alu.flag.C
-                          << " V=" << alu.flag.V << "]\n";
+                          << " [Z=" << alu.flags().Z
+                          << " N=" << alu.flags().N
+                          << " C=" << alu.flags().C
+                          << " V=" << alu.flags().V << "]"
+                          << " PC=" << PC << "\n";
                 dump_regs();
             }
 
@@ -164,11 +178,186 @@ void CPU::run(uint32_t max_ticks) {
     for (uint32_t i = 0; i < max_ticks; ++i) {
         if (phase == Phase::HALTED) return;
         tick();
-        std::cout << "------------------------------------------------------";
+        if (trace) std::cout << "------------------------------------------------------";
     }
     throw std::runtime_error("CPU timeout");
 }
 
+uint32_t& CPU::data_word(uint32_t addr) {
+    if (addr >= data.size())
+        throw std::runtime_error("data address out of bounds");
+    return data[addr];
+}
+
+void CPU::execute(const Instr& in) {
+    switch (in.op) {
+        case IOp::HALT:
+            break;
+
+        case IOp::ADDI:
+            alu.A = R[in.rs1];
+            alu.B = in.imm;
+            alu.step(Opcode::ADD);
+            R[in.rd] = alu.result;
+            break;
 
+        case IOp::ADD:
+        case IOp::SUB:
+        case IOp::AND_:
+        case IOp::OR_:
+        case IOp::XOR_:
+            alu.A = R[in.rs1];
+            alu.B = R[in.rs2];
+            alu.step(to_alu(in.op));
+            R[in.rd] = alu.result;
+            break;
+
+        case IOp::SHL:
+        case IOp::SHR:
+            alu.A = R[in.rs1];
+            alu.step(to_alu(in.op), in.imm);
+            R[in.rd] = alu.result;
+            break;
 
+        case IOp::CMP:
+        case IOp::CMPI:
+            alu.A = R[in.rs1];
+            alu.B = (in.op == IOp::CMP) ? R[in.rs2] : in.imm;
+            alu.step(Opcode::SUB);
+            F = alu.flags();
+            break;
+
+        case IOp::BEQ:
+        case IOp::BNE:
+        case IOp::BLT:
+            if (branch_taken(in.op, F)) PC = PC - 1 + in.imm;
+            break;
+
+        case IOp::JAL:
+            R[in.rd] = PC;            // return address
+            PC = PC - 1 + in.imm;
+            break;
 
+        case IOp::LW:
+            R[in.rd] = data_word(R[in.rs1] + in.imm);
+            break;
+
+        case IOp::SW:
+            data_word(R[in.rs1] + in.imm) = R[in.rs2];
+            break;
+    }
+}
+
+uint64_t CPU::run_functional(uint64_t max_instrs) {
+    if (phase == Phase::HALTED) return 0;
+    if (phase != Phase::FETCH1)
+        throw std::runtime_error("run_functional: CPU is in the middle of an instruction");
+
+    const uint32_t* prog = mem.data();
+    const uint32_t n = (uint32_t)mem.size();
+    uint32_t pc = PC; // kept in a register; PC is only written back on the way out
+
+    // ALU ops are computed here; only the last one is replayed on `alu` on the way out,
+    // which leaves it (A, B, result, flags) as if every op had gone through it
+    Opcode alu_op = Opcode::ADD;
+    uint32_t alu_a = alu.A, alu_b = alu.B, alu_shift = 0;
+    bool alu_pending = false;
+    auto leave = [&]() {
+        PC = pc;
+        if (alu_pending) {
+            alu.A = alu_a;
+            alu.B = alu_b;
+            alu.step(alu_op, alu_shift);
+        }
+    };
+
+    for (uint64_t executed = 0; executed < max_instrs; ++executed) {
+        if (pc >= n) {
+            leave();
+            throw std::runtime_error("PC out of bounds");
+        }
+        const Instr in = decode(prog[pc++]);
+
+        // execute() inlined, with pc for PC
+        switch (in.op) {
+            case IOp::ADDI:
+                alu_op = Opcode::ADD; alu_a = R[in.rs1]; alu_b = in.imm; alu_pending = true;
+                R[in.rd] = alu_a + alu_b;
+                break;
+            case IOp::ADD:
+                alu_op = Opcode::ADD; alu_a = R[in.rs1]; alu_b = R[in.rs2]; alu_pending = true;
+                R[in.rd] = alu_a + alu_b;
+                break;
+            case IOp::SUB:
+                alu_op = Opcode::SUB; alu_a = R[in.rs1]; alu_b = R[in.rs2]; alu_pending = true;
+                R[in.rd] = alu_a - alu_b;
+                break;
+            case IOp::AND_:
+                alu_op = Opcode::AND_; alu_a = R[in.rs1]; alu_b = R[in.rs2]; alu_pending = true;
+                R[in.rd] = alu_a & alu_b;
+                break;
+            case IOp::OR_:
+                alu_op = Opcode::OR_; alu_a = R[in.rs1]; alu_b = R[in.rs2]; alu_pending = true;
+                R[in.rd] = alu_a | alu_b;
+                break;
+            case IOp::XOR_:
+                alu_op = Opcode::XOR_; alu_a = R[in.rs1]; alu_b = R[in.rs2]; alu_pending = true;
+                R[in.rd] = alu_a ^ alu_b;
+                break;
+
+            case IOp::SHL: // B is left as it was, as in execute()
+                alu_op = Opcode::SHL; alu_a = R[in.rs1]; alu_shift = in.imm; alu_pending = true;
+                R[in.rd] = alu_a << (in.imm & 31u);
+                break;
+            case IOp::SHR:
+                alu_op = Opcode::SHR; alu_a = R[in.rs1]; alu_shift = in.imm; alu_pending = true;
+                R[in.rd] = alu_a >> (in.imm & 31u);
+                break;
+
+            case IOp::CMP:
+            case IOp::CMPI:
+                alu_a = alu.A = R[in.rs1];
+                alu_b = alu.B = (in.op == IOp::CMP) ? R[in.rs2] : in.imm;
+                alu.step(Opcode::SUB);
+                F = alu.flags();
+                alu_pending = false;
+                break;
+
+            case IOp::BEQ:
+            case IOp::BNE:
+            case IOp::BLT:
+                if (branch_taken(in.op, F)) pc = pc - 1 + in.imm;
+                break;
+
+            case IOp::JAL:
+                R[in.rd] = pc;
+                pc = pc - 1 + in.imm;
+                break;
+
+            case IOp::LW:
+            case IOp::SW: {
+                const uint32_t addr = R[in.rs1] + in.imm;
+                if (addr >= data.size()) {
+                    leave();
+                    throw std::runtime_error("data address out of bounds");
+                }
+                if (in.op == IOp::LW) R[in.rd] = data[addr];
+                else data[addr] = R[in.rs2];
+                break;
+            }
+
+            case IOp::HALT:
+                // what the multi-cycle fetch leaves behind
+                leave();
+                MAR = pc - 1;
+                MDR = IR = mem[MAR];
+                dec = in;
+                phase = Phase::HALTED;
+                return executed + 1;
+        }
+    }
+
+    leave();
+    // between two instructions : run() or run_functional() can go on
+    throw std::runtime_error("CPU timeout");
+}
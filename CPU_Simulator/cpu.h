@@ -5,15 +5,20 @@
 #include<vector> // for memory
 
 // CPU Instruction Set (ISA)
-// This is used for opcodes of the operations for the CPU coming form the RAM, there will be many more like JUMP and compare
+// This is used for opcodes of the operations for the CPU coming form the RAM
 enum class IOp : uint8_t{
     ADD,SUB,AND_,OR_,XOR_,
     SHL,SHR,
     ADDI,
+    CMP,CMPI,          // flags only
+    BEQ,BNE,BLT,JAL,   // control flow
+    LW,SW,             // data memory
     HALT
 };
 
 // Instruction format
+// Branch and jump offsets (imm) are relative to the instruction's own address and
+// signed (two's complement in the uint32_t). Memory addresses are word indices.
 struct Instr{
     IOp op{IOp :: HALT};
     uint32_t rd = 0;
@@ -27,7 +32,13 @@ class CPU{
 public :
     CPU(); // constructor
 
-    void load_program(const std::vector<Instr> & program);
+    void load_program(const std::vector<Instr> & program); // encoded (encoding.h), throws if a field does not fit
+
+    // Raw program image : 32-bit words as in encoding.h, e.g. a MappedImage or the
+    // output of assemble(). Copied as is (one opcode check per word, no parsing).
+    // Throws std::runtime_error("invalid opcode in program image").
+    void load_program(const uint32_t* words, size_t count);
+    void load_program(const std::vector<uint32_t>& image) { load_program(image.data(), image.size()); }
 
     // If we don't use & 
     // Copies every instruction
@@ -38,28 +49,75 @@ public :
 
     void run(uint32_t max_tricks = 500);
 
+    // Functional mode : one whole instruction per loop iteration straight from
+    // the program (no phases, no MAR/MDR/IR copies, no trace output). Ends in
+    // the same state as run() : same registers, PC, ALU result/flags, HALTED.
+    // Returns the number of instructions executed, HALT included.
+    // Throws like run() : "PC out of bounds", or "CPU timeout" after max_instrs
+    // (stopped between two instructions, so it can be resumed).
+    uint64_t run_functional(uint64_t max_instrs = UINT64_MAX);
+
+    // Translated mode (translate.cpp) : the first time execution reaches an address,
+    // the basic block starting there (up to its branch / JAL / HALT) is turned into
+    // handlers with register indices and immediates already bound, and kept. Later
+    // visits run the cached handlers. Same results and errors as run_functional,
+    // except that ALU ops compute directly : `alu` only sees CMP / CMPI.
+    // load_program empties the cache.
+    uint64_t run_translated(uint64_t max_instrs = UINT64_MAX);
+    size_t translated_blocks() const { return blocks.size(); }
+
     bool trace = true;
     std::array<uint32_t, 8> R{}; 
+    Flag F{};                          // set by CMP / CMPI, read by BEQ / BNE / BLT
+    std::vector<uint32_t> data;        // data memory for LW / SW (word addressed, kept by load_program)
+
+    // also used by the pipelined core (pipeline.h)
+    static const char* iop_name(IOp op);
+    static Opcode to_alu(IOp op);
+    static bool branch_taken(IOp op, const Flag& f); // BEQ / BNE / BLT
+    static bool is_branch(IOp op) { return op == IOp::BEQ || op == IOp::BNE || op == IOp::BLT; }
 
 private : 
     uint32_t PC = 0;
     uint32_t MAR = 0;
 
-    Instr IR{};
-    Instr MDR{};
+    uint32_t IR = 0;  // instruction word
+    uint32_t MDR = 0;
+    Instr dec{};      // IR decoded (DECODE phase)
 
-    std::vector<Instr> mem;
+    std::vector<uint32_t> mem; // encoded program (encoding.h) : 4 bytes per instruction
     
     ALU alu;
 
     enum class Phase { FETCH1, FETCH2, FETCH3, DECODE, EXECUTE, HALTED };
     Phase phase = Phase::FETCH1;
 
+    void reset(); // state load_program starts from
     void tick(); // function operations per clock cycle
+    void execute(const Instr& in); // EXECUTE of one instruction (not HALT), PC already past it
+    uint32_t& data_word(uint32_t addr);
     void dump_regs() const; // for registors output
 
     static const char* phase_name(Phase p);
-    static const char* iop_name(IOp op);
-    static Opcode to_alu(IOp op);
+
+    // translation cache
+    struct Op;
+    using Handler = void (*)(CPU&, const Op&);
+    struct Op{
+        Handler fn;
+        uint8_t rd, rs1, rs2;
+        uint32_t imm;
+    };
+    struct Block{
+        uint32_t start = 0;
+        std::vector<Op> body;     // straight-line part
+        bool ends = false;        // false : runs into the end of the program
+        Instr end{};              // branch / JAL / HALT closing the block
+    };
+    std::vector<int32_t> block_at; // per address : index in blocks, -1 not translated
+    std::vector<Block> blocks;
+
+    struct Handlers;
+    const Block& translate(uint32_t pc);
 };
 
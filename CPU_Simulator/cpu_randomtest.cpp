@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cpu.h"
+#include "encoding.h"
+#include "pipeline.h"
+
+// Random programs through every execution mode, checked against run_functional.
+// Programs mix ALU ops, compares, branches (forward and backward, some past the
+// end), counted loops on R6, JAL, and LW / SW through R7, which mostly holds a
+// valid data address.
+// Loops that never end hit the budget, stray branches and addresses fault; the
+// other modes must end the same way.
+
+namespace {
+
+constexpr size_t data_words = 16;
+constexpr uint64_t instr_budget = 4000;
+
+std::vector<Instr> random_program(std::mt19937& rng) {
+    auto pick = [&](uint32_t n) { return (uint32_t)(rng() % n); };
+    const uint32_t len = 6 + pick(26);
+
+    std::vector<Instr> p;
+    p.push_back({IOp::ADDI, 7, 7, 0, pick(data_words)}); // R7 : data base
+    p.push_back({IOp::ADDI, 6, 6, 0, 1 + pick(6)});      // R6 : loop counter
+    while (p.size() + 1 < len) {
+        Instr in;
+        in.rd = pick(8);
+        if (in.rd >= 6 && pick(4)) in.rd = pick(6); // keep R6 / R7 mostly what they are
+        in.rs1 = pick(8);
+        in.rs2 = pick(8);
+        const uint32_t pc = (uint32_t)p.size();
+        const uint32_t target = pick(len + 2); // len, len + 1 : past the end
+        switch (pick(13)) {
+            case 0: in.op = (IOp)pick(5); break; // ADD SUB AND OR XOR
+            case 1: in.op = pick(2) ? IOp::SHL : IOp::SHR; in.imm = pick(32); break;
+            case 2:
+            case 3: in.op = IOp::ADDI; in.imm = pick(16) - 8; break;
+            case 4: in.op = IOp::CMP; break;
+            case 5: in.op = IOp::CMPI; in.imm = pick(16) - 8; break;
+            case 6:
+            case 7: in.op = (IOp)((uint32_t)IOp::BEQ + pick(3)); in.imm = target - pc; break;
+            case 8: in.op = IOp::JAL; in.imm = target - pc; break;
+            case 9:
+            case 10:
+                in.op = pick(2) ? IOp::LW : IOp::SW;
+                if (pick(4)) in.rs1 = 7;
+                in.imm = pick(8) - 2;
+                break;
+            case 11: {
+                // counted loop back to an earlier instruction : R6 -= 1, loop while R6 != 0
+                if (p.size() + 4 > len) { in.op = IOp::ADD; break; }
+                const uint32_t back = 2 + pick(pc - 1);
+                p.push_back({IOp::ADDI, 6, 6, 0, (uint32_t)-1});
+                p.push_back({IOp::CMPI, 0, 6, 0, 0});
+                in = {IOp::BNE, 0, 0, 0, back - (pc + 2)};
+                break;
+            }
+            default: in.op = pick(4) ? IOp::ADD : IOp::HALT; break;
+        }
+        p.push_back(in);
+    }
+    if (pick(8)) p.push_back({IOp::HALT, 0, 0, 0, 0}); // else : runs off the end
+    return p;
+}
+
+std::vector<uint32_t> random_memory(std::mt19937& rng) {
+    std::vector<uint32_t> d(data_words);
+    for (uint32_t& w : d) w = rng() % 64;
+    return d;
+}
+
+uint32_t flag_bits(const Flag& f) {
+    return (uint32_t)f.N << 3 | (uint32_t)f.Z << 2 | (uint32_t)f.C << 1 | (uint32_t)f.V;
+}
+
+// how a run ended : error message, "" when HALT was reached
+template <typename Run>
+std::string outcome(Run run) {
+    try {
+        run();
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+    return "";
+}
+
+} // namespace
+
+TEST(CPU_Random, TranslatedAgainstFunctional) {
+    uint32_t seed = 2026;
+    std::mt19937 rng(seed);
+
+    for (int i = 0; i < 2000; ++i) {
+        const std::vector<Instr> prog = random_program(rng);
+        const std::vector<uint32_t> data = random_memory(rng);
+
+        CPU ref, cpu;
+        ref.trace = cpu.trace = false;
+        ref.load_program(prog);
+        cpu.load_program(prog);
+        ref.data = cpu.data = data;
+
+        uint64_t n_ref = 0, n = 0;
+        const std::string end_ref = outcome([&] { n_ref = ref.run_functional(instr_budget); });
+        const std::string end = outcome([&] { n = cpu.run_translated(instr_budget); });
+
+        ASSERT_EQ(end, end_ref) << "Seed=" << seed << " program " << i;
+        ASSERT_EQ(n, n_ref) << "Seed=" << seed << " program " << i;
+        if (end_ref.empty() || end_ref == "CPU timeout") { // faults may stop mid-instruction
+            ASSERT_EQ(cpu.R, ref.R) << "Seed=" << seed << " program " << i;
+            ASSERT_EQ(flag_bits(cpu.F), flag_bits(ref.F)) << "Seed=" << seed << " program " << i;
+            ASSERT_EQ(cpu.data, ref.data) << "Seed=" << seed << " program " << i;
+        }
+    }
+}
+
+// every forwarding setting x every predictor : hazards, bypasses and misprediction
+// repair may change the cycle count, never the architectural result
+TEST(CPU_Random, PipelineAgainstFunctional) {
+    uint32_t seed = 4043;
+    std::mt19937 rng(seed);
+    const char* predictors[] = {"static", "btfn", "bimodal", "gshare", "tage"};
+
+    for (int i = 0; i < 300; ++i) {
+        const std::vector<Instr> prog = random_program(rng);
+        const std::vector<uint32_t> data = random_memory(rng);
+
+        CPU ref;
+        ref.trace = false;
+        ref.load_program(prog);
+        ref.data = data;
+        uint64_t n_ref = 0;
+        const std::string end_ref = outcome([&] { n_ref = ref.run_functional(instr_budget); });
+        if (end_ref == "CPU timeout") continue; // the pipeline's budget is in cycles
+
+        for (uint32_t f = 0; f < 8; f++) {
+            for (const char* pn : predictors) {
+                Pipeline p;
+                p.fwd = {(f & 1) != 0, (f & 2) != 0, (f & 4) != 0};
+                p.predictor = make_predictor(pn);
+                p.load_program(prog);
+                p.data = data;
+
+                // functional ended within instr_budget instructions (n_ref is not known after a
+                // fault); worst case per instruction : a 3-cycle RAW wait or a 2-cycle misprediction
+                const std::string end = outcome([&] { p.run(8 * instr_budget + 64); });
+                ASSERT_EQ(end, end_ref) << "Seed=" << seed << " program " << i << " fwd " << f << " " << pn;
+                if (!end_ref.empty()) continue;
+                ASSERT_EQ(p.stats().instructions, n_ref) << "Seed=" << seed << " program " << i << " fwd " << f << " " << pn;
+                ASSERT_EQ(p.R, ref.R) << "Seed=" << seed << " program " << i << " fwd " << f << " " << pn;
+                ASSERT_EQ(flag_bits(p.F), flag_bits(ref.F)) << "Seed=" << seed << " program " << i << " fwd " << f << " " << pn;
+                ASSERT_EQ(p.data, ref.data) << "Seed=" << seed << " program " << i << " fwd " << f << " " << pn;
+            }
+        }
+    }
+}
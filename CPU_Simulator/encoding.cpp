@@ -0,0 +1,294 @@
+#include "encoding.h"
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CPU_IMAGE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ---------------- Encoder ----------------
+
+// which fields each opcode uses
+struct Fields{
+    bool rd, rs1, rs2, imm;
+};
+
+static Fields fields_of(IOp op) {
+    switch (op) {
+        case IOp::ADD:
+        case IOp::SUB:
+        case IOp::AND_:
+        case IOp::OR_:
+        case IOp::XOR_: return {true, true, true, false};
+        case IOp::SHL:
+        case IOp::SHR:
+        case IOp::ADDI:
+        case IOp::LW:   return {true, true, false, true};
+        case IOp::CMP:  return {false, true, true, false};
+        case IOp::CMPI: return {false, true, false, true};
+        case IOp::BEQ:
+        case IOp::BNE:
+        case IOp::BLT:  return {false, false, false, true};
+        case IOp::JAL:  return {true, false, false, true};
+        case IOp::SW:   return {false, true, true, true};
+        case IOp::HALT: return {false, false, false, false};
+    }
+    throw std::invalid_argument("encode: invalid opcode");
+}
+
+uint32_t encode(const Instr& in) {
+    const Fields f = fields_of(in.op);
+    auto reg = [](uint32_t r) {
+        if (r > 7) throw std::invalid_argument("encode: register index out of range");
+        return r;
+    };
+
+    uint32_t w = set_bits(0, 31, 27, (uint32_t)in.op);
+    if (f.rd)  w = set_bits(w, 26, 24, reg(in.rd));
+    if (f.rs1) w = set_bits(w, 23, 21, reg(in.rs1));
+    if (f.rs2) w = set_bits(w, 20, 18, reg(in.rs2));
+    if (f.imm) {
+        uint32_t imm = in.imm;
+        if (in.op == IOp::SHL || in.op == IOp::SHR) imm &= 31u;
+        if ((int32_t)imm < imm_min || (int32_t)imm > imm_max)
+            throw std::invalid_argument("encode: immediate out of range");
+        w = set_bits(w, imm_bits - 1, 0, imm);
+    }
+    return w;
+}
+
+std::vector<uint32_t> encode_program(const std::vector<Instr>& program) {
+    std::vector<uint32_t> words;
+    words.reserve(program.size());
+    for (const Instr& in : program) words.push_back(encode(in));
+    return words;
+}
+
+// ---------------- Assembler ----------------
+namespace {
+
+[[noreturn]] void asm_error(size_t line, const std::string& msg) {
+    throw std::runtime_error("asm line " + std::to_string(line) + ": " + msg);
+}
+
+std::string upper(std::string s) {
+    for (char& c : s) c = (char)std::toupper((unsigned char)c);
+    return s;
+}
+
+// operands split on commas, '(' and ')', blanks dropped : "4(R2)" -> "4", "R2"
+std::vector<std::string> split_operands(const std::string& s) {
+    std::vector<std::string> out;
+    std::string cur;
+    auto push = [&] {
+        if (!cur.empty()) out.push_back(cur);
+        cur.clear();
+    };
+    for (char c : s) {
+        if (c == ',' || c == '(' || c == ')') push();
+        else if (!std::isspace((unsigned char)c)) cur += c;
+    }
+    push();
+    return out;
+}
+
+const std::unordered_map<std::string, IOp>& mnemonics() {
+    static const std::unordered_map<std::string, IOp> m = {
+        {"ADD", IOp::ADD},   {"SUB", IOp::SUB},   {"AND", IOp::AND_}, {"OR", IOp::OR_},
+        {"XOR", IOp::XOR_},  {"SHL", IOp::SHL},   {"SHR", IOp::SHR},  {"ADDI", IOp::ADDI},
+        {"CMP", IOp::CMP},   {"CMPI", IOp::CMPI}, {"BEQ", IOp::BEQ},  {"BNE", IOp::BNE},
+        {"BLT", IOp::BLT},   {"JAL", IOp::JAL},   {"LW", IOp::LW},    {"SW", IOp::SW},
+        {"HALT", IOp::HALT},
+    };
+    return m;
+}
+
+struct Line{
+    size_t number;
+    IOp op;
+    std::vector<std::string> args;
+};
+
+} // namespace
+
+std::vector<uint32_t> assemble(const std::string& source) {
+    // pass 1 : labels and instructions
+    std::unordered_map<std::string, uint32_t> labels;
+    std::vector<Line> lines;
+    std::istringstream in(source);
+    std::string text;
+    for (size_t number = 1; std::getline(in, text); number++) {
+        text = text.substr(0, text.find_first_of("#;"));
+
+        size_t colon;
+        while ((colon = text.find(':')) != std::string::npos) {
+            std::istringstream ls(text.substr(0, colon));
+            std::string label, extra;
+            if (!(ls >> label) || (ls >> extra)) asm_error(number, "bad label");
+            if (!labels.emplace(label, (uint32_t)lines.size()).second)
+                asm_error(number, "label " + label + " defined twice");
+            text = text.substr(colon + 1);
+        }
+
+        std::istringstream ts(text);
+        std::string mnemonic;
+        if (!(ts >> mnemonic)) continue; // blank
+        auto it = mnemonics().find(upper(mnemonic));
+        if (it == mnemonics().end()) asm_error(number, "unknown instruction " + mnemonic);
+        std::string rest;
+        std::getline(ts, rest);
+        lines.push_back({number, it->second, split_operands(rest)});
+    }
+
+    // pass 2 : encode
+    std::vector<uint32_t> words;
+    words.reserve(lines.size());
+    for (size_t pc = 0; pc < lines.size(); pc++) {
+        const Line& l = lines[pc];
+        size_t next = 0;
+        auto arg = [&]() -> const std::string& {
+            if (next >= l.args.size()) asm_error(l.number, "missing operand");
+            return l.args[next++];
+        };
+        auto reg = [&]() {
+            const std::string a = upper(arg());
+            if (a.size() != 2 || a[0] != 'R' || a[1] < '0' || a[1] > '7')
+                asm_error(l.number, "expected a register R0..R7, got " + a);
+            return (uint32_t)(a[1] - '0');
+        };
+        auto number = [&](const std::string& a) {
+            try {
+                size_t used = 0;
+                const long long v = std::stoll(a, &used, 0);
+                if (used == a.size() && v >= INT32_MIN && v <= (long long)UINT32_MAX) return (uint32_t)v;
+            } catch (const std::exception&) {
+            }
+            asm_error(l.number, "expected a number, got " + a);
+        };
+        auto target = [&]() { // label or numeric offset
+            const std::string& a = arg();
+            auto it = labels.find(a);
+            if (it != labels.end()) return it->second - (uint32_t)pc;
+            return number(a);
+        };
+
+        Instr ins;
+        ins.op = l.op;
+        switch (l.op) {
+            case IOp::ADD:
+            case IOp::SUB:
+            case IOp::AND_:
+            case IOp::OR_:
+            case IOp::XOR_:
+                ins.rd = reg(); ins.rs1 = reg(); ins.rs2 = reg();
+                break;
+            case IOp::SHL:
+            case IOp::SHR:
+            case IOp::ADDI:
+                ins.rd = reg(); ins.rs1 = reg(); ins.imm = number(arg());
+                break;
+            case IOp::CMP:
+                ins.rs1 = reg(); ins.rs2 = reg();
+                break;
+            case IOp::CMPI:
+                ins.rs1 = reg(); ins.imm = number(arg());
+                break;
+            case IOp::BEQ:
+            case IOp::BNE:
+            case IOp::BLT:
+                ins.imm = target();
+                break;
+            case IOp::JAL:
+                ins.rd = reg(); ins.imm = target();
+                break;
+            case IOp::LW:
+                ins.rd = reg(); ins.imm = number(arg()); ins.rs1 = reg();
+                break;
+            case IOp::SW:
+                ins.rs2 = reg(); ins.imm = number(arg()); ins.rs1 = reg();
+                break;
+            case IOp::HALT:
+                break;
+        }
+        if (next != l.args.size()) asm_error(l.number, "too many operands");
+
+        try {
+            words.push_back(encode(ins));
+        } catch (const std::invalid_argument& e) {
+            asm_error(l.number, e.what());
+        }
+    }
+    return words;
+}
+
+// ---------------- Images ----------------
+void save_image(const std::string& path, const std::vector<uint32_t>& words) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("cannot write " + path);
+    for (uint32_t w : words) {
+        const char b[4] = {(char)(w & 0xFF), (char)((w >> 8) & 0xFF), (char)((w >> 16) & 0xFF), (char)(w >> 24)};
+        out.write(b, 4);
+    }
+    if (!out) throw std::runtime_error("cannot write " + path);
+}
+
+MappedImage::MappedImage(const std::string& path) {
+#ifdef CPU_IMAGE_MMAP
+    // words are used in place : only valid as is on a little-endian host
+    const uint32_t probe = 1;
+    char first;
+    std::memcpy(&first, &probe, 1);
+    if (first == 1) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open " + path);
+        struct stat sb;
+        if (::fstat(fd, &sb) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot stat " + path);
+        }
+        const size_t bytes = (size_t)sb.st_size;
+        if (bytes % 4 != 0) {
+            ::close(fd);
+            throw std::runtime_error(path + ": size is not a whole number of words");
+        }
+        count = bytes / 4;
+        if (bytes != 0) {
+            void* p = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("cannot map " + path);
+            }
+            mapping = p;
+            mapped_bytes = bytes;
+            words = (const uint32_t*)p;
+        }
+        ::close(fd); // the mapping stays valid
+        return;
+    }
+#endif
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("cannot open " + path);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (bytes.size() % 4 != 0) throw std::runtime_error(path + ": size is not a whole number of words");
+    buffer.resize(bytes.size() / 4);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        const unsigned char* b = (const unsigned char*)&bytes[4 * i];
+        buffer[i] = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+    }
+    words = buffer.data();
+    count = buffer.size();
+}
+
+MappedImage::~MappedImage() {
+#ifdef CPU_IMAGE_MMAP
+    if (mapping) ::munmap(mapping, mapped_bytes);
+#endif
+}
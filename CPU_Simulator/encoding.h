@@ -0,0 +1,88 @@
+#pragma once
+#include<cstdint>
+#include<cstddef>
+#include<string>
+#include<vector>
+#include "bit_utils.h" // Bit_utils_library : get_bits / set_bits / sign_extend
+#include "cpu.h"       // Instr, IOp
+
+// 32-bit binary encoding of an Instr. One format for every opcode, so the decoder
+// has no branches. The encoder writes 0 in the fields an opcode does not use
+// (e.g. rs2 of ADDI), so those do not survive a round trip.
+//
+//    31     27 26  24 23  21 20  18 17                  0
+//   +---------+------+------+------+---------------------+
+//   |   op    |  rd  | rs1  | rs2  |        imm          |
+//   +---------+------+------+------+---------------------+
+//
+// op  : IOp value (0..16)
+// imm : signed, -131072..131071. Branch / JAL offsets as in Instr (relative to the
+//       instruction), ADDI / CMPI / LW / SW immediates sign-extended to 32 bits.
+//
+// A program image is these words back to back, little-endian on disk (no header),
+// 4 bytes per instruction against sizeof(Instr) = 20.
+
+constexpr unsigned imm_bits = 18;
+constexpr int32_t imm_min = -(1 << (imm_bits - 1));
+constexpr int32_t imm_max = (1 << (imm_bits - 1)) - 1;
+
+// Throws std::invalid_argument if a field the opcode uses is out of range : register
+// index above 7, imm outside imm_min..imm_max. SHL / SHR keep imm & 31 (what executes).
+uint32_t encode(const Instr& in);
+std::vector<uint32_t> encode_program(const std::vector<Instr>& program);
+
+// No checks : the opcode field must be valid (CPU::load_program checks it once per image).
+inline Instr decode(uint32_t w){
+    Instr in;
+    in.op  = (IOp)get_bits(w, 31, 27);
+    in.rd  = get_bits(w, 26, 24);
+    in.rs1 = get_bits(w, 23, 21);
+    in.rs2 = get_bits(w, 20, 18);
+    in.imm = (uint32_t)sign_extend(get_bits(w, imm_bits - 1, 0), imm_bits);
+    return in;
+}
+
+inline bool valid_opcode(uint32_t w){
+    return get_bits(w, 31, 27) <= (uint32_t)IOp::HALT;
+}
+
+// Assembler : one instruction per line, returns the encoded program.
+//
+//     loop:                      label (own line or before an instruction)
+//     ADD  R3, R1, R2            also SUB AND OR XOR
+//     ADDI R1, R0, -4            also SHL SHR (imm = shift amount)
+//     CMP  R1, R2
+//     CMPI R1, 10
+//     BLT  loop                  also BEQ BNE; a label or a numeric offset
+//     JAL  R7, func
+//     LW   R1, 4(R2)             R1 = data[R2 + 4]
+//     SW   R1, 4(R2)             data[R2 + 4] = R1
+//     HALT
+//
+// '#' or ';' starts a comment. Mnemonics and register names are case-insensitive.
+// Throws std::runtime_error("asm line N: ...") on the first error.
+std::vector<uint32_t> assemble(const std::string& source);
+
+// Writes a program image (raw words).
+void save_image(const std::string& path, const std::vector<uint32_t>& words);
+
+// Read-only view of a program image file. Memory-mapped where mmap exists (POSIX),
+// read into a buffer otherwise. Pass data() / size() to CPU::load_program; the
+// mapping only has to live until then.
+class MappedImage{
+public :
+    explicit MappedImage(const std::string& path); // throws std::runtime_error
+    ~MappedImage();
+    MappedImage(const MappedImage&) = delete;
+    MappedImage& operator=(const MappedImage&) = delete;
+
+    const uint32_t* data() const { return words; }
+    size_t size() const { return count; } // in words
+
+private :
+    const uint32_t* words = nullptr;
+    size_t count = 0;
+    void* mapping = nullptr;     // mmap base, nullptr : buffer used
+    size_t mapped_bytes = 0;
+    std::vector<uint32_t> buffer;
+};
@@ -1,4 +1,10 @@
 #include "cpu.h"
+#include "pipeline.h"
+#include "encoding.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
 
 int main() {
@@ -25,4 +31,202 @@ int main() {
     std::cout << "\nFINAL RESULT\n";
     std::cout << "R3 = " << cpu.R[3] << " (expected 30)\n";
     std::cout << "R4 = " << cpu.R[4] << " (expected 60)\n";
+
+    // Functional mode : same program, same final registers, no per-phase work
+    CPU fast;
+    fast.load_program(program);
+    fast.run_functional();
+    std::cout << "\nFUNCTIONAL MODE\n";
+    std::cout << "R3 = " << fast.R[3] << " R4 = " << fast.R[4]
+              << (fast.R == cpu.R ? " (same as multi-cycle)\n" : " (MISMATCH)\n");
+
+    // Throughput on a long straight-line program
+    std::vector<Instr> long_prog;
+    const uint32_t n = 4000000;
+    long_prog.reserve(n + 1);
+    for (uint32_t i = 0; i < n; i++) {
+        switch (i % 4) {
+            case 0: long_prog.push_back({IOp::ADDI, 1, 1, 0, 3}); break;
+            case 1: long_prog.push_back({IOp::ADD,  2, 2, 1, 0}); break;
+            case 2: long_prog.push_back({IOp::XOR_, 3, 3, 2, 0}); break;
+            case 3: long_prog.push_back({IOp::SHL,  4, 3, 0, 1}); break;
+        }
+    }
+    long_prog.push_back({IOp::HALT, 0, 0, 0, 0});
+
+    const std::vector<uint32_t> long_prog_words = encode_program(long_prog);
+    fast.load_program(long_prog_words);
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t executed = fast.run_functional();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << executed << " instructions in " << s * 1e3 << " ms : "
+              << (double)executed / s / 1e6 << " M instr/s\n";
+
+    // ALU flags : eager computes N/Z/C/V every step, lazy only when flags() is read
+    // (here one step in 1024, like a CMP among arithmetic)
+    std::cout << "\nALU FLAGS (10M steps)\n";
+    for (bool lazy : {false, true}) {
+        ALU a;
+        a.trace_enables = false;
+        a.lazy_flags = lazy;
+        uint32_t sum = 0, carries = 0;
+        auto f0 = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < 10000000; i++) {
+            a.A = i;
+            a.B = sum;
+            a.step((i & 1) ? Opcode::ADD : Opcode::SUB);
+            sum += a.result;
+            if ((i & 1023) == 0) carries += a.flags().C;
+        }
+        double fs = std::chrono::duration<double>(std::chrono::steady_clock::now() - f0).count();
+        std::cout << (lazy ? "lazy  " : "eager ") << 10.0 / fs << " M steps/s (carries " << carries << ")\n";
+    }
+
+    // Translated mode : a hot loop is decoded once into a block, then re-run from the cache
+    const std::vector<uint32_t> loop = assemble(R"(
+            ADDI R1, R0, 0
+            ADDI R5, R0, 78125
+            SHL  R5, R5, 6        # 5000000 : immediates are 18-bit
+    loop:   ADD  R2, R2, R1
+            XOR  R3, R2, R1
+            SHL  R4, R3, 1
+            ADDI R1, R1, 1
+            CMP  R1, R5
+            BLT  loop
+            HALT
+    )");
+    std::cout << "\nTRANSLATED MODE (5M-iteration loop, assembled)\n";
+    CPU interp, jit;
+    interp.load_program(loop);
+    jit.load_program(loop);
+    for (CPU* c : {&interp, &jit}) {
+        auto l0 = std::chrono::steady_clock::now();
+        uint64_t k = (c == &jit) ? c->run_translated() : c->run_functional();
+        double ls = std::chrono::duration<double>(std::chrono::steady_clock::now() - l0).count();
+        std::cout << std::left << std::setw(12) << (c == &jit ? "translated" : "functional") << std::right
+                  << k << " instructions in " << ls * 1e3 << " ms : " << (double)k / ls / 1e6 << " M instr/s\n";
+    }
+    std::cout << "blocks translated : " << jit.translated_blocks()
+              << (jit.R == interp.R ? " (same registers as functional)\n" : " (MISMATCH)\n");
+
+    // Binary images : 4 bytes per instruction, loaded without parsing
+    // written to the temp directory and removed again : 16 MB is not worth keeping
+    const std::string image_path = (std::filesystem::temp_directory_path() / "cpu_sim_program.bin").string();
+    save_image(image_path, long_prog_words);
+    {
+        MappedImage image(image_path);
+        fast.load_program(image.data(), image.size());
+    }
+    std::filesystem::remove(image_path);
+    executed = fast.run_functional();
+    std::cout << "\nBINARY IMAGE\n" << executed << " instructions from " << image_path << " : "
+              << long_prog_words.size() * sizeof(uint32_t) / 1024 << " KiB (as Instr : "
+              << long_prog.size() * sizeof(Instr) / 1024 << " KiB), R4 = " << fast.R[4] << "\n";
+
+    // Pipelined core : same work, two schedules. The chained version uses each
+    // result in the next instruction; the interleaved one runs two chains side by side.
+    std::vector<Instr> chained = {
+        {IOp::ADDI, 1, 0, 0, 1}, {IOp::ADD, 2, 1, 1, 0}, {IOp::ADD, 3, 2, 2, 0}, {IOp::ADD, 4, 3, 3, 0},
+        {IOp::ADDI, 5, 0, 0, 2}, {IOp::ADD, 6, 5, 5, 0}, {IOp::ADD, 7, 6, 6, 0}, {IOp::ADD, 4, 4, 7, 0},
+        {IOp::HALT, 0, 0, 0, 0}
+    };
+    std::vector<Instr> interleaved = {
+        {IOp::ADDI, 1, 0, 0, 1}, {IOp::ADDI, 5, 0, 0, 2}, {IOp::ADD, 2, 1, 1, 0}, {IOp::ADD, 6, 5, 5, 0},
+        {IOp::ADD, 3, 2, 2, 0}, {IOp::ADD, 7, 6, 6, 0}, {IOp::ADD, 4, 3, 3, 0}, {IOp::ADD, 4, 4, 7, 0},
+        {IOp::HALT, 0, 0, 0, 0}
+    };
+    struct { const char* name; Forwarding fwd; } configs[] = {
+        {"full forwarding", {true, true, true}},
+        {"no EX/MEM path ", {false, true, true}},
+        {"regfile only   ", {false, false, true}},
+        {"no forwarding  ", {false, false, false}},
+    };
+
+    std::cout << "\nPIPELINE (IF/ID/EX/MEM/WB)\n";
+    for (auto& c : configs) {
+        for (int k = 0; k < 2; k++) {
+            Pipeline p;
+            p.fwd = c.fwd;
+            p.load_program(k == 0 ? chained : interleaved);
+            const PipelineStats& st = p.run();
+            std::cout << c.name << (k == 0 ? " chained     " : " interleaved ")
+                      << " cycles=" << st.cycles << " CPI=" << st.cpi()
+                      << " stalls: EX=" << st.stall_raw_ex << " MEM=" << st.stall_raw_mem
+                      << " WB=" << st.stall_raw_wb << " flush=" << st.flush_cycles
+                      << " R4=" << p.R[4] << "\n";
+        }
+    }
+
+    // Loop kernels with compares, branches and loads, under each branch predictor.
+    // R0 stays 0. Offsets are relative to the branch.
+    const uint32_t len = 256;
+    auto back = [](int k) { return (uint32_t)-k; };
+    std::vector<Instr> sum_loop = {          // sum of data[0..len), stored at data[len]
+        {IOp::ADDI, 1, 0, 0, 0},
+        {IOp::ADDI, 2, 0, 0, 0},
+        {IOp::LW,   3, 1, 0, 0},             // loop:
+        {IOp::ADD,  2, 2, 3, 0},
+        {IOp::ADDI, 1, 1, 0, 1},
+        {IOp::CMPI, 0, 1, 0, len},
+        {IOp::BLT,  0, 0, 0, back(4)},
+        {IOp::SW,   0, 0, 2, len},
+        {IOp::HALT, 0, 0, 0, 0}
+    };
+    std::vector<Instr> odd_count = {         // how many data[i] are odd : one data-dependent branch
+        {IOp::ADDI, 1, 0, 0, 0},
+        {IOp::ADDI, 2, 0, 0, 0},
+        {IOp::ADDI, 4, 0, 0, 1},
+        {IOp::LW,   3, 1, 0, 0},             // loop:
+        {IOp::AND_, 5, 3, 4, 0},
+        {IOp::CMPI, 0, 5, 0, 0},
+        {IOp::BEQ,  0, 0, 0, 2},
+        {IOp::ADDI, 2, 2, 0, 1},
+        {IOp::ADDI, 1, 1, 0, 1},
+        {IOp::CMPI, 0, 1, 0, len},
+        {IOp::BLT,  0, 0, 0, back(7)},
+        {IOp::HALT, 0, 0, 0, 0}
+    };
+    std::vector<Instr> nested = {            // 64 x 3 iterations : the inner exit repeats every 3 branches
+        {IOp::ADDI, 1, 0, 0, 0},
+        {IOp::ADDI, 2, 0, 0, 0},             // outer:
+        {IOp::ADDI, 3, 3, 0, 1},             // inner:
+        {IOp::ADDI, 2, 2, 0, 1},
+        {IOp::CMPI, 0, 2, 0, 3},
+        {IOp::BLT,  0, 0, 0, back(3)},
+        {IOp::ADDI, 1, 1, 0, 1},
+        {IOp::CMPI, 0, 1, 0, 64},
+        {IOp::BLT,  0, 0, 0, back(7)},
+        {IOp::HALT, 0, 0, 0, 0}
+    };
+
+    std::vector<uint32_t> periodic(len + 1), random(len + 1);
+    uint32_t seed = 12345;
+    for (uint32_t i = 0; i < len; i++) {
+        periodic[i] = (i % 4 == 0) ? 1 : 2;  // odd every 4th
+        seed = seed * 1103515245u + 12345u;
+        random[i] = seed >> 16;
+    }
+
+    struct { const char* name; const std::vector<Instr>* prog; const std::vector<uint32_t>* data; } kernels[] = {
+        {"sum loop           ", &sum_loop, &random},
+        {"odd count, periodic", &odd_count, &periodic},
+        {"odd count, random  ", &odd_count, &random},
+        {"nested 64 x 3      ", &nested, &random},
+    };
+    const char* predictors[] = {"static", "btfn", "bimodal", "gshare", "tage"};
+
+    std::cout << "\nBRANCH PREDICTORS (misprediction = 2 cycles)\n";
+    for (auto& k : kernels) {
+        for (const char* pn : predictors) {
+            Pipeline p;
+            p.predictor = make_predictor(pn);
+            p.data = *k.data;
+            p.load_program(*k.prog);
+            const PipelineStats& st = p.run();
+            std::printf("%s %-17s branches=%4llu accuracy=%5.1f%% penalty=%4llu cycles=%5llu CPI=%.2f\n",
+                        k.name, p.predictor->name().c_str(), (unsigned long long)st.branches,
+                        100.0 * st.accuracy(), (unsigned long long)st.mispredict_cycles,
+                        (unsigned long long)st.cycles, st.cpi());
+        }
+    }
 }
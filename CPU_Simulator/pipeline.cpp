@@ -0,0 +1,247 @@
+#include "pipeline.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+static bool writes_rd(IOp op) {
+    return op != IOp::HALT && op != IOp::CMP && op != IOp::CMPI && op != IOp::SW && !CPU::is_branch(op);
+}
+static bool reads_rs1(IOp op) {
+    return op != IOp::HALT && op != IOp::JAL && !CPU::is_branch(op);
+}
+static bool reads_rs2(IOp op) {
+    return op == IOp::ADD || op == IOp::SUB || op == IOp::AND_ || op == IOp::OR_ || op == IOp::XOR_ ||
+           op == IOp::CMP || op == IOp::SW;
+}
+
+// latch holds an instruction that will write reg
+static bool produces(const bool valid, const Instr& in, uint32_t reg) {
+    return valid && writes_rd(in.op) && in.rd == reg;
+}
+
+// constructor
+Pipeline::Pipeline() : predictor(std::make_unique<StaticPredictor>()) {
+    alu.trace_enables = false;
+    alu.lazy_flags = true; // only CMP / CMPI read them
+    R.fill(0);
+}
+
+void Pipeline::load_program(const std::vector<Instr>& program) {
+    mem = program;
+    R.fill(0);
+    F = Flag{};
+    PC = 0;
+    fetching = true;
+    halted = false;
+    if_id = id_ex = ex_mem = mem_wb = Latch{};
+    st = PipelineStats{};
+}
+
+// Checks the nearest older producer of each source register. It can be in EX (id_ex),
+// MEM (ex_mem) or WB (mem_wb); the instruction in ID may go on if the path that
+// brings that producer's result in time is enabled.
+Pipeline::Stall Pipeline::hazard(const Instr& in) const {
+    auto check = [&](uint32_t reg) {
+        if (produces(id_ex.valid, id_ex.in, reg)) {
+            if (id_ex.in.op == IOp::LW) return Stall::LoadUse;
+            return fwd.ex_mem ? Stall::None : Stall::RawEx;
+        }
+        if (produces(ex_mem.valid, ex_mem.in, reg)) return fwd.mem_wb ? Stall::None : Stall::RawMem;
+        if (produces(mem_wb.valid, mem_wb.in, reg)) return fwd.wb_id ? Stall::None : Stall::RawWb;
+        return Stall::None;
+    };
+    Stall s = Stall::None;
+    if (reads_rs1(in.op)) s = std::max(s, check(in.rs1));
+    if (reads_rs2(in.op)) s = std::max(s, check(in.rs2));
+    return s;
+}
+
+uint32_t& Pipeline::data_word(uint32_t addr) {
+    if (addr >= data.size())
+        throw std::runtime_error("data address out of bounds");
+    return data[addr];
+}
+
+// EX input : the value read in ID, unless an instruction still ahead produces it
+uint32_t Pipeline::operand(uint32_t reg, uint32_t read) const {
+    if (fwd.ex_mem && produces(ex_mem.valid, ex_mem.in, reg)) return ex_mem.value;
+    if (fwd.mem_wb && produces(mem_wb.valid, mem_wb.in, reg)) return mem_wb.value;
+    return read;
+}
+
+void Pipeline::cycle() {
+    st.cycles++;
+    if (trace) trace_cycle();
+
+    // WB (first half of the cycle : ID below reads the new value when wb_id is on)
+    const std::array<uint32_t, 8> before = R;
+    if (mem_wb.valid) {
+        st.instructions++;
+        if (mem_wb.in.op == IOp::HALT) halted = true;
+        else if (writes_rd(mem_wb.in.op)) R[mem_wb.in.rd] = mem_wb.value;
+    }
+    const std::array<uint32_t, 8>& regs = fwd.wb_id ? R : before;
+
+    // MEM
+    Latch next_mem_wb = ex_mem;
+    if (ex_mem.valid && ex_mem.in.op == IOp::LW) next_mem_wb.value = data_word(ex_mem.value);
+    if (ex_mem.valid && ex_mem.in.op == IOp::SW) data_word(ex_mem.value) = ex_mem.b;
+
+    // EX (before ID : a misprediction found here squashes what ID and IF hold)
+    Latch next_ex_mem{};
+    bool redirect = false;
+    uint32_t redirect_pc = 0;
+    if (id_ex.valid) {
+        next_ex_mem = id_ex;
+        const Instr& in = id_ex.in;
+        const uint32_t a = reads_rs1(in.op) ? operand(in.rs1, id_ex.a) : 0;
+        const uint32_t b = reads_rs2(in.op) ? operand(in.rs2, id_ex.b) : 0;
+        switch (in.op) {
+            case IOp::HALT:
+                break;
+            case IOp::ADDI:
+                alu.A = a;
+                alu.B = in.imm;
+                alu.step(Opcode::ADD);
+                next_ex_mem.value = alu.result;
+                break;
+            case IOp::ADD:
+            case IOp::SUB:
+            case IOp::AND_:
+            case IOp::OR_:
+            case IOp::XOR_:
+                alu.A = a;
+                alu.B = b;
+                alu.step(CPU::to_alu(in.op));
+                next_ex_mem.value = alu.result;
+                break;
+            case IOp::SHL:
+            case IOp::SHR:
+                alu.A = a;
+                alu.step(CPU::to_alu(in.op), in.imm);
+                next_ex_mem.value = alu.result;
+                break;
+            case IOp::CMP:
+            case IOp::CMPI:
+                alu.A = a;
+                alu.B = (in.op == IOp::CMP) ? b : in.imm;
+                alu.step(Opcode::SUB);
+                F = alu.flags();
+                break;
+            case IOp::BEQ:
+            case IOp::BNE:
+            case IOp::BLT: {
+                const bool taken = CPU::branch_taken(in.op, F);
+                predictor->update(id_ex.pc, id_ex.pc + in.imm, id_ex.pred, taken);
+                st.branches++;
+                if (taken != id_ex.pred.taken) {
+                    st.mispredictions++;
+                    st.mispredict_cycles += 2;
+                    redirect = true;
+                    redirect_pc = taken ? id_ex.pc + in.imm : id_ex.pc + 1;
+                }
+                break;
+            }
+            case IOp::JAL:
+                next_ex_mem.value = id_ex.pc + 1; // return address
+                break;
+            case IOp::LW:
+                next_ex_mem.value = a + in.imm;
+                break;
+            case IOp::SW:
+                next_ex_mem.value = a + in.imm;
+                next_ex_mem.b = b;
+                break;
+        }
+    }
+
+    if (redirect) {
+        if_id = Latch{};
+        id_ex = Latch{};
+        ex_mem = next_ex_mem;
+        mem_wb = next_mem_wb;
+        PC = redirect_pc;
+        fetching = true; // a HALT on the wrong path does not count
+        return;
+    }
+
+    // ID : hazard check on the latches as they were at the start of the cycle
+    Stall stall = Stall::None;
+    Latch next_id_ex{};
+    bool squash = false;
+    if (if_id.valid) {
+        if (if_id.fault) throw std::runtime_error("PC out of bounds");
+        stall = hazard(if_id.in);
+        if (stall == Stall::None) {
+            next_id_ex = if_id;
+            if (reads_rs1(if_id.in.op)) next_id_ex.a = regs[if_id.in.rs1];
+            if (reads_rs2(if_id.in.op)) next_id_ex.b = regs[if_id.in.rs2];
+            if (if_id.in.op == IOp::HALT) {
+                fetching = false;
+                squash = true; // the instruction fetched behind HALT this cycle
+            }
+        }
+    }
+
+    // IF
+    Latch next_if_id = if_id;
+    if (stall != Stall::None) {
+        if (stall == Stall::RawEx) st.stall_raw_ex++;
+        if (stall == Stall::RawMem) st.stall_raw_mem++;
+        if (stall == Stall::RawWb) st.stall_raw_wb++;
+        if (stall == Stall::LoadUse) st.stall_load_use++;
+    } else if (squash) {
+        st.flush_cycles++;
+        next_if_id = Latch{};
+    } else if (fetching) {
+        next_if_id = Latch{};
+        next_if_id.valid = true;
+        next_if_id.pc = PC;
+        if (PC < mem.size()) {
+            const Instr& in = mem[PC];
+            next_if_id.in = in;
+            if (CPU::is_branch(in.op)) {
+                next_if_id.pred = predictor->predict(PC, PC + in.imm);
+                PC = next_if_id.pred.taken ? PC + in.imm : PC + 1;
+            } else if (in.op == IOp::JAL) {
+                PC = PC + in.imm;
+            } else {
+                PC++;
+            }
+        } else {
+            next_if_id.fault = true; // only an error if it reaches ID
+            PC++;
+        }
+    } else {
+        next_if_id = Latch{};
+    }
+
+    if_id = next_if_id;
+    id_ex = next_id_ex;
+    ex_mem = next_ex_mem;
+    mem_wb = next_mem_wb;
+}
+
+const PipelineStats& Pipeline::run(uint64_t max_cycles) {
+    for (uint64_t i = 0; i < max_cycles; ++i) {
+        if (halted) return st;
+        cycle();
+    }
+    if (halted) return st;
+    throw std::runtime_error("CPU timeout");
+}
+
+void Pipeline::trace_cycle() const {
+    auto show = [](const char* stage, const Latch& l) {
+        std::cout << " | " << stage << " " << std::left << std::setw(5)
+                  << (!l.valid ? "--" : l.fault ? "??" : CPU::iop_name(l.in.op)) << std::right;
+    };
+    // stage contents at the start of the cycle
+    std::cout << "C" << std::setw(4) << st.cycles << " PC=" << std::setw(3) << PC;
+    show("ID", if_id);
+    show("EX", id_ex);
+    show("MEM", ex_mem);
+    show("WB", mem_wb);
+    std::cout << "\n";
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include<cstdint>
+#include "alu.h"
+#include "cpu.h" // Instr, IOp
+#include "branch_predictor.h"
+#include<array>
+#include<memory>
+#include<vector>
+
+// Five-stage pipelined core : IF -> ID -> EX -> MEM -> WB, one instruction per stage.
+// Same ISA, same registers and same ALU as CPU, but instructions overlap, so the
+// interesting output is not only the final registers but how many cycles it took.
+//
+// Registers are read in ID and written in WB. An instruction in ID that needs a
+// register still being produced further down (RAW hazard) waits in ID, with a
+// bubble sent into EX, until one of the enabled forwarding paths can give it the value.
+// LW produces its value in MEM, so the instruction right behind it waits at least once.
+//
+// Control flow : IF predicts BEQ/BNE/BLT with the branch predictor and follows JAL
+// (offsets are direct, so the target is known at fetch). Branches resolve in EX,
+// where CMP/CMPI leave the flags; a misprediction squashes IF and ID (2 cycles).
+
+// Which forwarding (bypass) paths exist. All on is the classic 5-stage pipeline, all off
+// means waiting for the register file.
+struct Forwarding{
+    bool ex_mem = true; // EX/MEM latch -> EX input : result of the instruction just ahead
+    bool mem_wb = true; // MEM/WB latch -> EX input : result of the instruction two ahead
+    bool wb_id  = true; // register file written in the first half of the cycle, read in the second
+};
+
+struct PipelineStats{
+    uint64_t cycles = 0;
+    uint64_t instructions = 0; // retired, HALT included
+
+    // stall cycles by cause : where the producer of the missing register was
+    uint64_t stall_raw_ex  = 0; // in EX  (no ex_mem path)
+    uint64_t stall_raw_mem = 0; // in MEM (no mem_wb path)
+    uint64_t stall_raw_wb  = 0; // in WB  (no wb_id path)
+    uint64_t stall_load_use = 0; // LW in EX, its value only comes out of MEM
+
+    uint64_t flush_cycles = 0; // fetched instructions squashed after HALT
+
+    // conditional branches
+    uint64_t branches = 0;
+    uint64_t mispredictions = 0;
+    uint64_t mispredict_cycles = 0; // penalty : IF and ID squashed per misprediction
+
+    uint64_t stall_cycles() const { return stall_raw_ex + stall_raw_mem + stall_raw_wb + stall_load_use; }
+    double cpi() const { return instructions ? (double)cycles / (double)instructions : 0.0; }
+    double accuracy() const { return branches ? 1.0 - (double)mispredictions / (double)branches : 1.0; }
+};
+
+class Pipeline{
+public :
+    Pipeline();
+
+    void load_program(const std::vector<Instr>& program);
+
+    // Runs until HALT leaves WB. Throws std::runtime_error("PC out of bounds") if an
+    // instruction past the end of the program reaches ID, "CPU timeout" after max_cycles.
+    const PipelineStats& run(uint64_t max_cycles = 1000000);
+
+    Forwarding fwd;
+    bool trace = false; // one line per cycle : what each stage holds
+    std::array<uint32_t, 8> R{};
+    Flag F{};                        // set by CMP / CMPI in EX
+    std::vector<uint32_t> data;      // data memory, as CPU::data
+    std::unique_ptr<BranchPredictor> predictor; // default : static not taken
+
+    const PipelineStats& stats() const { return st; }
+
+private :
+    // pipeline latch, named after the stage that fills it
+    struct Latch{
+        bool valid = false;   // false : bubble
+        bool fault = false;   // fetched past the end of the program
+        Instr in{};
+        uint32_t pc = 0;
+        Prediction pred{};     // conditional branches
+        uint32_t a = 0, b = 0; // operands read in ID
+        uint32_t value = 0;    // result, from EX on (LW : address until MEM)
+    };
+
+    uint32_t PC = 0;
+    bool fetching = true; // off once HALT is decoded
+    bool halted = false;
+
+    Latch if_id, id_ex, ex_mem, mem_wb;
+
+    std::vector<Instr> mem;
+    ALU alu;
+    PipelineStats st;
+
+    // RAW hazard in ID, by where the producer is; in order of how long the wait is
+    enum class Stall : uint8_t { None, RawWb, RawMem, LoadUse, RawEx };
+
+    void cycle();
+    Stall hazard(const Instr& in) const;
+    uint32_t operand(uint32_t reg, uint32_t read) const;
+    uint32_t& data_word(uint32_t addr);
+    void trace_cycle() const;
+};
@@ -0,0 +1,138 @@
+#include "cpu.h"
+#include "encoding.h"
+#include <stdexcept>
+
+// Basic-block translation for CPU::run_translated.
+// Each handler does one instruction with everything it needs already in its Op,
+// so running a block is a loop of indirect calls with no decoding.
+
+struct CPU::Handlers{
+    static void addi(CPU& c, const Op& o) { c.R[o.rd] = c.R[o.rs1] + o.imm; }
+    static void add (CPU& c, const Op& o) { c.R[o.rd] = c.R[o.rs1] + c.R[o.rs2]; }
+    static void sub (CPU& c, const Op& o) { c.R[o.rd] = c.R[o.rs1] - c.R[o.rs2]; }
+    static void and_(CPU& c, const Op& o) { c.R[o.rd] = c.R[o.rs1] & c.R[o.rs2]; }
+    static void or_ (CPU& c, const Op& o) { c.R[o.rd] = c.R[o.rs1] | c.R[o.rs2]; }
+    static void xor_(CPU& c, const Op& o) { c.R[o.rd] = c.R[o.rs1] ^ c.R[o.rs2]; }
+    static void shl (CPU& c, const Op& o) { c.R[o.rd] = c.R[o.rs1] << o.imm; } // imm already & 31
+    static void shr (CPU& c, const Op& o) { c.R[o.rd] = c.R[o.rs1] >> o.imm; }
+
+    // flags come from the ALU, exactly as in the other modes
+    static void cmp(CPU& c, const Op& o) {
+        c.alu.A = c.R[o.rs1];
+        c.alu.B = c.R[o.rs2];
+        c.alu.step(Opcode::SUB);
+        c.F = c.alu.flags();
+    }
+    static void cmpi(CPU& c, const Op& o) {
+        c.alu.A = c.R[o.rs1];
+        c.alu.B = o.imm;
+        c.alu.step(Opcode::SUB);
+        c.F = c.alu.flags();
+    }
+
+    static void lw(CPU& c, const Op& o) { c.R[o.rd] = c.data_word(c.R[o.rs1] + o.imm); }
+    static void sw(CPU& c, const Op& o) { c.data_word(c.R[o.rs1] + o.imm) = c.R[o.rs2]; }
+};
+
+static bool ends_block(IOp op) {
+    return CPU::is_branch(op) || op == IOp::JAL || op == IOp::HALT;
+}
+
+const CPU::Block& CPU::translate(uint32_t pc) {
+    Block b;
+    b.start = pc;
+    for (uint32_t a = pc; a < mem.size(); a++) {
+        const Instr in = decode(mem[a]); // decoded once, here
+        if (ends_block(in.op)) {
+            b.ends = true;
+            b.end = in;
+            break;
+        }
+
+        Op o{nullptr, (uint8_t)in.rd, (uint8_t)in.rs1, (uint8_t)in.rs2, in.imm};
+        switch (in.op) {
+            case IOp::ADDI: o.fn = &Handlers::addi; break;
+            case IOp::ADD:  o.fn = &Handlers::add;  break;
+            case IOp::SUB:  o.fn = &Handlers::sub;  break;
+            case IOp::AND_: o.fn = &Handlers::and_; break;
+            case IOp::OR_:  o.fn = &Handlers::or_;  break;
+            case IOp::XOR_: o.fn = &Handlers::xor_; break;
+            case IOp::SHL:  o.fn = &Handlers::shl; o.imm &= 31u; break;
+            case IOp::SHR:  o.fn = &Handlers::shr; o.imm &= 31u; break;
+            case IOp::CMP:  o.fn = &Handlers::cmp;  break;
+            case IOp::CMPI: o.fn = &Handlers::cmpi; break;
+            case IOp::LW:   o.fn = &Handlers::lw;   break;
+            case IOp::SW:   o.fn = &Handlers::sw;   break;
+            default:
+                throw std::runtime_error("translate: unexpected opcode");
+        }
+        b.body.push_back(o);
+    }
+
+    block_at[pc] = (int32_t)blocks.size();
+    blocks.push_back(std::move(b));
+    return blocks.back();
+}
+
+uint64_t CPU::run_translated(uint64_t max_instrs) {
+    if (phase == Phase::HALTED) return 0;
+    if (phase != Phase::FETCH1)
+        throw std::runtime_error("run_translated: CPU is in the middle of an instruction");
+
+    const uint32_t n = (uint32_t)mem.size();
+    uint64_t executed = 0;
+
+    for (;;) {
+        if (PC >= n) throw std::runtime_error("PC out of bounds");
+        const int32_t id = block_at[PC];
+        const Block& b = (id >= 0) ? blocks[id] : translate(PC);
+        const uint64_t len = b.body.size() + (b.ends ? 1 : 0);
+
+        if (max_instrs - executed < len) {
+            // not enough budget left for the whole block : finish one by one
+            while (executed < max_instrs) {
+                if (PC >= n) throw std::runtime_error("PC out of bounds");
+                const Instr in = decode(mem[PC++]);
+                executed++;
+                if (in.op == IOp::HALT) {
+                    MAR = PC - 1;
+                    MDR = IR = mem[MAR];
+                    dec = in;
+                    phase = Phase::HALTED;
+                    return executed;
+                }
+                execute(in);
+            }
+            throw std::runtime_error("CPU timeout");
+        }
+
+        const Op* op = b.body.data();
+        const Op* last = op + b.body.size();
+        try {
+            for (; op != last; ++op) op->fn(*this, *op);
+        } catch (...) {
+            PC = b.start + (uint32_t)(op - b.body.data()) + 1; // as run_functional leaves it
+            throw;
+        }
+        executed += len;
+        PC = b.start + (uint32_t)b.body.size() + (b.ends ? 1 : 0);
+        if (!b.ends) continue; // fell into the end of the program : PC out of bounds next
+
+        const Instr& in = b.end;
+        switch (in.op) {
+            case IOp::HALT:
+                MAR = PC - 1;
+                MDR = IR = mem[MAR];
+                dec = in;
+                phase = Phase::HALTED;
+                return executed;
+            case IOp::JAL:
+                R[in.rd] = PC;
+                PC = PC - 1 + in.imm;
+                break;
+            default: // BEQ / BNE / BLT
+                if (branch_taken(in.op, F)) PC = PC - 1 + in.imm;
+                break;
+        }
+    }
+}
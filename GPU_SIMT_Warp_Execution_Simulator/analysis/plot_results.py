@@ -1,8 +1,11 @@
 
 import csv
+import os
 from collections import defaultdict
 import matplotlib.pyplot as plt
 
+from results_table import read_rows
+
 
 # ---------------- CSV loading ----------------
 def read_csv(path: str):
@@ -13,9 +16,21 @@ def read_csv(path: str):
             # numeric conversions
             int_fields = ["N", "n_warps", "warp_cycles", "active_lane_cycles",
                           "mem_lane_ops", "divergent_branches", "reconverges"]
+            for k in ["mem_transactions", "atomic_lane_ops",
+                      "atomic_serial_depth", "atomic_conflict_cycles",
+                      "shfl_lane_ops", "vote_ops", "reduce_ops", "compactions",
+                      "shared_lane_ops", "bank_conflict_cycles", "barriers", "barrier_stall_cycles",
+                      "l1_hits", "l1_misses", "l1_evictions", "l2_hits", "l2_misses", "l2_evictions"]:
+                row[k] = int(row.get(k) or 0)
             float_fields = ["div_ratio", "param", "utilization",
                             "cycles_per_warp", "cycles_per_thread", "memops_per_cycle"]
 
+            # results written before warp width became a parameter are all 32-wide
+            row["warp_width"] = int(row.get("warp_width") or 32)
+            # ... and before multi-SM launches, every run was one SM
+            row["n_sms"] = int(row.get("n_sms") or 1)
+            row["elapsed_cycles"] = int(row.get("elapsed_cycles") or row["warp_cycles"])
+
             for k in int_fields:
                 row[k] = int(float(row[k])) 
             for k in float_fields:
@@ -25,7 +40,14 @@ def read_csv(path: str):
     return rows
 
 
-rows = read_csv("results.csv")
+# results.smrt (columnar, already typed) when main_analysis wrote one, else the CSV export
+if os.path.exists("results.smrt"):
+    all_rows = read_rows("results.smrt")
+else:
+    all_rows = read_csv("results.csv")
+
+# The per-workload figures use the default 32-lane warp; width is plotted separately
+rows = [r for r in all_rows if r["warp_width"] == 32]
 
 # Group by workload
 by_workload = defaultdict(list)
@@ -38,6 +60,11 @@ workload_colors = {
     "nested_div":    "tab:purple",
     "compute_heavy": "tab:green",
     "memory_heavy":  "tab:red",
+    "gather_stride": "tab:orange",
+    "histogram":     "tab:brown",
+    "reduce_mem":    "tab:gray",
+    "reduce_shfl":   "tab:olive",
+    "reduce_warp":   "tab:cyan",
 }
 
 # In case some workloads are missing, only plot those that exist
@@ -143,9 +170,257 @@ if "memory_heavy" in by_workload:
     plt.tight_layout()
     plt.savefig("memory_scaling.png", dpi=200)
 
+# ---------------- Figure 4: Warp width ----------------
+widths = sorted(set(r["warp_width"] for r in all_rows))
+if len(widths) > 1:
+    fig, axes = plt.subplots(1, 2, figsize=(12, 5))
+    fig.suptitle("Warp width (largest N per workload)", fontsize=14)
+
+    for w in available_workloads:
+        pts = [r for r in all_rows if r["workload"] == w]
+        n_max = max(r["N"] for r in pts)
+        pts = [r for r in pts if r["N"] == n_max]
+
+        xs, util, cost = [], [], []
+        for width in widths:
+            sel = [r for r in pts if r["warp_width"] == width]
+            if not sel:
+                continue
+            xs.append(width)
+            util.append(sum(r["utilization"] for r in sel) / len(sel))
+            cost.append(sum(r["cycles_per_thread"] for r in sel) / len(sel))
+
+        axes[0].plot(xs, util, marker="o", label=w, color=workload_colors[w])
+        axes[1].plot(xs, cost, marker="o", label=w, color=workload_colors[w])
+
+    axes[0].set_title("Mean utilization vs warp width")
+    axes[0].set_ylabel("utilization")
+    axes[1].set_title("Mean cost per thread vs warp width")
+    axes[1].set_ylabel("cycles_per_thread")
+    for ax in axes:
+        ax.set_xlabel("warp width (lanes)")
+        ax.set_xticks(widths)
+        ax.grid(True)
+        ax.legend()
+
+    plt.tight_layout(rect=[0, 0, 1, 0.94])
+    plt.savefig("warp_width_scaling.png", dpi=200)
+
+# ---------------- Figure 5: Gather coalescing ----------------
+if "gather_stride" in by_workload:
+    gs = sorted(by_workload["gather_stride"], key=lambda x: (x["N"], x["param"]))
+    Ns = sorted(set(r["N"] for r in gs))
+
+    plt.figure(figsize=(9, 5))
+    for N in Ns:
+        pts = [r for r in gs if r["N"] == N]
+        xs = [r["param"] for r in pts]                                     # stride
+        ys = [r["mem_transactions"] / max(r["mem_lane_ops"], 1) for r in pts]
+        plt.plot(xs, ys, marker="o", label=f"N={N}")
+
+    plt.title("Gather: memory transactions per lane access vs stride")
+    plt.xlabel("stride (scale)")
+    plt.xscale("log", base=2)
+    plt.ylabel("transactions / mem_lane_ops")
+    plt.grid(True)
+    plt.legend()
+    plt.tight_layout()
+    plt.savefig("gather_coalescing.png", dpi=200)
+
+# ---------------- Figure 6: Atomic contention ----------------
+if "histogram" in by_workload:
+    hs = sorted(by_workload["histogram"], key=lambda x: (x["N"], x["param"]))
+    Ns = sorted(set(r["N"] for r in hs))
+
+    plt.figure(figsize=(9, 5))
+    for N in Ns:
+        pts = [r for r in hs if r["N"] == N]
+        xs = [r["param"] for r in pts]   # bins
+        ys = [(r["warp_cycles"] + r["atomic_conflict_cycles"]) / r["N"] for r in pts]
+        plt.plot(xs, ys, marker="o", label=f"N={N}")
+
+    plt.title("Histogram: contention-aware cycles per thread vs bins")
+    plt.xlabel("bins (param)")
+    plt.xscale("log", base=2)
+    plt.ylabel("(warp_cycles + atomic_conflict_cycles) / N")
+    plt.grid(True)
+    plt.legend()
+    plt.tight_layout()
+    plt.savefig("atomic_contention.png", dpi=200)
+
+# ---------------- Figure 7: Reductions (memory vs shuffle vs RED_ADD) ----------------
+reduce_kinds = [w for w in ["reduce_mem", "reduce_shfl", "reduce_warp"] if w in by_workload]
+if reduce_kinds:
+    fig, axes = plt.subplots(1, 2, figsize=(12, 5))
+    fig.suptitle("Warp reduction: memory vs shuffle vs RED_ADD", fontsize=14)
+    for w in reduce_kinds:
+        pts = sorted(by_workload[w], key=lambda x: x["N"])
+        xs = [r["N"] for r in pts]
+        axes[0].plot(xs, [r["cycles_per_warp"] for r in pts], marker="o", label=w, color=workload_colors[w])
+        axes[1].plot(xs, [r["mem_lane_ops"] for r in pts], marker="o", label=w, color=workload_colors[w])
+    axes[0].set_title("cycles per warp")
+    axes[0].set_ylabel("cycles_per_warp")
+    axes[1].set_title("memory lane ops")
+    axes[1].set_ylabel("mem_lane_ops")
+    for ax in axes:
+        ax.set_xlabel("N (threads)")
+        ax.grid(True)
+        ax.legend()
+    plt.tight_layout(rect=[0, 0, 1, 0.94])
+    plt.savefig("reduction_compare.png", dpi=200)
+
+# ---------------- Figure 8: If-conversion (branchy vs predicated) ----------------
+if "branch_body" in by_workload and "branch_body_ifc" in by_workload:
+    N = max(r["N"] for r in by_workload["branch_body"])
+    branchy = {(r["param"], r["div_ratio"]): r for r in by_workload["branch_body"] if r["N"] == N}
+    pred = {(r["param"], r["div_ratio"]): r for r in by_workload["branch_body_ifc"] if r["N"] == N}
+    bodies = sorted(set(k[0] for k in branchy))
+
+    fig, axes = plt.subplots(1, 2, figsize=(12, 5))
+    fig.suptitle(f"If-conversion: predicated vs branchy (N={N})", fontsize=14)
+    for body in bodies:
+        keys = sorted(k for k in branchy if k[0] == body and k in pred)
+        xs = [k[1] for k in keys]
+        axes[0].plot(xs, [pred[k]["warp_cycles"] / branchy[k]["warp_cycles"] for k in keys],
+                     marker="o", label=f"body={int(body)}")
+        axes[1].plot(xs, [branchy[k]["utilization"] for k in keys], marker="o", label=f"body={int(body)}")
+    axes[0].axhline(1.0, color="black", linewidth=0.8)
+    axes[0].set_title("warp cycles, predicated / branchy (< 1 : predication wins)")
+    axes[0].set_ylabel("cycle ratio")
+    axes[1].set_title("branchy utilization (predicated is 1.0)")
+    axes[1].set_ylabel("utilization")
+    for ax in axes:
+        ax.set_xlabel("div_ratio")
+        ax.grid(True)
+        ax.legend()
+    plt.tight_layout(rect=[0, 0, 1, 0.94])
+    plt.savefig("if_conversion.png", dpi=200)
+
+# ---------------- Figure 9: Thread-block compaction ----------------
+tbc_bases = [w for w in ["branch_div", "branch_rand"] if w + "_tbc" in by_workload]
+if tbc_bases:
+    N = max(r["N"] for r in by_workload[tbc_bases[0]])
+    fig, axes = plt.subplots(1, len(tbc_bases), figsize=(6 * len(tbc_bases), 5), squeeze=False)
+    fig.suptitle(f"Thread-block compaction: warp cycles vs div_ratio (N={N})", fontsize=14)
+    for ax, base in zip(axes[0], tbc_bases):
+        for sfx, label in [("", "SIMT stack"), ("_tbc", "lane-aligned"), ("_tbc_ideal", "ideal")]:
+            pts = sorted((r for r in by_workload.get(base + sfx, []) if r["N"] == N), key=lambda x: x["div_ratio"])
+            ax.plot([r["div_ratio"] for r in pts], [r["warp_cycles"] for r in pts], marker="o", label=label)
+        ax.set_title(base)
+        ax.set_xlabel("div_ratio")
+        ax.set_ylabel("warp_cycles")
+        ax.grid(True)
+        ax.legend()
+    plt.tight_layout(rect=[0, 0, 1, 0.94])
+    plt.savefig("compaction.png", dpi=200)
+
+# ---------------- Figure 10: Multi-SM scaling ----------------
+if "sm_scaling" in by_workload:
+    ss = by_workload["sm_scaling"]
+    plt.figure(figsize=(9, 5))
+    for N in sorted(set(r["N"] for r in ss)):
+        pts = sorted((r for r in ss if r["N"] == N), key=lambda x: x["n_sms"])
+        one = pts[0]["elapsed_cycles"]
+        plt.plot([r["n_sms"] for r in pts], [one / r["elapsed_cycles"] for r in pts], marker="o", label=f"N={N}")
+    top = max(r["n_sms"] for r in ss)
+    plt.plot([1, top], [1, top], linestyle="--", color="gray", label="linear")
+    plt.title("Multi-SM: speedup of elapsed cycles vs SM count")
+    plt.xlabel("SMs")
+    plt.xscale("log", base=2)
+    plt.yscale("log", base=2)
+    plt.ylabel("elapsed_cycles(1 SM) / elapsed_cycles")
+    plt.grid(True)
+    plt.legend()
+    plt.tight_layout()
+    plt.savefig("sm_scaling.png", dpi=200)
+
+# ---------------- Figure 11: Shared memory banks and barrier stalls ----------------
+if "shared_stride" in by_workload or "barrier_skew" in by_workload:
+    fig, axes = plt.subplots(1, 2, figsize=(12, 5))
+    fig.suptitle("Shared memory: bank conflicts and BAR_SYNC stalls", fontsize=14)
+    for N in sorted(set(r["N"] for r in by_workload.get("shared_stride", []))):
+        pts = sorted((r for r in by_workload["shared_stride"] if r["N"] == N), key=lambda x: x["param"])
+        axes[0].plot([r["param"] for r in pts],
+                     [r["bank_conflict_cycles"] / max(r["shared_lane_ops"], 1) * r["warp_width"] for r in pts],
+                     marker="o", label=f"N={N}")
+    axes[0].set_title("extra passes per warp access vs stride")
+    axes[0].set_xlabel("stride")
+    axes[0].set_xscale("log", base=2)
+    axes[0].set_ylabel("bank_conflict_cycles per warp access")
+    for N in sorted(set(r["N"] for r in by_workload.get("barrier_skew", []))):
+        pts = sorted((r for r in by_workload["barrier_skew"] if r["N"] == N), key=lambda x: x["param"])
+        axes[1].plot([r["param"] for r in pts], [r["barrier_stall_cycles"] / r["warp_cycles"] for r in pts],
+                     marker="o", label=f"N={N}")
+    axes[1].set_title("parked warp-rounds per warp cycle vs skew")
+    axes[1].set_xlabel("extra VADDs before BAR_SYNC (first warp)")
+    axes[1].set_ylabel("barrier_stall_cycles / warp_cycles")
+    for ax in axes:
+        ax.grid(True)
+        ax.legend()
+    plt.tight_layout(rect=[0, 0, 1, 0.94])
+    plt.savefig("shared_memory.png", dpi=200)
+
+# ---------------- Figure 12: Streams (copy / compute overlap) ----------------
+if "streams" in by_workload:
+    st = by_workload["streams"]
+    plt.figure(figsize=(9, 5))
+    for w in sorted(set(r["warp_width"] for r in st)):
+        pts = sorted((r for r in st if r["warp_width"] == w), key=lambda x: x["param"])
+        one = pts[0]["elapsed_cycles"]
+        plt.plot([r["param"] for r in pts], [one / r["elapsed_cycles"] for r in pts], marker="o", label=f"W={w}")
+    plt.title("Streams: speedup of makespan vs number of streams (chunks)")
+    plt.xlabel("streams")
+    plt.xscale("log", base=2)
+    plt.ylabel("elapsed_cycles(1 stream) / elapsed_cycles")
+    plt.grid(True)
+    plt.legend()
+    plt.tight_layout()
+    plt.savefig("streams.png", dpi=200)
+
+# ---------------- Figure 13: Cache hit rates ----------------
+has_cache = any(r["l1_hits"] + r["l1_misses"] + r["l2_hits"] + r["l2_misses"] > 0
+                for r in by_workload.get("memory_heavy", []))
+if has_cache:
+    mh = by_workload["memory_heavy"]
+    fig, axes = plt.subplots(1, 2, figsize=(12, 5))
+    fig.suptitle("Memory-heavy: cache hit rate vs LD/ST pairs", fontsize=14)
+    for ax, lvl in zip(axes, ["l1", "l2"]):
+        for N in sorted(set(r["N"] for r in mh)):
+            pts = sorted((r for r in mh if r["N"] == N), key=lambda x: x["param"])
+            ax.plot([r["param"] for r in pts],
+                    [r[lvl + "_hits"] / max(r[lvl + "_hits"] + r[lvl + "_misses"], 1) for r in pts],
+                    marker="o", label=f"N={N}")
+        ax.set_title(lvl.upper())
+        ax.set_xlabel("LD/ST pairs (param)")
+        ax.set_ylabel("hit rate")
+        ax.grid(True)
+        ax.legend()
+    plt.tight_layout(rect=[0, 0, 1, 0.94])
+    plt.savefig("cache_hits.png", dpi=200)
+
 print("Saved:")
 print(" - simt_all_in_one.png")
 if "compute_heavy" in by_workload:
     print(" - compute_scaling.png")
 if "memory_heavy" in by_workload:
     print(" - memory_scaling.png")
+if len(widths) > 1:
+    print(" - warp_width_scaling.png")
+if "gather_stride" in by_workload:
+    print(" - gather_coalescing.png")
+if "histogram" in by_workload:
+    print(" - atomic_contention.png")
+if reduce_kinds:
+    print(" - reduction_compare.png")
+if "branch_body_ifc" in by_workload:
+    print(" - if_conversion.png")
+if tbc_bases:
+    print(" - compaction.png")
+if "sm_scaling" in by_workload:
+    print(" - sm_scaling.png")
+if "shared_stride" in by_workload or "barrier_skew" in by_workload:
+    print(" - shared_memory.png")
+if "streams" in by_workload:
+    print(" - streams.png")
+if has_cache:
+    print(" - cache_hits.png")
@@ -0,0 +1,95 @@
+"""Reader for results.smrt, the columnar results table (src/results_table.h).
+
+    from results_table import read_table, read_rows
+    cols = read_table("results.smrt")   # {"workload": [...], "N": array('I'), ...}
+    rows = read_rows("results.smrt")    # [{"workload": "branch_div", "N": 48, ...}, ...]
+
+Column values are read straight into array.array (no text parsing).
+A chunk cut short at the end of the file is ignored.
+"""
+import struct
+import sys
+from array import array
+
+MAGIC = b"SMRT"
+VERSION = 1
+
+# column type -> array typecode
+TYPECODES = {0: "I", 1: "Q", 2: "d", 3: "I"}
+DICT = 3
+
+for code in set(TYPECODES.values()):
+    assert array(code).itemsize == (8 if code in "Qd" else 4), "unexpected C type sizes"
+
+
+def _columns(data):
+    if data[:4] != MAGIC:
+        raise ValueError("not a results table")
+    version, n_cols = struct.unpack_from("<II", data, 4)
+    if version != VERSION:
+        raise ValueError(f"unsupported results table version {version}")
+    pos = 12
+    cols = []
+    for _ in range(n_cols):
+        ctype, name_len = struct.unpack_from("<BH", data, pos)
+        pos += 3
+        cols.append((data[pos:pos + name_len].decode(), ctype))
+        pos += name_len
+    return cols, pos
+
+
+def read_table(path):
+    """Column name -> values; Dict columns come back as lists of names."""
+    with open(path, "rb") as f:
+        data = f.read()
+    cols, pos = _columns(data)
+    out = {name: array(TYPECODES[ctype]) for name, ctype in cols}
+    names = []
+
+    while pos + 8 <= len(data):
+        (size,) = struct.unpack_from("<Q", data, pos)
+        end = pos + 8 + size
+        if end > len(data):
+            break                      # partial chunk
+        n_rows, n_names = struct.unpack_from("<II", data, pos + 8)
+        pos += 16
+        for _ in range(n_names):
+            (name_len,) = struct.unpack_from("<H", data, pos)
+            names.append(data[pos + 2:pos + 2 + name_len].decode())
+            pos += 2 + name_len
+        for name, ctype in cols:
+            a = out[name]
+            n_bytes = n_rows * a.itemsize
+            a.frombytes(data[pos:pos + n_bytes])
+            pos += n_bytes
+        if pos != end:
+            raise ValueError("corrupt chunk")
+
+    if sys.byteorder != "little":
+        for a in out.values():
+            a.byteswap()
+    for name, ctype in cols:
+        if ctype == DICT:
+            out[name] = [names[i] for i in out[name]]
+    return out
+
+
+def read_rows(path):
+    """One dict per row, like csv.DictReader after numeric conversion."""
+    cols = read_table(path)
+    keys = list(cols)
+    values = [cols[k].tolist() if isinstance(cols[k], array) else cols[k] for k in keys]
+    return [dict(zip(keys, row)) for row in zip(*values)]
+
+
+if __name__ == "__main__":
+    path = sys.argv[1] if len(sys.argv) > 1 else "results.smrt"
+    cols = read_table(path)
+    n = len(next(iter(cols.values()))) if cols else 0
+    print(f"{path}: {n} rows, {len(cols)} columns")
+    if "workload" in cols:
+        counts = {}
+        for w in cols["workload"]:
+            counts[w] = counts.get(w, 0) + 1
+        for w, c in sorted(counts.items()):
+            print(f"  {w}: {c}")
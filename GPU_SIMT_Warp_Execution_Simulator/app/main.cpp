@@ -5,7 +5,7 @@
 static void print_metrics(const Metrics& m) {
     double util = 0.0;
     if (m.warp_cycles > 0) {
-        util = (double)m.active_lane_cycles / (double)(m.warp_cycles * 32ull);
+        util = (double)m.active_lane_cycles / (double)(m.warp_cycles * (uint64_t)m.warp_width);
     }
 
     std::cout << "\n--- Metrics ---\n";
@@ -1,25 +1,36 @@
 #include "model.h"
+#include "stream.h"
+#include "mem_trace.h"
+#include "result_cache.h"
+#include "results_table.h"
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <cmath>
+#include <cstring>
 
 // ---------------- helpers ----------------
 static uint32_t ceil_div(uint32_t a, uint32_t b) { return (a + b - 1) / b; }
 
 static double utilization_from(const Metrics& m) {
     if (m.warp_cycles == 0) return 0.0;
-    return (double)m.active_lane_cycles / (double)(m.warp_cycles * 32ull);
+    return (double)m.active_lane_cycles / (double)(m.warp_cycles * (uint64_t)m.warp_width);
 }
 
 static void write_csv_header(std::ofstream& out) {
-    out << "workload,N,n_warps,div_ratio,param,"
+    out << "workload,N,warp_width,n_warps,div_ratio,param,"
         << "warp_cycles,active_lane_cycles,utilization,"
         << "cycles_per_warp,cycles_per_thread,"
-        << "mem_lane_ops,memops_per_cycle,"
-        << "divergent_branches,reconverges\n";
+        << "mem_lane_ops,mem_transactions,memops_per_cycle,"
+        << "divergent_branches,reconverges,"
+        << "atomic_lane_ops,atomic_serial_depth,atomic_conflict_cycles,"
+        << "shfl_lane_ops,vote_ops,reduce_ops,compactions,"
+        << "n_sms,elapsed_cycles,"
+        << "shared_lane_ops,bank_conflict_cycles,barriers,barrier_stall_cycles,"
+        << "l1_hits,l1_misses,l1_evictions,l2_hits,l2_misses,l2_evictions\n";
 }
 
 static void write_csv_row(std::ofstream& out,
@@ -27,8 +38,10 @@ static void write_csv_row(std::ofstream& out,
                           uint32_t N,
                           double div_ratio,
                           double param,
-                          const Metrics& m) {
-    uint32_t n_warps = ceil_div(N, 32);
+                          const Metrics& m,
+                          uint32_t n_sms = 1,
+                          uint64_t elapsed_cycles = 0) {   // 0 : one SM, = warp_cycles
+    uint32_t n_warps = ceil_div(N, m.warp_width);
     double util = utilization_from(m);
     double cycles_per_warp = (n_warps > 0) ? (double)m.warp_cycles / (double)n_warps : 0.0;
     double cycles_per_thread = (N > 0) ? (double)m.warp_cycles / (double)N : 0.0;
@@ -36,6 +49,7 @@ static void write_csv_row(std::ofstream& out,
 
     out << workload << ","
         << N << ","
+        << m.warp_width << ","
         << n_warps << ","
         << std::fixed << std::setprecision(2) << div_ratio << ","
         << std::fixed << std::setprecision(0) << param << ","
@@ -45,12 +59,180 @@ static void write_csv_row(std::ofstream& out,
         << std::fixed << std::setprecision(6) << cycles_per_warp << ","
         << std::fixed << std::setprecision(8) << cycles_per_thread << ","
         << m.mem_lane_ops << ","
+        << m.mem_transactions << ","
         << std::fixed << std::setprecision(6) << memops_per_cycle << ","
         << m.divergent_branches << ","
-        << m.reconverges
+        << m.reconverges << ","
+        << m.atomic_lane_ops << ","
+        << m.atomic_serial_depth << ","
+        << m.atomic_conflict_cycles << ","
+        << m.shfl_lane_ops << ","
+        << m.vote_ops << ","
+        << m.reduce_ops << ","
+        << m.compactions << ","
+        << n_sms << ","
+        << (elapsed_cycles ? elapsed_cycles : m.warp_cycles) << ","
+        << m.shared_lane_ops << ","
+        << m.bank_conflict_cycles << ","
+        << m.barriers << ","
+        << m.barrier_stall_cycles << ","
+        << m.l1_hits << ","
+        << m.l1_misses << ","
+        << m.l1_evictions << ","
+        << m.l2_hits << ","
+        << m.l2_misses << ","
+        << m.l2_evictions
         << "\n";
 }
 
+// Same columns as results.csv, typed
+static const std::vector<Column> result_columns = {
+    {"workload", Column_type::Dict}, {"N", Column_type::U32}, {"warp_width", Column_type::U32},
+    {"n_warps", Column_type::U32}, {"div_ratio", Column_type::F64}, {"param", Column_type::F64},
+    {"warp_cycles", Column_type::U64}, {"active_lane_cycles", Column_type::U64},
+    {"utilization", Column_type::F64}, {"cycles_per_warp", Column_type::F64},
+    {"cycles_per_thread", Column_type::F64},
+    {"mem_lane_ops", Column_type::U64}, {"mem_transactions", Column_type::U64},
+    {"memops_per_cycle", Column_type::F64},
+    {"divergent_branches", Column_type::U64}, {"reconverges", Column_type::U64},
+    {"atomic_lane_ops", Column_type::U64}, {"atomic_serial_depth", Column_type::U64},
+    {"atomic_conflict_cycles", Column_type::U64},
+    {"shfl_lane_ops", Column_type::U64}, {"vote_ops", Column_type::U64},
+    {"reduce_ops", Column_type::U64}, {"compactions", Column_type::U64},
+    {"n_sms", Column_type::U32}, {"elapsed_cycles", Column_type::U64},
+    {"shared_lane_ops", Column_type::U64}, {"bank_conflict_cycles", Column_type::U64},
+    {"barriers", Column_type::U64}, {"barrier_stall_cycles", Column_type::U64},
+    {"l1_hits", Column_type::U64}, {"l1_misses", Column_type::U64}, {"l1_evictions", Column_type::U64},
+    {"l2_hits", Column_type::U64}, {"l2_misses", Column_type::U64}, {"l2_evictions", Column_type::U64},
+};
+
+static void write_table_row(Results_table_writer& out,
+                            const std::string& workload,
+                            uint32_t N,
+                            double div_ratio,
+                            double param,
+                            const Metrics& m,
+                            uint32_t n_sms,
+                            uint64_t elapsed_cycles) {
+    uint32_t n_warps = ceil_div(N, m.warp_width);
+    double cycles_per_warp = (n_warps > 0) ? (double)m.warp_cycles / (double)n_warps : 0.0;
+    double cycles_per_thread = (N > 0) ? (double)m.warp_cycles / (double)N : 0.0;
+    double memops_per_cycle = (m.warp_cycles > 0) ? (double)m.mem_lane_ops / (double)m.warp_cycles : 0.0;
+
+    out.add(workload).add((uint64_t)N).add((uint64_t)m.warp_width).add((uint64_t)n_warps);
+    out.add(div_ratio).add(param);
+    out.add(m.warp_cycles).add(m.active_lane_cycles);
+    out.add(utilization_from(m)).add(cycles_per_warp).add(cycles_per_thread);
+    out.add(m.mem_lane_ops).add(m.mem_transactions).add(memops_per_cycle);
+    out.add(m.divergent_branches).add(m.reconverges);
+    out.add(m.atomic_lane_ops).add(m.atomic_serial_depth).add(m.atomic_conflict_cycles);
+    out.add(m.shfl_lane_ops).add(m.vote_ops).add(m.reduce_ops).add(m.compactions);
+    out.add((uint64_t)n_sms).add(elapsed_cycles ? elapsed_cycles : m.warp_cycles);
+    out.add(m.shared_lane_ops).add(m.bank_conflict_cycles).add(m.barriers).add(m.barrier_stall_cycles);
+    out.add(m.l1_hits).add(m.l1_misses).add(m.l1_evictions);
+    out.add(m.l2_hits).add(m.l2_misses).add(m.l2_evictions);
+    out.end_row();
+}
+
+// Rows go to results.smrt and, when exported, results.csv.
+struct Results_out {
+    std::unique_ptr<Results_table_writer> table;
+    std::unique_ptr<std::ofstream> csv;
+};
+
+static void write_row(Results_out& out,
+                      const std::string& workload,
+                      uint32_t N,
+                      double div_ratio,
+                      double param,
+                      const Metrics& m,
+                      uint32_t n_sms = 1,
+                      uint64_t elapsed_cycles = 0) {
+    if (out.table) write_table_row(*out.table, workload, N, div_ratio, param, m, n_sms, elapsed_cycles);
+    if (out.csv) write_csv_row(*out.csv, workload, N, div_ratio, param, m, n_sms, elapsed_cycles);
+}
+
+// ---------------- cached runs ----------------
+// With a Result_cache, a run whose key (simulator version and settings,
+// program, size, buffers) was seen before is served from it, buffer
+// changes included. Traced runs always simulate.
+template <uint32_t W>
+static Metrics cached_run(Result_cache* rc, GPU_SimW<W>& sim, const std::vector<Instr>& prog,
+                          Buffer& mem, uint32_t N, bool trace) {
+    if (!rc || trace) return sim.run(prog, mem, N, trace);
+    const uint64_t key = Run_key().add(std::string("run")).add_sim(sim).add(prog).add(N).add(mem).value();
+    Cached_result r;
+    if (rc->lookup(key, r, mem)) return r.m;
+    Buffer before = mem;
+    r.m = sim.run(prog, mem, N);
+    rc->store(key, r, before, mem);
+    return r.m;
+}
+
+// A hit fills total and elapsed_cycles only (no per-SM stats, no host time).
+template <uint32_t W>
+static Launch_metrics cached_launch(Result_cache* rc, GPU_SimW<W>& sim, const std::vector<Instr>& prog,
+                                    Buffer& mem, const Launch_config& cfg, bool trace) {
+    if (!rc || trace) return sim.launch(prog, mem, cfg, trace);
+    Run_key k;
+    k.add(std::string("launch")).add_sim(sim).add(prog).add(mem);
+    k.add(cfg.grid.x).add(cfg.grid.y).add(cfg.grid.z).add(cfg.block.x).add(cfg.block.y).add(cfg.block.z);
+    k.add(cfg.n_sms).add(cfg.max_blocks_per_sm).add(cfg.max_warps_per_sm).add(cfg.parallel);
+    Cached_result r;
+    Launch_metrics lm;
+    if (rc->lookup(k.value(), r, mem)) {
+        lm.total = r.m;
+        lm.elapsed_cycles = r.extra.at(0);
+        return lm;
+    }
+    Buffer before = mem;
+    lm = sim.launch(prog, mem, cfg);
+    r.m = lm.total;
+    r.extra = {lm.elapsed_cycles};
+    rc->store(k.value(), r, before, mem);
+    return lm;
+}
+
+// A hit fills the totals only (no per-op timings), and does not refill the
+// host vectors of DeviceToHost copies.
+template <uint32_t W>
+static Stream_report cached_streams(Result_cache* rc, GPU_SimW<W>& sim, const std::vector<Stream>& streams,
+                                    Buffer& mem, const Device_config& dev) {
+    if (!rc) return sim.run_streams(streams, mem, dev);
+    Run_key k;
+    k.add(std::string("streams")).add_sim(sim).add(mem);
+    uint64_t bw;
+    std::memcpy(&bw, &dev.copy_bytes_per_cycle, sizeof(bw));
+    k.add(dev.n_sms).add(dev.max_blocks_per_sm).add(dev.max_warps_per_sm);
+    k.add(bw).add(dev.copy_latency).add(dev.copy_engines);
+    for (const Stream& st : streams) {
+        k.add(st.name).add(st.ops.size());
+        for (const Stream_op& op : st.ops) {
+            k.add((uint64_t)op.kind).add(op.name).add(op.program);
+            k.add(op.grid.x).add(op.grid.y).add(op.grid.z).add(op.block.x).add(op.block.y).add(op.block.z);
+            k.add(op.first_tid).add((uint64_t)op.dir).add(op.buf).add(op.offset).add(op.words).add(op.data);
+        }
+    }
+    Cached_result r;
+    Stream_report rep;
+    if (rc->lookup(k.value(), r, mem)) {
+        rep.total = r.m;
+        rep.cycles = r.extra.at(0);
+        rep.serial_cycles = r.extra.at(1);
+        rep.bound_cycles = r.extra.at(2);
+        std::memcpy(&rep.overlap_efficiency, &r.extra.at(3), sizeof(double));
+        return rep;
+    }
+    Buffer before = mem;
+    rep = sim.run_streams(streams, mem, dev);
+    uint64_t eff;
+    std::memcpy(&eff, &rep.overlap_efficiency, sizeof(eff));
+    r.m = rep.total;
+    r.extra = {rep.cycles, rep.serial_cycles, rep.bound_cycles, eff};
+    rc->store(k.value(), r, before, mem);
+    return rep;
+}
+
 // ---------------- programs ----------------
 
 // Single-level divergent min-like branch:
@@ -104,6 +286,31 @@ static std::vector<Instr> make_nested_div_prog() {
     };
 }
 
+// Divergent branch with a longer body on each side:
+// if (r0 < r1) { r0 += r1 (body times); store r0 } else { r1 += r0 (body times); store r1 }
+// param = body : the if-conversion sweep uses it to find where predication stops paying
+static std::vector<Instr> make_branch_body_prog(int body) {
+    std::vector<Instr> p;
+    p.push_back({Op::LD,     0,0,0, 0, 0});            // r0 = buf0[tid]
+    p.push_back({Op::LD,     1,0,0, 1, 0});            // r1 = buf1[tid]
+    p.push_back({Op::CMP_LT, 0,0,1, 0, 0});            // pred = (r0 < r1)
+    const int32_t then_pc = 4 + body + 2;
+    p.push_back({Op::BRA,    0,0,0, 0, then_pc});      // if pred -> then
+
+    for (int i = 0; i < body; i++)
+        p.push_back({Op::VADD, 1,1,0, 0, 0});          // else: r1 += r0
+    p.push_back({Op::ST,     0,1,0, 2, 0});            // buf2 = r1
+    const int32_t join_pc = then_pc + body + 1;
+    p.push_back({Op::JMP,    0,0,0, 0, join_pc});
+
+    for (int i = 0; i < body; i++)
+        p.push_back({Op::VADD, 0,0,1, 0, 0});          // then: r0 += r1
+    p.push_back({Op::ST,     0,0,0, 2, 0});            // buf2 = r0
+    p.push_back({Op::JOIN,   0,0,0, 0, 0});
+    p.push_back({Op::HALT,   0,0,0, 0, 0});
+    return p;
+}
+
 // Compute-heavy: 2 loads, many VADD, 1 store
 static std::vector<Instr> make_compute_heavy_prog(int vadd_reps) {
     std::vector<Instr> p;
@@ -128,39 +335,167 @@ static std::vector<Instr> make_memory_heavy_prog(int ld_st_pairs) {
     return p;
 }
 
+// Gather: index load, scaled register-indirect load, store
+// param = stride : lane i reads buf0[i * stride], so transactions grow with stride
+static std::vector<Instr> make_gather_prog(int stride) {
+    return {
+        {Op::LD,   0,0,0, 1, 0},                   // 0: r0 = buf1[tid] (index)
+        {Op::LDX,  1,0,0, 0, 0, (uint8_t)stride},  // 1: r1 = buf0[r0 * stride]
+        {Op::ST,   0,1,0, 2, 0},                   // 2: buf2[tid] = r1
+        {Op::HALT, 0,0,0, 0, 0}
+    };
+}
+
+// Histogram: every thread atomically adds 1 to bin buf0[tid]
+// param = number of bins : fewer bins -> more lanes per address -> more contention
+static std::vector<Instr> make_histogram_prog() {
+    return {
+        {Op::LD,       0,0,0, 0, 0},   // 0: r0 = buf0[tid] (bin)
+        {Op::LD,       1,0,0, 1, 0},   // 1: r1 = buf1[tid] (= 1)
+        {Op::ATOM_ADD, 2,0,1, 2, 0},   // 2: r2 = old; buf2[r0] += r1
+        {Op::HALT,     0,0,0, 0, 0}
+    };
+}
+
+// Warp sum of buf0 into lane 0, three ways (the step count depends on the width):
+// reduce_mem  : tree through memory, ST + LD + VADD per step
+// reduce_shfl : tree through SHFL_DOWN + VADD per step
+// reduce_warp : one RED_ADD
+static std::vector<Instr> make_reduce_mem_prog(uint32_t width) {
+    std::vector<Instr> p;
+    p.push_back({Op::LD, 0,0,0, 0, 0});                   // r0 = buf0[tid]
+    for (uint32_t off = width / 2; off >= 1; off /= 2) {
+        p.push_back({Op::ST,   0,0,0, 1, 0});             // buf1[tid] = r0
+        p.push_back({Op::LD,   1,0,0, 1, (int32_t)off});  // r1 = buf1[tid + off]
+        p.push_back({Op::VADD, 0,0,1, 0, 0});             // r0 += r1
+    }
+    p.push_back({Op::ST,   0,0,0, 2, 0});                 // buf2[tid] = r0
+    p.push_back({Op::HALT, 0,0,0, 0, 0});
+    return p;
+}
+
+static std::vector<Instr> make_reduce_shfl_prog(uint32_t width) {
+    std::vector<Instr> p;
+    p.push_back({Op::LD, 0,0,0, 0, 0});                        // r0 = buf0[tid]
+    for (uint32_t off = width / 2; off >= 1; off /= 2) {
+        p.push_back({Op::SHFL_DOWN, 1,0,0, 0, (int32_t)off});  // r1 = r0 of lane + off
+        p.push_back({Op::VADD,      0,0,1, 0, 0});             // r0 += r1
+    }
+    p.push_back({Op::ST,   0,0,0, 2, 0});                      // buf2[tid] = r0
+    p.push_back({Op::HALT, 0,0,0, 0, 0});
+    return p;
+}
+
+static std::vector<Instr> make_reduce_warp_prog() {
+    return {
+        {Op::LD,      0,0,0, 0, 0},   // 0: r0 = buf0[tid]
+        {Op::RED_ADD, 0,0,0, 0, 0},   // 1: r0 = sum over the warp
+        {Op::ST,      0,0,0, 2, 0},   // 2: buf2[tid] = r0
+        {Op::HALT,    0,0,0, 0, 0}
+    };
+}
+
+// Block sum through shared memory (tree, one BAR_SYNC around every step).
+// buf1 holds the thread index within the block, buf2[block start] gets the sum.
+// Threads past the live half read the zero padding (shared_words >= 2 * block).
+static std::vector<Instr> make_block_reduce_prog(uint32_t block) {
+    std::vector<Instr> p;
+    p.push_back({Op::LD,       0,0,0, 0, 0});                  // r0 = buf0[tid]
+    p.push_back({Op::LD,       1,0,0, 1, 0});                  // r1 = t (index in block)
+    p.push_back({Op::STS,      0,0,1, 0, 0});                  // shared[t] = r0
+    p.push_back({Op::BAR_SYNC, 0,0,0, 0, 0});
+    for (uint32_t off = block / 2; off >= 1; off /= 2) {
+        p.push_back({Op::LDS,      2,1,0, 0, (int32_t)off});   // r2 = shared[t + off]
+        p.push_back({Op::VADD,     0,0,2, 0, 0});              // r0 += r2
+        p.push_back({Op::BAR_SYNC, 0,0,0, 0, 0});              // all reads before the writes
+        p.push_back({Op::STS,      0,0,1, 0, 0});              // shared[t] = r0
+        p.push_back({Op::BAR_SYNC, 0,0,0, 0, 0});
+    }
+    p.push_back({Op::ST,   0,0,0, 2, 0});                      // buf2[tid] = r0
+    p.push_back({Op::HALT, 0,0,0, 0, 0});
+    return p;
+}
+
+// Strided shared-memory access: r2 = shared[t * stride]
+// param = stride : 32 banks, so stride 2^k puts 2^k lanes of a warp in one bank
+static std::vector<Instr> make_shared_stride_prog(int stride) {
+    return {
+        {Op::LD,   1,0,0, 1, 0},                    // 0: r1 = t
+        {Op::STS,  1,1,1, 0, 0, (uint8_t)stride},   // 1: shared[t * stride] = t
+        {Op::LDS,  2,1,0, 0, 0, (uint8_t)stride},   // 2: r2 = shared[t * stride]
+        {Op::ST,   0,2,0, 2, 0},                    // 3: buf2[tid] = r2
+        {Op::HALT, 0,0,0, 0, 0}
+    };
+}
+
+// Barrier skew: the first warp of each block runs `extra` VADDs before the
+// BAR_SYNC, the others park there and wait (barrier_stall_cycles)
+static std::vector<Instr> make_barrier_skew_prog(int extra) {
+    std::vector<Instr> p;
+    p.push_back({Op::LD,     1,0,0, 1, 0});                // 0: r1 = t
+    p.push_back({Op::LD,     2,0,0, 0, 0});                // 1: r2 = buf0 (= warp width)
+    p.push_back({Op::CMP_LT, 0,1,2, 0, 0});                // 2: pred = t < width
+    p.push_back({Op::BRA,    0,0,0, 0, 5});                // 3: first warp -> work
+    const int32_t join_pc = 5 + extra;
+    p.push_back({Op::JMP,    0,0,0, 0, join_pc});          // 4: others skip it
+    for (int i = 0; i < extra; i++)
+        p.push_back({Op::VADD, 3,3,1, 0, 0});              // r3 += t
+    p.push_back({Op::JOIN,     0,0,0, 0, 0});
+    p.push_back({Op::BAR_SYNC, 0,0,0, 0, 0});
+    p.push_back({Op::ST,       0,3,0, 2, 0});              // buf2[tid] = r3
+    p.push_back({Op::HALT,     0,0,0, 0, 0});
+    return p;
+}
+
 // ---------------- buffer initializers ----------------
 
 // For branch divergence ratio r within each warp:
 // pred = (r0 < r1), with r0=tid, r1=warp_base+k
-// k ~ r*32 makes exactly k lanes taken per warp (except partial warp)
-static void init_buffers_for_branch_ratio(Buffer& mem, uint32_t N, double div_ratio) {
+// k ~ r*width makes exactly k lanes taken per warp (except partial warp)
+static void init_buffers_for_branch_ratio(Buffer& mem, uint32_t N, double div_ratio, uint32_t width) {
     mem.buf0.resize(N);
     mem.buf1.resize(N);
     mem.buf2.assign(N, 0);
 
-    int k = (int)std::round(div_ratio * 32.0);
+    int k = (int)std::round(div_ratio * (double)width);
     if (k < 0) k = 0;
-    if (k > 32) k = 32;
+    if (k > (int)width) k = (int)width;
 
     for (uint32_t tid = 0; tid < N; tid++) {
         mem.buf0[tid] = tid;                 // r0 = tid
-        uint32_t warp_base = (tid / 32) * 32;
+        uint32_t warp_base = (tid / width) * width;
         mem.buf1[tid] = warp_base + (uint32_t)k; // r1 threshold
     }
 }
 
+// Same branch, but each thread takes it with probability div_ratio
+// (fixed hash of tid), so warps diverge in different lanes
+static void init_buffers_for_branch_random(Buffer& mem, uint32_t N, double div_ratio) {
+    mem.buf0.resize(N);
+    mem.buf1.resize(N);
+    mem.buf2.assign(N, 0);
+
+    const uint32_t cut = (uint32_t)std::round(div_ratio * 1024.0);
+    for (uint32_t tid = 0; tid < N; tid++) {
+        uint32_t h = (tid * 2654435761u) >> 22;          // 0..1023
+        mem.buf0[tid] = tid;
+        mem.buf1[tid] = (h < cut) ? tid + 1 : tid;       // taken iff r0 < r1
+    }
+}
+
 // For nested divergence: choose thresholds so that
-// pred1 true for lanes >=16  and pred2 true for lanes >=24 (inside pred1-taken)
-static void init_buffers_for_nested(Buffer& mem, uint32_t N) {
+// pred1 true for the upper half of each warp and pred2 true for the upper
+// quarter (inside pred1-taken); lanes >=16 / >=24 at width 32
+static void init_buffers_for_nested(Buffer& mem, uint32_t N, uint32_t width) {
     mem.buf0.resize(N);
     mem.buf1.resize(N);
     mem.buf2.resize(N);
 
     for (uint32_t tid = 0; tid < N; tid++) {
-        uint32_t warp_base = (tid / 32) * 32;
-        mem.buf0[tid] = tid;            // r0
-        mem.buf1[tid] = warp_base + 15; // r1 threshold -> lanes >=16 satisfy (r1 < r0)
-        mem.buf2[tid] = warp_base + 23; // r2 threshold -> lanes >=24 satisfy (r2 < r0)
+        uint32_t warp_base = (tid / width) * width;
+        mem.buf0[tid] = tid;                              // r0
+        mem.buf1[tid] = warp_base + width / 2 - 1;        // r1 threshold -> upper half satisfy (r1 < r0)
+        mem.buf2[tid] = warp_base + (3 * width) / 4 - 1;  // r2 threshold -> upper quarter satisfy (r2 < r0)
     }
 }
 
@@ -187,18 +522,65 @@ static void init_buffers_memory(Buffer& mem, uint32_t N, int ld_st_pairs) {
     }
 }
 
-// ---------------- main experiment runner ----------------
-int main(int argc, char** argv) {
-    bool trace = false;
-    for (int i = 1; i < argc; i++) {
-        std::string a = argv[i];
-        if (a == "--trace") trace = true;
-    }
+// For gather: index = tid, table big enough for the largest scaled index
+static void init_buffers_gather(Buffer& mem, uint32_t N, int stride) {
+    uint32_t size = N * (uint32_t)stride;
+    mem.buf0.resize(size);
+    mem.buf1.resize(N);
+    mem.buf2.assign(N, 0);
+    for (uint32_t i = 0; i < size; i++) mem.buf0[i] = i;
+    for (uint32_t i = 0; i < N; i++) mem.buf1[i] = i;
+}
+
+// For histogram: thread tid falls into bin tid % bins
+static void init_buffers_histogram(Buffer& mem, uint32_t N, int bins) {
+    mem.buf0.resize(N);
+    mem.buf1.assign(N, 1);
+    mem.buf2.assign((uint32_t)bins, 0);
+    for (uint32_t i = 0; i < N; i++) mem.buf0[i] = i % (uint32_t)bins;
+}
 
-    std::ofstream csv("results.csv");
-    write_csv_header(csv);
+// For reductions: buf1 is the scratch of reduce_mem, padded for tid + off
+static void init_buffers_reduce(Buffer& mem, uint32_t N, uint32_t width) {
+    mem.buf0.resize(N);
+    mem.buf1.assign(N + width, 0);
+    mem.buf2.assign(N, 0);
+    for (uint32_t i = 0; i < N; i++) mem.buf0[i] = i;
+}
 
-    GPU_Sim sim;
+// For shared-memory workloads: buf0 = value (or threshold), buf1 = index in block
+static void init_buffers_block(Buffer& mem, uint32_t N, uint32_t block, uint32_t buf0_value) {
+    mem.buf0.resize(N);
+    mem.buf1.resize(N);
+    mem.buf2.assign(N, 0);
+    for (uint32_t i = 0; i < N; i++) {
+        mem.buf0[i] = buf0_value ? buf0_value : i;
+        mem.buf1[i] = i % block;
+    }
+}
+
+// ---------------- one full sweep at warp width W ----------------
+struct Sweep_options {
+    bool native = false;
+    bool caches = true;                  // L1 / L2 model
+    bool trace = false;
+    Mem_trace_writer* mem_trace = nullptr;
+    Result_cache* results = nullptr;     // nullptr : simulate everything
+};
+
+template <uint32_t W>
+static void run_sweep(Results_out& rows, const Sweep_options& opt) {
+    const bool trace = opt.trace;
+    const bool caches = opt.caches;
+    Result_cache* rc = opt.results;
+    GPU_SimW<W> sim;
+    if (opt.native) sim.backend = Backend::Native;
+    sim.mem_trace = opt.mem_trace;
+    if (caches) {
+        // 16 KB 4-way write-through L1 per SM, 256 KB 8-way write-back L2
+        sim.l1_cache = {16 * 1024, 128, 4, Replacement::LRU, Write_policy::WriteThrough};
+        sim.l2_cache = {256 * 1024, 128, 8, Replacement::LRU, Write_policy::WriteBack};
+    }
     Buffer mem;
 
     // Sweep thread counts: include partial warp + multiple warps
@@ -210,22 +592,123 @@ int main(int argc, char** argv) {
 
     for (uint32_t N : Ns) {
         for (double r : divs) {
-            init_buffers_for_branch_ratio(mem, N, r);
-            Metrics m = sim.run(branch_prog, mem, N, trace);
-            write_csv_row(csv, "branch_div", N, r, /*param*/0, m);
+            init_buffers_for_branch_ratio(mem, N, r, W);
+            Metrics m = cached_run(rc, sim, branch_prog, mem, N, trace);
+            write_row(rows, "branch_div", N, r, /*param*/0, m);
         }
     }
 
-    // ---------------- Nested divergence workload ----------------
-// ---------------- Nested divergence sweep (same Ns as others) ----------------
-auto nested_prog = make_nested_div_prog();
+    // ---------------- Nested divergence sweep (same Ns as others) ----------------
+    auto nested_prog = make_nested_div_prog();
 
-for (uint32_t N : Ns) {
-    init_buffers_for_nested(mem, N);
-    Metrics m = sim.run(nested_prog, mem, N, trace);
-    write_csv_row(csv, "nested_div", N, -1.0, /*param*/0, m);
-}
+    for (uint32_t N : Ns) {
+        init_buffers_for_nested(mem, N, W);
+        Metrics m = cached_run(rc, sim, nested_prog, mem, N, trace);
+        write_row(rows, "nested_div", N, -1.0, /*param*/0, m);
+    }
 
+    // ---------------- Thread-block compaction vs the per-warp SIMT stack ----------------
+    // *_tbc rows keep threads in their lane, *_tbc_ideal rows may move them
+    // anywhere. branch_div diverges in the same lanes of every warp, which
+    // lane-aligned compaction cannot pack; branch_rand diverges randomly.
+    GPU_SimW<W> tbc = sim, tbc_ideal = sim;
+    tbc.compaction = Compaction::LaneAligned;
+    tbc_ideal.compaction = Compaction::Ideal;
+
+    for (uint32_t N : Ns) {
+        for (double r : divs) {
+            init_buffers_for_branch_random(mem, N, r);
+            write_row(rows, "branch_rand", N, r, /*param*/0, cached_run(rc, sim, branch_prog, mem, N, trace));
+        }
+    }
+    const std::vector<std::pair<const char*, GPU_SimW<W>*>> tbc_modes = {
+        {"_tbc", &tbc}, {"_tbc_ideal", &tbc_ideal}};
+    for (const auto& mode : tbc_modes) {
+        const std::string sfx = mode.first;
+        GPU_SimW<W>& s = *mode.second;
+        for (uint32_t N : Ns) {
+            for (double r : divs) {
+                init_buffers_for_branch_ratio(mem, N, r, W);
+                write_row(rows, "branch_div" + sfx, N, r, /*param*/0, cached_run(rc, s, branch_prog, mem, N, trace));
+                init_buffers_for_branch_random(mem, N, r);
+                write_row(rows, "branch_rand" + sfx, N, r, /*param*/0, cached_run(rc, s, branch_prog, mem, N, trace));
+            }
+            init_buffers_for_nested(mem, N, W);
+            write_row(rows, "nested_div" + sfx, N, -1.0, /*param*/0, cached_run(rc, s, nested_prog, mem, N, trace));
+        }
+    }
+
+    // savings summary at the largest N, div_ratio 0.5
+    {
+        const uint32_t N = Ns.back();
+        std::cout << "compaction, width " << W << ", N=" << N
+                  << " (warp cycles / utilization : baseline, lane-aligned, ideal)\n";
+        auto report = [&](const char* name, auto init, const std::vector<Instr>& prog) {
+            std::cout << "  " << std::left << std::setw(12) << name << std::right;
+            for (GPU_SimW<W>* s : {&sim, &tbc, &tbc_ideal}) {
+                init();
+                Metrics m = cached_run(rc, *s, prog, mem, N, false);
+                std::cout << "  " << m.warp_cycles << " / " << std::fixed << std::setprecision(3)
+                          << utilization_from(m);
+            }
+            std::cout << "\n";
+        };
+        report("branch_div", [&] { init_buffers_for_branch_ratio(mem, N, 0.5, W); }, branch_prog);
+        report("branch_rand", [&] { init_buffers_for_branch_random(mem, N, 0.5); }, branch_prog);
+        report("nested_div", [&] { init_buffers_for_nested(mem, N, W); }, nested_prog);
+    }
+
+    // ---------------- If-conversion: branchy vs predicated ----------------
+    // *_ifc rows run the same program through the if-conversion pass. The
+    // size limit is lifted so every body length is converted and the sweep
+    // shows where predication stops beating the branch.
+    GPU_SimW<W> ifc = sim;
+    ifc.if_conversion = true;
+    ifc.if_conversion_max_instrs = 64;
+
+    for (uint32_t N : Ns) {
+        for (double r : divs) {
+            init_buffers_for_branch_ratio(mem, N, r, W);
+            write_row(rows, "branch_div_ifc", N, r, /*param*/0, cached_run(rc, ifc, branch_prog, mem, N, trace));
+        }
+        init_buffers_for_nested(mem, N, W);
+        write_row(rows, "nested_div_ifc", N, -1.0, /*param*/0, cached_run(rc, ifc, nested_prog, mem, N, trace));
+    }
+
+    std::vector<int> bodies = {1, 2, 4, 8, 16};
+    for (int body : bodies) {
+        auto prog = make_branch_body_prog(body);
+        for (uint32_t N : Ns) {
+            for (double r : divs) {
+                init_buffers_for_branch_ratio(mem, N, r, W);
+                write_row(rows, "branch_body", N, r, /*param*/body, cached_run(rc, sim, prog, mem, N, trace));
+
+                init_buffers_for_branch_ratio(mem, N, r, W);
+                write_row(rows, "branch_body_ifc", N, r, /*param*/body, cached_run(rc, ifc, prog, mem, N, trace));
+            }
+        }
+    }
+
+    // before/after summary at the largest N
+    {
+        const uint32_t N = Ns.back();
+        std::cout << "if-conversion, width " << W << ", N=" << N << " (warp cycles / utilization)\n";
+        for (int body : bodies) {
+            auto prog = make_branch_body_prog(body);
+            std::cout << "  body " << std::setw(2) << body << ":";
+            for (double r : {0.0, 0.5}) {
+                init_buffers_for_branch_ratio(mem, N, r, W);
+                Metrics before = cached_run(rc, sim, prog, mem, N, false);
+                init_buffers_for_branch_ratio(mem, N, r, W);
+                Metrics after = cached_run(rc, ifc, prog, mem, N, false);
+                std::cout << "  div " << std::fixed << std::setprecision(2) << r << " "
+                          << before.warp_cycles << " -> " << after.warp_cycles << " / "
+                          << std::setprecision(3) << utilization_from(before) << " -> "
+                          << utilization_from(after);
+            }
+            std::cout << "\n";
+        }
+    }
 
     // ---------------- Compute-heavy sweeps ----------------
     std::vector<int> compute_reps = {10, 50, 200, 500};
@@ -233,8 +716,8 @@ for (uint32_t N : Ns) {
         init_buffers_compute(mem, N);
         for (int reps : compute_reps) {
             auto prog = make_compute_heavy_prog(reps);
-            Metrics m = sim.run(prog, mem, N, trace);
-            write_csv_row(csv, "compute_heavy", N, -1.0, /*param*/reps, m);
+            Metrics m = cached_run(rc, sim, prog, mem, N, trace);
+            write_row(rows, "compute_heavy", N, -1.0, /*param*/reps, m);
         }
     }
 
@@ -244,13 +727,239 @@ for (uint32_t N : Ns) {
         for (int pairs : mem_pairs) {
             init_buffers_memory(mem, N, pairs);
             auto prog = make_memory_heavy_prog(pairs);
-            Metrics m = sim.run(prog, mem, N, trace);
-            write_csv_row(csv, "memory_heavy", N, -1.0, /*param*/pairs, m);
+            Metrics m = cached_run(rc, sim, prog, mem, N, trace);
+            write_row(rows, "memory_heavy", N, -1.0, /*param*/pairs, m);
+        }
+    }
+
+    // tid + i offsets : every line is reused by the next 31 loads of its warp
+    if (caches) {
+        const uint32_t N = Ns.back();
+        std::cout << "caches, width " << W << ", memory_heavy N=" << N << " (L1 / L2 hit rate) :";
+        for (int pairs : mem_pairs) {
+            init_buffers_memory(mem, N, pairs);
+            Metrics m = cached_run(rc, sim, make_memory_heavy_prog(pairs), mem, N, false);
+            auto rate = [](uint64_t h, uint64_t x) { return (h + x) ? (double)h / (double)(h + x) : 0.0; };
+            std::cout << "  " << pairs << ": " << std::fixed << std::setprecision(2)
+                      << rate(m.l1_hits, m.l1_misses) << " / " << rate(m.l2_hits, m.l2_misses);
+        }
+        std::cout << "\n";
+    }
+
+    // ---------------- Gather (stride) sweeps ----------------
+    std::vector<int> strides = {1, 2, 4, 8, 16, 32};
+    for (uint32_t N : Ns) {
+        for (int stride : strides) {
+            init_buffers_gather(mem, N, stride);
+            auto prog = make_gather_prog(stride);
+            Metrics m = cached_run(rc, sim, prog, mem, N, trace);
+            write_row(rows, "gather_stride", N, -1.0, /*param*/stride, m);
+        }
+    }
+
+    // ---------------- Histogram (atomic contention) sweeps ----------------
+    auto hist_prog = make_histogram_prog();
+    std::vector<int> bin_counts = {1, 4, 16, 64, 256};
+    for (uint32_t N : Ns) {
+        for (int bins : bin_counts) {
+            init_buffers_histogram(mem, N, bins);
+            Metrics m = cached_run(rc, sim, hist_prog, mem, N, trace);
+            write_row(rows, "histogram", N, -1.0, /*param*/bins, m);
+        }
+    }
+
+    // ---------------- Multi-SM scaling ----------------
+    // compute_heavy (200 VADD) as a grid of 128-thread blocks; param = SMs.
+    // 20 blocks do not divide evenly, so the busiest SM sets elapsed_cycles.
+    // The SMs run on one host thread so the shared L2 counters are repeatable.
+    auto sm_prog = make_compute_heavy_prog(200);
+    std::vector<uint32_t> grids = {20, 64, 256};
+    std::vector<uint32_t> sm_counts = {1, 2, 4, 8, 16};
+    for (uint32_t blocks : grids) {
+        Launch_config cfg;
+        cfg.grid.x = blocks;
+        cfg.block.x = 128;
+        cfg.parallel = false;
+        const uint32_t N = blocks * cfg.block.x;
+        for (uint32_t sms : sm_counts) {
+            cfg.n_sms = sms;
+            init_buffers_compute(mem, N);
+            Launch_metrics lm = cached_launch(rc, sim, sm_prog, mem, cfg, trace);
+            write_row(rows, "sm_scaling", N, -1.0, /*param*/sms, lm.total, sms, lm.elapsed_cycles);
         }
     }
 
-    csv.close();
-    std::cout << "Wrote results.csv\n";
-    std::cout << "Run: python3 analysis/analyze.py\n";
+    // host speedup : the same 8-SM launch on one thread and on eight
+    {
+        Launch_config cfg;
+        cfg.grid.x = 256;
+        cfg.block.x = 128;
+        cfg.n_sms = 8;
+        const uint32_t N = cfg.grid.x * cfg.block.x;
+        init_buffers_compute(mem, N);
+        cfg.parallel = false;
+        double serial = sim.launch(sm_prog, mem, cfg).host_seconds;
+        init_buffers_compute(mem, N);
+        cfg.parallel = true;
+        double parallel = sim.launch(sm_prog, mem, cfg).host_seconds;
+        std::cout << "multi-SM, width " << W << ": 8 SMs host time " << std::fixed << std::setprecision(4)
+                  << serial << " s serial, " << parallel << " s threaded (x"
+                  << std::setprecision(2) << (parallel > 0 ? serial / parallel : 0.0) << ")\n";
+    }
+
+    // ---------------- Streams : copy / compute overlap ----------------
+    // The same work (H2D buf0, compute_heavy, D2H buf2 over 16384 threads)
+    // split into k chunks on k streams; param = k. elapsed_cycles is the
+    // makespan on 4 SMs with one copy engine per direction.
+    {
+        const uint32_t N = 16384;
+        const uint32_t block = 128;
+        Device_config dev;
+        dev.n_sms = 4;
+        dev.copy_bytes_per_cycle = 8.0;
+        auto stream_prog = make_compute_heavy_prog(50);
+        std::vector<uint32_t> chunk_counts = {1, 2, 4, 8};
+        for (uint32_t k : chunk_counts) {
+            const uint32_t chunk = N / k;
+            init_buffers_compute(mem, N);
+            std::vector<std::vector<uint32_t>> out(k);
+            std::vector<Stream> streams;
+            for (uint32_t c = 0; c < k; c++) {
+                Stream s("s" + std::to_string(c));
+                std::vector<uint32_t> in(mem.buf0.begin() + c * chunk, mem.buf0.begin() + (c + 1) * chunk);
+                s.copy_to_device("h2d", std::move(in), 0, c * chunk);
+                Dim3 grid, blk;
+                grid.x = chunk / block;
+                blk.x = block;
+                s.launch("compute", stream_prog, grid, blk, c * chunk);
+                s.copy_to_host("d2h", 2, c * chunk, chunk, out[c]);
+                streams.push_back(std::move(s));
+            }
+            Stream_report rep = cached_streams(rc, sim, streams, mem, dev);
+            write_row(rows, "streams", N, -1.0, /*param*/k, rep.total, dev.n_sms, rep.cycles);
+            std::cout << "streams, width " << W << ", " << k << " x " << chunk << " threads : "
+                      << rep.cycles << " cycles (serial " << rep.serial_cycles << ", bound "
+                      << rep.bound_cycles << "), overlap efficiency " << std::fixed
+                      << std::setprecision(2) << rep.overlap_efficiency << "\n";
+        }
+    }
+
+    // ---------------- Shared memory and block barriers ----------------
+    // run() with thread blocks; param = block size / stride / skew
+    GPU_SimW<W> blk = sim;
+    std::vector<uint32_t> block_sizes = {2 * W, 4 * W, 8 * W};
+    for (uint32_t bt : block_sizes) {
+        blk.block_threads = bt;
+        blk.shared_words = 2 * bt;
+        auto prog = make_block_reduce_prog(bt);
+        for (uint32_t N : Ns) {
+            init_buffers_block(mem, N, bt, 0);
+            write_row(rows, "block_reduce", N, -1.0, /*param*/bt, cached_run(rc, blk, prog, mem, N, trace));
+        }
+    }
+
+    blk.block_threads = 4 * W;
+    blk.shared_words = 32 * 4 * W;
+    for (int stride : strides) {
+        auto prog = make_shared_stride_prog(stride);
+        for (uint32_t N : Ns) {
+            init_buffers_block(mem, N, 4 * W, 0);
+            write_row(rows, "shared_stride", N, -1.0, /*param*/stride, cached_run(rc, blk, prog, mem, N, trace));
+        }
+    }
+
+    std::vector<int> skews = {0, 8, 32, 128};
+    for (int extra : skews) {
+        auto prog = make_barrier_skew_prog(extra);
+        for (uint32_t N : Ns) {
+            init_buffers_block(mem, N, 4 * W, W);
+            write_row(rows, "barrier_skew", N, -1.0, /*param*/extra, cached_run(rc, blk, prog, mem, N, trace));
+        }
+    }
+
+    // ---------------- Warp reductions: memory vs shuffle vs RED_ADD ----------------
+    auto reduce_mem_prog  = make_reduce_mem_prog(W);
+    auto reduce_shfl_prog = make_reduce_shfl_prog(W);
+    auto reduce_warp_prog = make_reduce_warp_prog();
+    for (uint32_t N : Ns) {
+        init_buffers_reduce(mem, N, W);
+        write_row(rows, "reduce_mem", N, -1.0, /*param*/0, cached_run(rc, sim, reduce_mem_prog, mem, N, trace));
+
+        init_buffers_reduce(mem, N, W);
+        write_row(rows, "reduce_shfl", N, -1.0, /*param*/0, cached_run(rc, sim, reduce_shfl_prog, mem, N, trace));
+
+        init_buffers_reduce(mem, N, W);
+        write_row(rows, "reduce_warp", N, -1.0, /*param*/0, cached_run(rc, sim, reduce_warp_prog, mem, N, trace));
+    }
+}
+
+// ---------------- main experiment runner ----------------
+int main(int argc, char** argv) {
+    Sweep_options opt;
+    std::string mem_trace_path;
+    std::string results_path = "results_cache.bin";
+    uint32_t only_width = 0;   // 0 = sweep 16, 32 and 64
+    bool export_csv = false;
+    bool append = false;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--trace") opt.trace = true;
+        if (a == "--native") opt.native = true;    // compile each program once, run natively
+        if (a == "--no-cache") opt.caches = false; // no L1/L2 model (needed for --native to run natively)
+        if (a == "--mem-trace" && i + 1 < argc) mem_trace_path = argv[++i];   // for app/trace_replay
+        if (a == "--result-cache" && i + 1 < argc) results_path = argv[++i];
+        if (a == "--no-result-cache") results_path.clear();                  // simulate everything
+        if (a == "--width" && i + 1 < argc) only_width = (uint32_t)std::stoul(argv[++i]);
+        if (a == "--csv") export_csv = true;        // results.csv as well
+        if (a == "--append") append = true;         // add to results.smrt instead of replacing it
+    }
+
+    // the L1/L2 model and both traces hook every memory access, which only the interpreter has
+    if (opt.native && (opt.caches || opt.trace || !mem_trace_path.empty())) {
+        std::cerr << "warning: --native ignored, "
+                  << (opt.caches ? "the L1/L2 model is interpreter-only (add --no-cache)"
+                                 : "--trace / --mem-trace run on the interpreter")
+                  << "\n";
+        opt.native = false;
+    }
+
+    Results_out out;
+    out.table = std::make_unique<Results_table_writer>("results.smrt", result_columns, append);
+    if (export_csv) {
+        out.csv = std::make_unique<std::ofstream>("results.csv");
+        write_csv_header(*out.csv);
+    }
+
+    std::unique_ptr<Mem_trace_writer> mem_trace;
+    if (!mem_trace_path.empty()) mem_trace = std::make_unique<Mem_trace_writer>(mem_trace_path);
+    opt.mem_trace = mem_trace.get();
+
+    // a trace has to see every run, so it turns the result cache off
+    std::unique_ptr<Result_cache> results;
+    if (!results_path.empty() && !opt.trace && !mem_trace) results = std::make_unique<Result_cache>(results_path);
+    opt.results = results.get();
+
+    // Warp width is a compile-time parameter, so each width is its own instantiation
+    if (only_width == 0 || only_width == 16) run_sweep<16>(out, opt);
+    if (only_width == 0 || only_width == 32) run_sweep<32>(out, opt);
+    if (only_width == 0 || only_width == 64) run_sweep<64>(out, opt);
+
+    out.table->flush();
+    std::cout << "Wrote results.smrt (" << out.table->rows() << " rows)\n";
+    if (out.csv) {
+        out.csv->close();
+        std::cout << "Wrote results.csv\n";
+    }
+    if (results) {
+        results->save();
+        std::cout << "Result cache " << results_path << " : " << results->hits << " hits, "
+                  << results->misses << " simulated, " << results->size() << " entries\n";
+    }
+    if (mem_trace) {
+        mem_trace->flush();
+        std::cout << "Wrote " << mem_trace_path << " (" << mem_trace->accesses() << " accesses, "
+                  << mem_trace->bytes() << " bytes)\n";
+    }
+    std::cout << "Plot results.smrt : python3 analysis/plot_results.py (summary : python3 analysis/results_table.py)\n";
     return 0;
 }
@@ -0,0 +1,148 @@
+#include "model.h"
+#include "mem_trace.h"
+#include "bit_utils.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Replays a memory trace (mem_trace.h) through the coalescing and cache
+// models, once per configuration, and prints one CSV row per configuration.
+//
+//   trace_replay <trace> [--l1 SPEC]... [--l2 SPEC]... [--segment BYTES]... [--sms N]
+//
+// SPEC is off or SIZE:LINE:WAYS[:lru|fifo|random][:wb|wt] (sizes in bytes,
+// SIZE may end in K). Every --l1 / --l2 / --segment value given is combined
+// with every other. Defaults match main_analysis : 16K:128:4:lru:wt L1,
+// 256K:128:8:lru:wb L2, 128-byte segments.
+
+static uint32_t parse_size(const std::string& s) {
+    if (s.empty()) throw std::invalid_argument("empty size");
+    uint32_t mul = 1;
+    std::string digits = s;
+    if (s.back() == 'K' || s.back() == 'k') { mul = 1024; digits.pop_back(); }
+    return (uint32_t)std::stoul(digits) * mul;
+}
+
+static Cache_config parse_cache(const std::string& spec) {
+    Cache_config c;
+    if (spec == "off") return c;
+    std::vector<std::string> f;
+    std::stringstream ss(spec);
+    for (std::string part; std::getline(ss, part, ':');) f.push_back(part);
+    if (f.size() < 3) throw std::invalid_argument("cache spec " + spec + " : need SIZE:LINE:WAYS");
+    c.size_bytes = parse_size(f[0]);
+    c.line_bytes = parse_size(f[1]);
+    c.ways = (uint32_t)std::stoul(f[2]);
+    for (size_t i = 3; i < f.size(); i++) {
+        if      (f[i] == "lru")    c.replacement = Replacement::LRU;
+        else if (f[i] == "fifo")   c.replacement = Replacement::FIFO;
+        else if (f[i] == "random") c.replacement = Replacement::Random;
+        else if (f[i] == "wb")     c.write = Write_policy::WriteBack;
+        else if (f[i] == "wt")     c.write = Write_policy::WriteThrough;
+        else throw std::invalid_argument("cache spec " + spec + " : unknown field " + f[i]);
+    }
+    return c;
+}
+
+// Distinct values of addr >> shift over the lanes in mask, sorted.
+static uint32_t distinct_lines(const Mem_access& a, uint32_t shift, uint32_t* out) {
+    uint32_t n = 0;
+    for_each_set_bit(a.mask, [&](unsigned l) {
+        uint32_t s = a.addr[l] >> shift;
+        uint32_t i = n++;
+        while (i > 0 && out[i - 1] > s) { out[i] = out[i - 1]; i--; }
+        out[i] = s;
+    });
+    uint32_t d = 0;
+    for (uint32_t i = 0; i < n; i++)
+        if (i == 0 || out[i] != out[d - 1]) out[d++] = out[i];
+    return d;
+}
+
+struct Replay_result {
+    uint64_t runs = 0, accesses = 0, lane_accesses = 0, transactions = 0;
+    Metrics m;
+};
+
+static Replay_result replay(const std::string& path, const Cache_config& l1, const Cache_config& l2,
+                            uint32_t segment_bytes, uint32_t n_sms) {
+    uint32_t seg_shift = 0;
+    while ((4u << seg_shift) < segment_bytes) seg_shift++;
+
+    Mem_trace_reader reader(path);
+    Replay_result r;
+    std::unique_ptr<Cache_hierarchy> caches;
+    Mem_access a;
+    uint32_t lines[64];
+
+    for (;;) {
+        const Mem_trace_reader::Record rec = reader.next(a);
+        if (rec == Mem_trace_reader::Record::End) break;
+        if (rec == Mem_trace_reader::Record::Run) {
+            caches.reset();   // every run starts cold
+            caches = std::make_unique<Cache_hierarchy>(l1, l2, n_sms, false);
+            r.runs++;
+            continue;
+        }
+        if (a.sm >= n_sms) throw std::runtime_error("trace uses more SMs than --sms");
+
+        r.accesses++;
+        r.lane_accesses += popcount64(a.mask);
+        r.transactions += distinct_lines(a, seg_shift, lines);
+
+        Cache* c = caches->sm(a.sm);
+        if (!c) continue;
+        const uint32_t shift = c->line_shift();
+        const uint32_t n = distinct_lines(a, shift, lines);
+        for (uint32_t i = 0; i < n; i++)
+            c->access(cache_address(a.buf, lines[i] << shift), a.write, r.m);
+    }
+    return r;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: trace_replay <trace> [--l1 SPEC]... [--l2 SPEC]... [--segment BYTES]... [--sms N]\n";
+        return 1;
+    }
+    const std::string path = argv[1];
+    std::vector<std::string> l1s, l2s;
+    std::vector<uint32_t> segments;
+    uint32_t n_sms = 16;
+
+    try {
+        for (int i = 2; i < argc; i++) {
+            std::string a = argv[i];
+            if (i + 1 >= argc) throw std::invalid_argument(a + " needs a value");
+            if      (a == "--l1")      l1s.push_back(argv[++i]);
+            else if (a == "--l2")      l2s.push_back(argv[++i]);
+            else if (a == "--segment") segments.push_back(parse_size(argv[++i]));
+            else if (a == "--sms")     n_sms = (uint32_t)std::stoul(argv[++i]);
+            else throw std::invalid_argument("unknown option " + a);
+        }
+        if (l1s.empty()) l1s.push_back("16K:128:4:lru:wt");
+        if (l2s.empty()) l2s.push_back("256K:128:8:lru:wb");
+        if (segments.empty()) segments.push_back(128);
+
+        std::cout << "l1,l2,segment_bytes,runs,accesses,lane_accesses,transactions,"
+                  << "l1_hits,l1_misses,l1_evictions,l2_hits,l2_misses,l2_evictions\n";
+        for (const std::string& l1 : l1s) {
+            for (const std::string& l2 : l2s) {
+                for (uint32_t seg : segments) {
+                    Replay_result r = replay(path, parse_cache(l1), parse_cache(l2), seg, n_sms);
+                    std::cout << l1 << "," << l2 << "," << seg << ","
+                              << r.runs << "," << r.accesses << "," << r.lane_accesses << ","
+                              << r.transactions << ","
+                              << r.m.l1_hits << "," << r.m.l1_misses << "," << r.m.l1_evictions << ","
+                              << r.m.l2_hits << "," << r.m.l2_misses << "," << r.m.l2_evictions << "\n";
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "trace_replay: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
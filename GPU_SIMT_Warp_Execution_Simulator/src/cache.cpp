@@ -0,0 +1,102 @@
+#include "cache.h"
+#include "model.h"
+#include <stdexcept>
+
+static bool is_pow2(uint64_t v) { return v != 0 && (v & (v - 1)) == 0; }
+
+static uint32_t log2_of(uint64_t v) {
+    uint32_t s = 0;
+    while ((1ull << s) < v) s++;
+    return s;
+}
+
+Cache::Cache(const Cache_config& cfg, int level, Cache* next, std::mutex* mu)
+    : cfg_(cfg), next_(next), mu_(mu) {
+    if (level == 1) {
+        hits_ = &Metrics::l1_hits; misses_ = &Metrics::l1_misses; evictions_ = &Metrics::l1_evictions;
+    } else {
+        hits_ = &Metrics::l2_hits; misses_ = &Metrics::l2_misses; evictions_ = &Metrics::l2_evictions;
+    }
+
+    if (cfg.line_bytes < 4 || !is_pow2(cfg.line_bytes))
+        throw std::invalid_argument("Cache: line size must be a power of two of at least 4 bytes");
+    if (cfg.ways == 0 || cfg.size_bytes % (cfg.line_bytes * cfg.ways) != 0)
+        throw std::invalid_argument("Cache: size must be a multiple of line size * ways");
+    const uint64_t sets = cfg.size_bytes / ((uint64_t)cfg.line_bytes * cfg.ways);
+    if (!is_pow2(sets)) throw std::invalid_argument("Cache: set count must be a power of two");
+
+    line_shift_ = log2_of(cfg.line_bytes / 4);
+    set_mask_ = sets - 1;
+    tags_.assign(sets * cfg.ways, 0);
+    stamps_.assign(sets * cfg.ways, 0);
+    dirty_.assign(sets * cfg.ways, 0);
+}
+
+void Cache::access(uint64_t addr, bool write, Metrics& m) {
+    if (mu_) {
+        std::lock_guard<std::mutex> lock(*mu_);
+        lookup(addr, write, m);
+    } else {
+        lookup(addr, write, m);
+    }
+}
+
+void Cache::lookup(uint64_t addr, bool write, Metrics& m) {
+    const uint64_t line = addr >> line_shift_;
+    const uint64_t tag = line + 1;
+    const size_t base = (size_t)(line & set_mask_) * cfg_.ways;
+    clock_++;
+
+    for (uint32_t i = 0; i < cfg_.ways; i++) {
+        if (tags_[base + i] != tag) continue;
+        m.*hits_ += 1;
+        if (cfg_.replacement == Replacement::LRU) stamps_[base + i] = clock_;
+        if (write) {
+            if (cfg_.write == Write_policy::WriteBack) dirty_[base + i] = 1;
+            else if (next_) next_->access(addr, true, m);
+        }
+        return;
+    }
+
+    m.*misses_ += 1;
+    if (write && cfg_.write == Write_policy::WriteThrough) {
+        if (next_) next_->access(addr, true, m);   // no write-allocate
+        return;
+    }
+
+    // victim : an invalid way, else by policy
+    size_t victim = base;
+    bool found_free = false;
+    for (uint32_t i = 0; i < cfg_.ways; i++) {
+        if (tags_[base + i] == 0) { victim = base + i; found_free = true; break; }
+    }
+    if (!found_free) {
+        if (cfg_.replacement == Replacement::Random) {
+            rng_ ^= rng_ << 13; rng_ ^= rng_ >> 7; rng_ ^= rng_ << 17;
+            victim = base + (size_t)(rng_ % cfg_.ways);
+        } else {
+            for (uint32_t i = 1; i < cfg_.ways; i++)
+                if (stamps_[base + i] < stamps_[victim]) victim = base + i;
+        }
+        m.*evictions_ += 1;
+        if (dirty_[victim] && next_) next_->access((tags_[victim] - 1) << line_shift_, true, m);
+    }
+
+    if (next_) next_->access(addr, false, m);   // fill
+    tags_[victim] = tag;
+    stamps_[victim] = clock_;
+    dirty_[victim] = (write && cfg_.write == Write_policy::WriteBack) ? 1 : 0;
+}
+
+Cache_hierarchy::Cache_hierarchy(const Cache_config& l1, const Cache_config& l2, uint32_t n_sms, bool locked_l2) {
+    if (l2.enabled()) l2_ = std::make_unique<Cache>(l2, 2, nullptr, locked_l2 ? &l2_mu_ : nullptr);
+    if (l1.enabled()) {
+        l1_.reserve(n_sms);
+        for (uint32_t i = 0; i < n_sms; i++) l1_.emplace_back(l1, 1, l2_.get());
+    }
+}
+
+Cache* Cache_hierarchy::sm(uint32_t sm) {
+    if (!l1_.empty()) return &l1_[sm];
+    return l2_.get();   // L2 only : shared by every SM
+}
@@ -0,0 +1,91 @@
+#pragma once
+# include <cstdint>
+# include <memory>
+# include <mutex>
+# include <vector>
+
+struct Metrics;
+
+// ---------------- Cache hierarchy ----------------
+// Set-associative caches between LD/ST and Buffer : one L1 per SM, one L2
+// shared by all SMs. Only hits, misses and evictions are modelled; a miss
+// costs no extra cycles, so warp_cycles stay the same with caches on.
+//
+// Addresses are word addresses with the buffer id above bit 32, so the
+// three buffers never share a line. A warp memory op looks up every
+// distinct L1 line its active lanes touch, once. A fill looks up the one
+// L2 line holding the missed address, so L2 lines should be at least as
+// large as L1 lines.
+
+enum class Replacement : uint8_t { LRU, FIFO, Random };
+
+// WriteBack    : write-allocate; dirty lines go to the next level when evicted
+// WriteThrough : no write-allocate; every write also goes to the next level
+enum class Write_policy : uint8_t { WriteBack, WriteThrough };
+
+struct Cache_config {
+    uint32_t size_bytes = 0;            // 0 : level disabled
+    uint32_t line_bytes = 128;
+    uint32_t ways = 4;
+    Replacement replacement = Replacement::LRU;
+    Write_policy write = Write_policy::WriteBack;
+
+    bool enabled() const { return size_bytes != 0; }
+};
+
+class Cache {
+public:
+    // level 1 counts into Metrics::l1_*, level 2 into Metrics::l2_*.
+    // next receives the misses, write-throughs and dirty evictions. mu,
+    // when set, guards every access (a cache shared by SMs on different
+    // host threads). Throws std::invalid_argument unless line size and set
+    // count are powers of two and line_bytes >= 4.
+    Cache(const Cache_config& cfg, int level, Cache* next = nullptr, std::mutex* mu = nullptr);
+
+    // One access to the line holding word address addr.
+    void access(uint64_t addr, bool write, Metrics& m);
+
+    uint32_t line_shift() const { return line_shift_; }   // log2(words per line)
+
+private:
+    void lookup(uint64_t addr, bool write, Metrics& m);
+
+    Cache_config cfg_;
+    Cache* next_;
+    std::mutex* mu_;
+    uint64_t Metrics::* hits_;
+    uint64_t Metrics::* misses_;
+    uint64_t Metrics::* evictions_;
+
+    uint32_t line_shift_ = 0;
+    uint64_t set_mask_ = 0;
+    uint64_t clock_ = 0;                // LRU / FIFO stamps
+    uint64_t rng_ = 0x9E3779B97F4A7C15ull;
+
+    std::vector<uint64_t> tags_;        // line address + 1, 0 : invalid
+    std::vector<uint64_t> stamps_;
+    std::vector<uint8_t> dirty_;
+};
+
+// Word address of buffer buf, word word.
+inline uint64_t cache_address(uint8_t buf, uint32_t word) {
+    return ((uint64_t)buf << 32) | word;
+}
+
+// The caches of one run : an L1 per SM in front of one shared L2. Either
+// level may be disabled. locked_l2 serializes L2 lookups for SMs on
+// different host threads.
+class Cache_hierarchy {
+public:
+    Cache_hierarchy(const Cache_config& l1, const Cache_config& l2, uint32_t n_sms, bool locked_l2);
+    Cache_hierarchy(const Cache_hierarchy&) = delete;
+    Cache_hierarchy& operator=(const Cache_hierarchy&) = delete;
+
+    // First level SM sm sees, nullptr when both levels are off.
+    Cache* sm(uint32_t sm);
+
+private:
+    std::unique_ptr<Cache> l2_;
+    std::vector<Cache> l1_;
+    std::mutex l2_mu_;
+};
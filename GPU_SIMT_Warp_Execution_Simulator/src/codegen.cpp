@@ -0,0 +1,364 @@
+#include "codegen.h"
+#include <cstdlib>
+#include <dlfcn.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+// ---------------- hashing ----------------
+static void fnv_mix(uint64_t& h, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        h ^= (v >> (8 * i)) & 0xFFu;
+        h *= 1099511628211ull;
+    }
+}
+
+uint64_t hash_program(const std::vector<Instr>& program, uint32_t width, const std::string& toolchain) {
+    uint64_t h = 1469598103934665603ull;
+    fnv_mix(h, codegen_version, 4);
+    fnv_mix(h, width, 4);
+    fnv_mix(h, toolchain.size(), 8);
+    for (unsigned char c : toolchain) fnv_mix(h, c, 1);
+    fnv_mix(h, program.size(), 8);
+    for (const Instr& ins : program) {
+        fnv_mix(h, (uint64_t)ins.op, 1);
+        fnv_mix(h, ins.dst, 1);
+        fnv_mix(h, ins.a, 1);
+        fnv_mix(h, ins.b, 1);
+        fnv_mix(h, ins.buf, 1);
+        fnv_mix(h, (uint32_t)ins.imm, 4);
+        fnv_mix(h, ins.scale, 1);
+    }
+    return h;
+}
+
+bool native_supported(const std::vector<Instr>& program) {
+    for (const Instr& ins : program) {
+        switch (ins.op) {
+            case Op::ATOM_ADD:
+            case Op::ATOM_MIN:
+            case Op::ATOM_CAS:
+            case Op::SHFL_IDX:
+            case Op::SHFL_UP:
+            case Op::SHFL_DOWN:
+            case Op::SHFL_XOR:
+            case Op::BALLOT:
+            case Op::VOTE_ANY:
+            case Op::VOTE_ALL:
+            case Op::RED_ADD:
+            case Op::LDS:
+            case Op::STS:
+            case Op::BAR_SYNC:
+                return false;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+// ---------------- code emission ----------------
+// Each case leaves w.pc at the next pc and returns, exactly like one call of
+// GPU_Sim::step_warp. Anything that is a field of Instr is a literal here.
+
+// LD/ST (tid + imm) and LDX/STX (reg * scale + imm)
+static void emit_mem_loop(std::ostringstream& s, const Instr& ins) {
+    const bool store   = (ins.op == Op::ST || ins.op == Op::STX);
+    const bool indexed = (ins.op == Op::LDX || ins.op == Op::STX);
+
+    s << "        c.m[" << NM_MEM_LANE_OPS << "] += popc(mask);\n"
+      << "        uint32_t* B = c.buf[" << (int)ins.buf << "];\n"
+      << "        const uint64_t n = c.size[" << (int)ins.buf << "];\n"
+      << "        Segments seg;\n"
+      << "        for (uint64_t bits = mask; bits != 0; bits &= bits - 1) {\n"
+      << "            const uint32_t l = ctz(bits);\n";
+    if (indexed) {
+        int addr_reg = (ins.op == Op::LDX) ? ins.a : ins.b;
+        s << "            int64_t a64 = (int64_t)w.regs[" << addr_reg << "][l] * " << (int)ins.scale
+          << " + (int64_t)(" << ins.imm << ");\n"
+          << "            if (a64 < 0 || (uint64_t)a64 >= n) continue;\n"
+          << "            uint32_t a = (uint32_t)a64;\n";
+    } else {
+        s << "            int64_t a64 = (int64_t)(base + l) + (int64_t)(" << ins.imm << ");\n"
+          << "            if (a64 < 0) continue;\n"
+          << "            uint32_t a = (uint32_t)a64;\n"
+          << "            if (a >= n) continue;\n";
+    }
+    if (store) s << "            B[a] = w.regs[" << (int)ins.a << "][l];\n";
+    else       s << "            w.regs[" << (int)ins.dst << "][l] = B[a];\n";
+    s << "            seg.add(a);\n"
+      << "        }\n"
+      << "        c.m[" << NM_MEM_TRANSACTIONS << "] += seg.distinct();\n";
+}
+
+static void emit_case(std::ostringstream& s, uint32_t pc, const Instr& ins, int32_t join_pc) {
+    s << "    case " << pc << ": {\n";
+    const uint32_t next = pc + 1;
+
+    switch (ins.op) {
+        case Op::LD:
+        case Op::ST:
+        case Op::LDX:
+        case Op::STX:
+            if (ins.buf > 2) {
+                s << "        throw_bad_buffer();\n";
+                break;
+            }
+            emit_mem_loop(s, ins);
+            s << "        w.pc = " << next << "; return;\n";
+            break;
+
+        case Op::VADD:
+            s << "        for (uint32_t l = 0; l < W; l++)\n"
+              << "            if ((mask >> l) & 1u) w.regs[" << (int)ins.dst << "][l] = w.regs[" << (int)ins.a
+              << "][l] + w.regs[" << (int)ins.b << "][l];\n"
+              << "        w.pc = " << next << "; return;\n";
+            break;
+
+        case Op::CMP_LT:
+            s << "        for (uint32_t l = 0; l < W; l++)\n"
+              << "            if ((mask >> l) & 1u) w.pred[l] = w.regs[" << (int)ins.a << "][l] < w.regs[" << (int)ins.b
+              << "][l];\n"
+              << "        w.pc = " << next << "; return;\n";
+            break;
+
+        case Op::SEL:
+            s << "        for (uint32_t l = 0; l < W; l++)\n"
+              << "            if ((mask >> l) & 1u) w.regs[" << (int)ins.dst << "][l] = w.pred[l] ? w.regs[" << (int)ins.a
+              << "][l] : w.regs[" << (int)ins.b << "][l];\n"
+              << "        w.pc = " << next << "; return;\n";
+            break;
+
+        case Op::BRA: {
+            const uint32_t target = (uint32_t)ins.imm;
+            s << "        mask_t taken = 0;\n"
+              << "        for (uint64_t bits = mask; bits != 0; bits &= bits - 1) {\n"
+              << "            const uint32_t l = ctz(bits);\n"
+              << "            if (w.pred[l]) taken |= (mask_t)((mask_t)1 << l);\n"
+              << "        }\n"
+              << "        const mask_t not_taken = (mask_t)(mask & ~taken);\n"
+              << "        const bool diverged = (taken != 0) && (not_taken != 0);\n"
+              << "        if (diverged) c.m[" << NM_DIVERGENT_BRANCHES << "]++;\n";
+            if (join_pc < 0) {
+                s << "        w.pc = taken ? " << target << "u : " << next << "u; return;\n";
+            } else {
+                s << "        if (!diverged) { w.pc = taken ? " << target << "u : " << next << "u; return; }\n"
+                  << "        w.stack.push_back(Frame{not_taken, " << next << "u, " << join_pc << "u, mask});\n"
+                  << "        w.active_mask = taken;\n"
+                  << "        w.pc = " << target << "; return;\n";
+            }
+            break;
+        }
+
+        case Op::JMP:
+            s << "        w.pc = " << (uint32_t)ins.imm << "u; return;\n";
+            break;
+
+        case Op::JOIN:
+            s << "        if (!w.stack.empty() && w.stack.back().join_pc == " << pc << "u) {\n"
+              << "            Frame& fr = w.stack.back();\n"
+              << "            if (fr.deferred_mask != 0) {\n"
+              << "                w.active_mask = fr.deferred_mask;\n"
+              << "                w.pc = fr.deferred_pc;\n"
+              << "                fr.deferred_mask = 0;\n"
+              << "                c.m[" << NM_RECONVERGES << "]++;\n"
+              << "            } else {\n"
+              << "                w.active_mask = fr.reconv_mask;\n"
+              << "                w.stack.pop_back();\n"
+              << "                w.pc = " << next << ";\n"
+              << "            }\n"
+              << "        } else {\n"
+              << "            w.pc = " << next << ";\n"
+              << "        }\n"
+              << "        return;\n";
+            break;
+
+        case Op::HALT:
+        default:
+            s << "        w.halted = true; return;\n";
+            break;
+    }
+    s << "    }\n";
+}
+
+static const char* mask_type_name(uint32_t width) {
+    switch (width) {
+        case 16: return "uint16_t";
+        case 32: return "uint32_t";
+        case 64: return "uint64_t";
+        default: throw std::invalid_argument("native backend: warp width must be 16, 32 or 64");
+    }
+}
+
+std::string emit_kernel_source(const std::vector<Instr>& program,
+                               const std::vector<int32_t>& bra_to_join,
+                               uint32_t width) {
+    const char* mask_type = mask_type_name(width);
+
+    std::ostringstream s;
+    s << "// Generated by GPU_SIMT codegen v" << codegen_version
+      << " (program hash 0x" << std::hex << hash_program(program, width) << std::dec << "). Do not edit.\n"
+      << "#include <cstdint>\n"
+      << "#include <stdexcept>\n"
+      << "#include <vector>\n\n"
+      << "namespace {\n"
+      << "constexpr uint32_t W = " << width << ";\n"
+      << "using mask_t = " << mask_type << ";\n"
+      << "constexpr uint32_t PROGRAM_SIZE = " << program.size() << ";\n\n"
+      << "struct Frame { mask_t deferred_mask; uint32_t deferred_pc, join_pc; mask_t reconv_mask; };\n\n"
+      << "struct Warp {\n"
+      << "    uint32_t regs[16][W] = {};\n"
+      << "    bool pred[W] = {};\n"
+      << "    mask_t active_mask = 0;\n"
+      << "    uint32_t pc = 0;\n"
+      << "    bool halted = false;\n"
+      << "    std::vector<Frame> stack;\n"
+      << "};\n\n"
+      << "struct Ctx {\n"
+      << "    uint32_t* const* buf;\n"
+      << "    const uint64_t* size;\n"
+      << "    uint64_t* m;\n"
+      << "};\n\n"
+      << "inline uint32_t popc(uint64_t x) { return (uint32_t)__builtin_popcountll(x); }\n"
+      << "inline uint32_t ctz(uint64_t x) { return (uint32_t)__builtin_ctzll(x); }\n\n"
+      << "// distinct 128-byte segments (32 words) among the addresses added\n"
+      << "struct Segments {\n"
+      << "    uint32_t s[W];\n"
+      << "    uint32_t n = 0;\n"
+      << "    void add(uint32_t addr) {\n"
+      << "        uint32_t v = addr >> 5, i = n++;\n"
+      << "        while (i > 0 && s[i - 1] > v) { s[i] = s[i - 1]; i--; }\n"
+      << "        s[i] = v;\n"
+      << "    }\n"
+      << "    uint32_t distinct() const {\n"
+      << "        uint32_t d = 0;\n"
+      << "        for (uint32_t i = 0; i < n; i++) if (i == 0 || s[i] != s[i - 1]) d++;\n"
+      << "        return d;\n"
+      << "    }\n"
+      << "};\n\n"
+      << "[[noreturn]] void throw_bad_buffer() { throw std::out_of_range(\"Invalid buffer id\"); }\n\n"
+      << "void step(Warp& w, uint32_t base, Ctx& c) {\n"
+      << "    if (w.active_mask == 0 || w.pc >= PROGRAM_SIZE) { w.halted = true; return; }\n"
+      << "    const mask_t mask = w.active_mask;\n"
+      << "    c.m[" << NM_WARP_CYCLES << "]++;\n"
+      << "    c.m[" << NM_ACTIVE_LANE_CYCLES << "] += popc(mask);\n"
+      << "    (void)base;\n"
+      << "    switch (w.pc) {\n";
+
+    for (uint32_t pc = 0; pc < (uint32_t)program.size(); pc++) {
+        int32_t join_pc = (pc < bra_to_join.size()) ? bra_to_join[pc] : -1;
+        emit_case(s, pc, program[pc], join_pc);
+    }
+
+    s << "    default: w.halted = true; return;\n"
+      << "    }\n"
+      << "}\n"
+      << "} // namespace\n\n"
+      << "extern \"C\" void simt_kernel(uint32_t* const* bufs, const uint64_t* sizes,\n"
+      << "                              uint32_t n_threads, uint64_t* metrics) {\n"
+      << "    if (n_threads == 0) return;\n"
+      << "    Ctx c{bufs, sizes, metrics};\n"
+      << "    const uint32_t n_warps = ((n_threads - 1) / W) + 1;\n"
+      << "    std::vector<Warp> warps(n_warps);\n"
+      << "    for (uint32_t wid = 0; wid < n_warps; wid++) {\n"
+      << "        Warp& w = warps[wid];\n"
+      << "        w.active_mask = 0;\n"
+      << "        for (uint32_t l = 0; l < W; l++)\n"
+      << "            if (wid * W + l < n_threads) w.active_mask |= (mask_t)((mask_t)1 << l);\n"
+      << "    }\n"
+      << "    bool any_running = true;\n"
+      << "    while (any_running) {\n"
+      << "        any_running = false;\n"
+      << "        for (uint32_t wid = 0; wid < n_warps; wid++) {\n"
+      << "            if (warps[wid].halted) continue;\n"
+      << "            any_running = true;\n"
+      << "            step(warps[wid], wid * W, c);\n"
+      << "        }\n"
+      << "    }\n"
+      << "}\n";
+    return s.str();
+}
+
+// ---------------- Kernel_Cache ----------------
+Kernel_Cache& Kernel_Cache::instance() {
+    static Kernel_Cache cache;
+    return cache;
+}
+
+Kernel_Cache::Kernel_Cache() {
+    if (const char* env = std::getenv("SIMT_CXX")) cxx = env;
+}
+
+Kernel_Cache::~Kernel_Cache() {
+    for (void* h : handles) dlclose(h);
+}
+
+native_kernel_fn Kernel_Cache::load(const std::string& so_path) {
+    void* h = dlopen(so_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!h) throw std::runtime_error(std::string("native backend: dlopen failed: ") + dlerror());
+
+    auto fn = (native_kernel_fn)dlsym(h, "simt_kernel");
+    if (!fn) {
+        dlclose(h);
+        throw std::runtime_error("native backend: simt_kernel not found in " + so_path);
+    }
+    handles.push_back(h);
+    return fn;
+}
+
+native_kernel_fn Kernel_Cache::get(const std::vector<Instr>& program,
+                                   const std::vector<int32_t>& bra_to_join,
+                                   uint32_t width) {
+    std::lock_guard<std::mutex> lock(mu);
+
+    const uint64_t key = hash_program(program, width, cxx + " " + cxx_flags);
+    auto it = kernels.find(key);
+    if (it != kernels.end()) return it->second;
+
+    std::ostringstream name;
+    name << cache_dir << "/simt_" << std::hex << std::setw(16) << std::setfill('0') << key;
+    const std::string stem = name.str();
+    const std::string so_path = stem + ".so";
+
+    namespace fs = std::filesystem;
+    native_kernel_fn fn = nullptr;
+
+    if (fs::exists(so_path)) {
+        fn = load(so_path);
+        disk_hits++;
+    } else {
+        fs::create_directories(cache_dir);
+
+        // Source, log and object all get private names and the results are renamed
+        // into place, so concurrent processes sharing the cache never compile a
+        // half-written source or dlopen a half-written object.
+        const std::string tmp_stem = stem + ".tmp" + std::to_string((long)getpid());
+        const std::string tmp_src = tmp_stem + ".cpp";
+        const std::string tmp_path = tmp_stem + ".so";
+        const std::string log_path = tmp_stem + ".log";
+        {
+            std::ofstream src(tmp_src);
+            src << emit_kernel_source(program, bra_to_join, width);
+            if (!src) throw std::runtime_error("native backend: cannot write " + tmp_src);
+        }
+
+        const std::string cmd = cxx + " " + cxx_flags + " -o \"" + tmp_path + "\" \"" + tmp_src
+                              + "\" > \"" + log_path + "\" 2>&1";
+
+        if (std::system(cmd.c_str()) != 0) {
+            throw std::runtime_error("native backend: compile failed, see " + log_path);
+        }
+        fs::rename(tmp_src, stem + ".cpp");
+        fs::rename(tmp_path, so_path);
+        fs::remove(log_path);
+
+        fn = load(so_path);
+        compiles++;
+    }
+
+    kernels.emplace(key, fn);
+    return fn;
+}
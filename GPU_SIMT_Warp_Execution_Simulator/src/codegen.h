@@ -0,0 +1,84 @@
+#pragma once
+# include <cstdint>
+# include <mutex>
+# include <string>
+# include <unordered_map>
+# include <vector>
+# include "isa_2.h"
+
+// ---------------- Native (AOT) backend ----------------
+// A program is translated into a self-contained C++ file in which every pc
+// becomes one case of a switch, with register indices, buffer ids and
+// immediates baked in as constants. The file is compiled with the host
+// compiler into a shared object, dlopen'ed, and run by GPU_Sim::run.
+// The generated scheduler is the same round-robin as the interpreter, so
+// memory results and Metrics are identical.
+
+// Order of the counters in the uint64 array a generated kernel fills.
+// Must follow the field order of Metrics (model.h).
+enum Native_Metric : uint32_t {
+    NM_WARP_CYCLES = 0,
+    NM_ACTIVE_LANE_CYCLES,
+    NM_MEM_LANE_OPS,
+    NM_MEM_TRANSACTIONS,
+    NM_DIVERGENT_BRANCHES,
+    NM_RECONVERGES,
+    NM_COUNT
+};
+
+// Entry point exported (extern "C") by every generated kernel.
+// bufs/sizes : buf0, buf1, buf2 data pointers and element counts
+using native_kernel_fn = void (*)(uint32_t* const* bufs,
+                                  const uint64_t* sizes,
+                                  uint32_t n_threads,
+                                  uint64_t* metrics);
+
+// Bumped whenever the emitted code changes, so stale cached objects are not reused.
+constexpr uint32_t codegen_version = 7;
+
+// False if the program uses an op the generator does not emit (atomics,
+// warp intrinsics, shared memory, barriers); GPU_Sim then runs it on the
+// interpreter.
+bool native_supported(const std::vector<Instr>& program);
+
+// FNV-1a over every instruction field plus codegen_version, the warp width and
+// the compiler command line that builds the kernel (Kernel_Cache passes cxx and cxx_flags).
+uint64_t hash_program(const std::vector<Instr>& program, uint32_t width, const std::string& toolchain = "");
+
+// C++ source for one program at one warp width (16/32/64).
+// bra_to_join is GPU_Sim's BRA -> JOIN map.
+std::string emit_kernel_source(const std::vector<Instr>& program,
+                               const std::vector<int32_t>& bra_to_join,
+                               uint32_t width);
+
+// Compiled kernels keyed by program hash (program + warp width + compiler and
+// flags). Lookups hit the in-process map first, then <cache_dir>/simt_<hash>.so
+// on disk, and only then compile.
+class Kernel_Cache {
+public:
+    static Kernel_Cache& instance();
+
+    native_kernel_fn get(const std::vector<Instr>& program,
+                         const std::vector<int32_t>& bra_to_join,
+                         uint32_t width);
+
+    std::string cache_dir = "simt_kernel_cache";
+    std::string cxx = "c++";                       // overridden by $SIMT_CXX
+    std::string cxx_flags = "-std=c++17 -O2 -shared -fPIC";
+
+    uint64_t compiles = 0;   // kernels built by this process
+    uint64_t disk_hits = 0;  // kernels loaded from an existing .so
+
+    Kernel_Cache(const Kernel_Cache&) = delete;
+    Kernel_Cache& operator=(const Kernel_Cache&) = delete;
+
+private:
+    Kernel_Cache();
+    ~Kernel_Cache();
+
+    native_kernel_fn load(const std::string& so_path);
+
+    std::unordered_map<uint64_t, native_kernel_fn> kernels;
+    std::vector<void*> handles;
+    std::mutex mu;
+};
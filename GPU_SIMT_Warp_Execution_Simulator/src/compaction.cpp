@@ -0,0 +1,242 @@
+#include "model.h"
+#include "bit_utils.h"
+#include <algorithm>
+
+// ---------------- Thread-block compaction ----------------
+// Warps are grouped into blocks of compaction_block_warps. A block issues as
+// one unit: every warp it currently holds executes the same pc each round.
+// Control flow is handled per block instead of per warp:
+//  - a BRA whose lanes split across the whole block pushes one block frame
+//    and re-forms warps from the taken threads only (compaction),
+//  - the first arrival at the JOIN re-forms warps from the deferred threads,
+//  - the second restores the threads active at the BRA.
+// Thread state lives in the original ("home") warps between formations;
+// the issuing warps hold copies, written back before every re-formation.
+// Block-wide synchronization at BRA / JOIN is assumed free. The compaction
+// block is also the thread block for LDS / STS / BAR_SYNC.
+
+namespace {
+
+struct Lane_slot { uint32_t warp, lane; };  // home warp / lane of an issuing lane
+
+template <uint32_t W>
+struct Block_frame {
+    std::vector<lane_mask_t<W>> deferred;  // per home warp
+    std::vector<lane_mask_t<W>> reconv;    // threads active at the BRA
+    uint32_t deferred_pc = 0;
+    uint32_t join_pc = 0;
+    bool deferred_done = false;
+};
+
+template <uint32_t W>
+struct Block {
+    Block_state<W> state;                          // shared memory
+    Cache* cache = nullptr;
+    std::vector<Warp_state<W>> home;
+    std::vector<Warp_state<W>> warps;              // issuing warps
+    std::vector<std::array<Lane_slot, W>> slots;   // per issuing warp and lane
+    std::vector<Block_frame<W>> stack;
+    bool halted = false;
+};
+
+template <uint32_t W>
+void write_back(Block<W>& blk) {
+    for (size_t p = 0; p < blk.warps.size(); p++) {
+        const Warp_state<W>& w = blk.warps[p];
+        for_each_set_bit(w.active_mask, [&](unsigned pl) {
+            const Lane_slot s = blk.slots[p][pl];
+            Warp_state<W>& h = blk.home[s.warp];
+            for (uint32_t r = 0; r < 16; r++) h.regs[r][s.lane] = w.regs[r][pl];
+            h.pred[s.lane] = w.pred[pl];
+        });
+    }
+}
+
+// Issuing warps for the threads in set (one mask per home warp).
+// LaneAligned keeps every thread in its lane, so a lane needs as many warps
+// as home warps that have it set; Ideal packs the threads densely.
+template <uint32_t W>
+void form_warps(Block<W>& blk, const std::vector<lane_mask_t<W>>& set, uint32_t pc, Compaction mode) {
+    using mask_t = lane_mask_t<W>;
+    blk.warps.clear();
+    blk.slots.clear();
+
+    auto place = [&](uint32_t p, uint32_t pl, uint32_t wi, uint32_t hl) {
+        if (p >= blk.warps.size()) {
+            blk.warps.emplace_back();
+            blk.warps.back().pc = pc;
+            blk.warps.back().block = &blk.state;
+            blk.warps.back().cache = blk.cache;
+            blk.warps.back().warp_id = blk.home.front().warp_id + p;
+            blk.slots.emplace_back();
+        }
+        Warp_state<W>& w = blk.warps[p];
+        const Warp_state<W>& h = blk.home[wi];
+        for (uint32_t r = 0; r < 16; r++) w.regs[r][pl] = h.regs[r][hl];
+        w.pred[pl] = h.pred[hl];
+        w.tid[pl] = h.tid[hl];
+        w.active_mask |= (mask_t)((mask_t)1 << pl);
+        w.base_mask = w.active_mask;
+        blk.slots[p][pl] = Lane_slot{wi, hl};
+    };
+
+    if (mode == Compaction::LaneAligned) {
+        for (uint32_t l = 0; l < W; l++) {
+            uint32_t k = 0;
+            for (uint32_t wi = 0; wi < (uint32_t)set.size(); wi++)
+                if ((set[wi] >> l) & 1u) place(k++, l, wi, l);
+        }
+    } else {
+        uint32_t i = 0;
+        for (uint32_t wi = 0; wi < (uint32_t)set.size(); wi++) {
+            for_each_set_bit(set[wi], [&](unsigned hl) {
+                place(i / W, i % W, wi, hl);
+                i++;
+            });
+        }
+    }
+}
+
+template <uint32_t W>
+std::vector<lane_mask_t<W>> current_set(const Block<W>& blk) {
+    std::vector<lane_mask_t<W>> set(blk.home.size(), 0);
+    for (size_t p = 0; p < blk.warps.size(); p++) {
+        for_each_set_bit(blk.warps[p].active_mask, [&](unsigned pl) {
+            const Lane_slot s = blk.slots[p][pl];
+            set[s.warp] |= (lane_mask_t<W>)((lane_mask_t<W>)1 << s.lane);
+        });
+    }
+    return set;
+}
+
+template <uint32_t W>
+void charge_issue(const Block<W>& blk, Metrics& m) {
+    for (const Warp_state<W>& w : blk.warps) {
+        m.warp_cycles++;
+        m.active_lane_cycles += (uint64_t)popcount64(w.active_mask);
+    }
+}
+
+} // namespace
+
+template <uint32_t W>
+Metrics GPU_SimW<W>::run_compacted(const std::vector<Instr>& program,
+                                   const std::vector<int32_t>& bra_to_join,
+                                   Buffer& mem,
+                                   uint32_t n_threads,
+                                   bool trace) {
+    Metrics m;
+    m.warp_width = W;
+
+    const uint32_t n_warps = ((n_threads - 1) / W) + 1;
+    const uint32_t per_block = compaction_block_warps ? compaction_block_warps : 1;
+
+    Cache_hierarchy hierarchy(l1_cache, l2_cache, 1, false);
+    if (mem_trace) mem_trace->begin_run(W);
+
+    std::vector<Block<W>> blocks((n_warps + per_block - 1) / per_block);
+    for (uint32_t bi = 0; bi < (uint32_t)blocks.size(); bi++) {
+        Block<W>& blk = blocks[bi];
+        blk.cache = hierarchy.sm(0);
+        uint32_t first = bi * per_block;
+        uint32_t count = std::min(per_block, n_warps - first);
+        blk.home.resize(count);
+        blk.state.shared.assign(shared_words, 0);
+        std::vector<mask_t> live(count);
+        for (uint32_t i = 0; i < count; i++) {
+            init_warp(blk.home[i], (first + i) * W, n_threads);
+            live[i] = blk.home[i].base_mask;
+        }
+        form_warps(blk, live, 0, compaction);
+    }
+
+    bool any_running = true;
+    while (any_running) {
+        any_running = false;
+
+        for (Block<W>& blk : blocks) {
+            if (blk.halted) continue;
+            any_running = true;
+
+            const uint32_t pc = blk.warps.front().pc;
+            if (pc >= program.size()) { blk.halted = true; continue; }
+            const Instr& ins = program[pc];
+
+            if (ins.op == Op::BRA) {
+                charge_issue(blk, m);
+
+                std::vector<mask_t> taken(blk.home.size(), 0), not_taken(blk.home.size(), 0);
+                bool any_taken = false, any_not = false;
+                for (size_t p = 0; p < blk.warps.size(); p++) {
+                    const Warp_state<W>& w = blk.warps[p];
+                    mask_t t = 0;
+                    for_each_set_bit(w.active_mask, [&](unsigned pl) {
+                        const Lane_slot s = blk.slots[p][pl];
+                        const mask_t bit = (mask_t)((mask_t)1 << s.lane);
+                        if (w.pred[pl]) { taken[s.warp] |= bit; t |= (mask_t)((mask_t)1 << pl); }
+                        else            not_taken[s.warp] |= bit;
+                    });
+                    if (t != 0 && t != w.active_mask) m.divergent_branches++;
+                    any_taken |= (t != 0);
+                    any_not   |= (t != w.active_mask);
+                }
+
+                const int32_t join_pc = (pc < bra_to_join.size()) ? bra_to_join[pc] : -1;
+                if (join_pc < 0 || !any_taken || !any_not) {
+                    // uniform over the block (or unstructured) : no re-formation
+                    const uint32_t next = any_taken ? (uint32_t)ins.imm : pc + 1;
+                    for (Warp_state<W>& w : blk.warps) w.pc = next;
+                    continue;
+                }
+
+                write_back(blk);
+                Block_frame<W> fr;
+                fr.deferred    = std::move(not_taken);
+                fr.reconv      = current_set(blk);
+                fr.deferred_pc = pc + 1;
+                fr.join_pc     = (uint32_t)join_pc;
+                blk.stack.push_back(std::move(fr));
+
+                form_warps(blk, taken, (uint32_t)ins.imm, compaction);
+                m.compactions++;
+                continue;
+            }
+
+            if (ins.op == Op::JOIN && !blk.stack.empty() && blk.stack.back().join_pc == pc) {
+                charge_issue(blk, m);
+                write_back(blk);
+
+                Block_frame<W>& fr = blk.stack.back();
+                if (!fr.deferred_done) {
+                    fr.deferred_done = true;
+                    form_warps(blk, fr.deferred, fr.deferred_pc, compaction);
+                    m.reconverges++;
+                } else {
+                    std::vector<mask_t> reconv = std::move(fr.reconv);
+                    blk.stack.pop_back();
+                    form_warps(blk, reconv, pc + 1, compaction);
+                }
+                m.compactions++;
+                continue;
+            }
+
+            // straight-line instruction : every warp of the block issues it.
+            // The block issues in lockstep, so BAR_SYNC is already satisfied.
+            bool all_halted = true, barrier = false;
+            for (Warp_state<W>& w : blk.warps) {
+                step_warp(w, program, bra_to_join, mem, m, trace);
+                barrier |= w.at_barrier;
+                w.at_barrier = false;
+                all_halted &= w.halted;
+            }
+            if (barrier) m.barriers++;
+            if (all_halted) blk.halted = true;
+        }
+    }
+
+    return m;
+}
+
+template Metrics GPU_SimW<16>::run_compacted(const std::vector<Instr>&, const std::vector<int32_t>&, Buffer&, uint32_t, bool);
+template Metrics GPU_SimW<32>::run_compacted(const std::vector<Instr>&, const std::vector<int32_t>&, Buffer&, uint32_t, bool);
+template Metrics GPU_SimW<64>::run_compacted(const std::vector<Instr>&, const std::vector<int32_t>&, Buffer&, uint32_t, bool);
@@ -0,0 +1,309 @@
+#include "if_convert.h"
+#include "model.h"
+#include <array>
+
+namespace {
+
+bool is_branch(Op op) { return op == Op::BRA || op == Op::JMP; }
+
+// ops allowed in a converted path: no control flow, and safe to run on
+// lanes that would not have taken the path (out-of-range LD/LDX lanes are
+// skipped by the simulator, so loads may be speculated). CMP_LT is what an
+// inner region converted in an earlier round leaves behind; it clobbers the
+// outer pred, which try_convert then recomputes.
+bool is_path_op(Op op) {
+    return op == Op::LD || op == Op::LDX || op == Op::VADD || op == Op::SEL || op == Op::CMP_LT ||
+           op == Op::ST;
+}
+
+// registers an instruction reads
+int src_count(const Instr& ins) {
+    switch (ins.op) {
+        case Op::LDX: return 1;  // a
+        case Op::VADD:
+        case Op::SEL:
+        case Op::CMP_LT: return 2;  // a, b
+        case Op::ST:  return 1;  // a (value)
+        default:      return 0;
+    }
+}
+
+struct Path {
+    std::vector<Instr> body;    // non-store part
+    std::vector<Instr> stores;  // trailing ST
+    bool sets_pred = false;     // body holds a CMP_LT
+};
+
+// Collects [from, end) into a Path. False if an op is not allowed or a
+// non-store follows a store.
+bool collect_path(const std::vector<Instr>& p, uint32_t from, uint32_t end, Path& out) {
+    for (uint32_t pc = from; pc < end; pc++) {
+        const Instr& ins = p[pc];
+        if (!is_path_op(ins.op)) return false;
+        if (ins.op == Op::ST) out.stores.push_back(ins);
+        else if (!out.stores.empty()) return false;
+        else out.body.push_back(ins);
+        if (ins.op == Op::CMP_LT) out.sets_pred = true;
+    }
+    return true;
+}
+
+struct Region {
+    uint32_t bra = 0, join = 0;
+    std::vector<Instr> code;  // replaces [bra, join]
+};
+
+// Renames the registers a path writes to free registers.
+// map[r] is where the path's value of r lives after the path.
+bool rename_path(const Path& path, std::array<uint8_t, 16>& map,
+                 std::vector<uint8_t>& free_regs, std::vector<Instr>& out) {
+    std::array<bool, 16> renamed{};
+    for (Instr ins : path.body) {
+        if (src_count(ins) >= 1) ins.a = map[ins.a];
+        if (src_count(ins) >= 2) ins.b = map[ins.b];
+        if (ins.op == Op::CMP_LT) {   // writes pred only
+            out.push_back(ins);
+            continue;
+        }
+        if (!renamed[ins.dst]) {
+            if (free_regs.empty()) return false;
+            renamed[ins.dst] = true;
+            map[ins.dst] = free_regs.back();
+            free_regs.pop_back();
+        }
+        ins.dst = map[ins.dst];
+        out.push_back(ins);
+    }
+    return true;
+}
+
+// True if a BRA/JMP targets pc.
+bool branch_target(const std::vector<Instr>& p, uint32_t pc) {
+    for (const Instr& ins : p) {
+        if (is_branch(ins.op) && ins.imm == (int32_t)pc) return true;
+    }
+    return false;
+}
+
+// True if a BRA/JMP outside [b, j] targets a pc in (b, j].
+bool entered_from_outside(const std::vector<Instr>& p, uint32_t b, uint32_t j) {
+    for (uint32_t src = 0; src < (uint32_t)p.size(); src++) {
+        if (src >= b && src <= j) continue;
+        if (!is_branch(p[src].op) || p[src].imm < 0) continue;
+        uint32_t target = (uint32_t)p[src].imm;
+        if (target > b && target <= j) return true;
+    }
+    return false;
+}
+
+// False if reg is certainly overwritten or never read again on the path
+// starting at pc (followed through JMPs up to the first BRA/JOIN/HALT).
+bool live_from(const std::vector<Instr>& p, uint32_t pc, uint8_t reg) {
+    for (uint32_t steps = 0; pc < (uint32_t)p.size() && steps < (uint32_t)p.size(); steps++) {
+        const Instr& ins = p[pc];
+        switch (ins.op) {
+            case Op::HALT: return false;
+            case Op::JMP:  pc = (uint32_t)ins.imm; continue;
+            case Op::BRA:
+            case Op::JOIN: return true;
+            // every register field may be a source of these
+            case Op::ST: case Op::STX: case Op::LDX: case Op::LDS: case Op::STS:
+            case Op::VADD: case Op::SEL: case Op::CMP_LT:
+            case Op::ATOM_ADD: case Op::ATOM_MIN: case Op::ATOM_CAS:
+            case Op::SHFL_IDX: case Op::SHFL_UP: case Op::SHFL_DOWN: case Op::SHFL_XOR: case Op::RED_ADD:
+                if (ins.a == reg || ins.b == reg) return true;
+                if (ins.op == Op::ATOM_CAS && ins.dst == reg) return true;
+                break;
+            default:
+                break;
+        }
+        const bool writes = ins.op == Op::LD || ins.op == Op::LDX || ins.op == Op::LDS || ins.op == Op::VADD ||
+                            ins.op == Op::SEL || ins.op == Op::ATOM_ADD || ins.op == Op::ATOM_MIN ||
+                            ins.op == Op::ATOM_CAS || ins.op == Op::SHFL_IDX || ins.op == Op::SHFL_UP ||
+                            ins.op == Op::SHFL_DOWN || ins.op == Op::SHFL_XOR || ins.op == Op::BALLOT ||
+                            ins.op == Op::RED_ADD;
+        if (writes && ins.dst == reg) return false;
+        pc++;
+    }
+    return true;
+}
+
+// False if pred is certainly set again or never read on the path starting at pc.
+bool pred_live_from(const std::vector<Instr>& p, uint32_t pc) {
+    for (uint32_t steps = 0; pc < (uint32_t)p.size() && steps < (uint32_t)p.size(); steps++) {
+        switch (p[pc].op) {
+            case Op::HALT:
+            case Op::CMP_LT: return false;
+            case Op::JMP:    pc = (uint32_t)p[pc].imm; continue;
+            case Op::SEL: case Op::BRA: case Op::JOIN:
+            case Op::BALLOT: case Op::VOTE_ANY: case Op::VOTE_ALL: return true;
+            default: break;
+        }
+        pc++;
+    }
+    return true;
+}
+
+bool try_convert(const std::vector<Instr>& p, uint32_t b, uint32_t j,
+                 std::vector<uint8_t> free_regs, uint32_t max_instrs, Region& r) {
+    const uint32_t n = (uint32_t)p.size();
+    const uint32_t t = (uint32_t)p[b].imm;
+    if (t <= b + 1 || t > j) return false;
+
+    // else path : b+1 .. JMP E
+    uint32_t x = b + 1;
+    while (x < t && p[x].op != Op::JMP) x++;
+    if (x >= t) return false;
+    const uint32_t e = (uint32_t)p[x].imm;
+    const bool halt_e    = e < n && p[e].op == Op::HALT;
+    const bool halt_next = j + 1 < n && p[j + 1].op == Op::HALT;
+    if (!(e == j || e == j + 1 || (halt_e && halt_next))) return false;
+
+    // then path : t .. JOIN, optionally ending in JMP J
+    uint32_t then_end = j;
+    if (j > t && p[j - 1].op == Op::JMP) {
+        if ((uint32_t)p[j - 1].imm != j) return false;
+        then_end = j - 1;
+    }
+
+    if (entered_from_outside(p, b, j)) return false;
+
+    Path then_path, else_path;
+    if (!collect_path(p, b + 1, x, else_path)) return false;
+    if (!collect_path(p, t, then_end, then_path)) return false;
+
+    // A path that compares (an inner region converted earlier) leaves pred changed.
+    // The outer compare right before the BRA is issued again after it, which needs
+    // that compare to be the only way into the BRA, and pred dead after the region.
+    const bool recompare = then_path.sets_pred || else_path.sets_pred;
+    if (recompare) {
+        if (b == 0 || p[b - 1].op != Op::CMP_LT || branch_target(p, b)) return false;
+        if (pred_live_from(p, j + 1) || (e != j && pred_live_from(p, e))) return false;
+    }
+
+    if (then_path.stores.size() != else_path.stores.size()) return false;
+    for (size_t i = 0; i < then_path.stores.size(); i++) {
+        if (then_path.stores[i].buf != else_path.stores[i].buf) return false;
+        if (then_path.stores[i].imm != else_path.stores[i].imm) return false;
+    }
+
+    std::array<uint8_t, 16> map_t, map_e;
+    for (uint8_t i = 0; i < 16; i++) map_t[i] = map_e[i] = i;
+
+    // the paths only write renamed registers, so the compare's operands are intact
+    std::vector<Instr> code;
+    if (!rename_path(then_path, map_t, free_regs, code)) return false;
+    if (then_path.sets_pred) code.push_back(p[b - 1]);
+    if (!rename_path(else_path, map_e, free_regs, code)) return false;
+    if (else_path.sets_pred) code.push_back(p[b - 1]);
+
+    // merge every register either path wrote that is read after the region
+    for (uint8_t reg = 0; reg < 16; reg++) {
+        if (map_t[reg] == reg && map_e[reg] == reg) continue;
+        if (!live_from(p, j + 1, reg) && (e == j || !live_from(p, e, reg))) continue;
+        code.push_back({Op::SEL, reg, map_t[reg], map_e[reg], 0, 0});
+    }
+
+    // paired stores, each issued once with the selected value
+    for (size_t i = 0; i < then_path.stores.size(); i++) {
+        Instr st = then_path.stores[i];
+        uint8_t vt = map_t[st.a];
+        uint8_t ve = map_e[else_path.stores[i].a];
+        if (vt == ve) {
+            st.a = vt;
+        } else {
+            if (free_regs.empty()) return false;
+            uint8_t tmp = free_regs.back();
+            free_regs.pop_back();
+            code.push_back({Op::SEL, tmp, vt, ve, 0, 0});
+            st.a = tmp;
+        }
+        code.push_back(st);
+    }
+
+    if (code.size() > max_instrs) return false;
+
+    r.bra = b;
+    r.join = j;
+    r.code = std::move(code);
+    return true;
+}
+
+// One sweep : converts every convertible region (they never overlap, since a
+// convertible path holds no BRA) and relinks the jump targets.
+std::vector<Instr> convert_round(const std::vector<Instr>& p, uint32_t max_instrs,
+                                 uint32_t& left, uint32_t& converted) {
+    const uint32_t n = (uint32_t)p.size();
+    std::vector<int32_t> bra_to_join = compute_bra_join_map(p);
+
+    std::array<bool, 16> used{};
+    for (const Instr& ins : p) used[ins.dst & 15] = used[ins.a & 15] = used[ins.b & 15] = true;
+
+    std::vector<uint8_t> free_regs;  // taken from the back : lowest first
+    for (int reg = 15; reg >= 0; reg--)
+        if (!used[reg]) free_regs.push_back((uint8_t)reg);
+
+    // temporaries are dead after their region's SELs, so regions share them
+    std::vector<Region> regions;
+    for (uint32_t b = 0; b < n; b++) {
+        if (p[b].op != Op::BRA || bra_to_join[b] < 0) continue;
+        const uint32_t j = (uint32_t)bra_to_join[b];
+
+        Region r;
+        if (try_convert(p, b, j, free_regs, max_instrs, r)) {
+            regions.push_back(std::move(r));
+            b = j;  // skip the converted range
+        } else {
+            left++;
+        }
+    }
+    if (regions.empty()) return p;
+
+    // new pc of every old pc; -1 inside a removed range
+    std::vector<int32_t> remap(n + 1, -1);
+    std::vector<Instr> out;
+    size_t ri = 0;
+    for (uint32_t pc = 0; pc < n; pc++) {
+        if (ri < regions.size() && pc == regions[ri].bra) {
+            remap[pc] = (int32_t)out.size();
+            out.insert(out.end(), regions[ri].code.begin(), regions[ri].code.end());
+            pc = regions[ri].join;
+            ri++;
+            continue;
+        }
+        remap[pc] = (int32_t)out.size();
+        out.push_back(p[pc]);
+    }
+    remap[n] = (int32_t)out.size();
+
+    for (Instr& ins : out) {
+        if (is_branch(ins.op) && ins.imm >= 0 && (uint32_t)ins.imm <= n && remap[(uint32_t)ins.imm] >= 0)
+            ins.imm = remap[(uint32_t)ins.imm];
+    }
+
+    converted += (uint32_t)regions.size();
+    return out;
+}
+
+} // namespace
+
+std::vector<Instr> if_convert(const std::vector<Instr>& program,
+                              uint32_t max_instrs,
+                              If_convert_report* report) {
+    If_convert_report rep;
+    rep.instrs_before = (uint32_t)program.size();
+
+    std::vector<Instr> cur = program;
+    while (true) {
+        uint32_t left = 0, converted = 0;
+        std::vector<Instr> next = convert_round(cur, max_instrs, left, converted);
+        rep.regions_left = left;
+        rep.regions_converted += converted;
+        if (converted == 0) break;
+        cur = std::move(next);
+    }
+
+    rep.instrs_after = (uint32_t)cur.size();
+    if (report) *report = rep;
+    return cur;
+}
@@ -0,0 +1,40 @@
+#pragma once
+# include <cstdint>
+# include <vector>
+# include "isa_2.h"
+
+// ---------------- If-conversion ----------------
+// Rewrites short single-entry diamonds
+//
+//     CMP_LT ; BRA T ; <else> ; JMP E ; ... T: <then> ; [JMP J] ; J: JOIN
+//
+// into straight-line predicated code: both paths run on every lane, with
+// the registers each path writes renamed to free registers, then SEL picks
+// the result per lane (pred = taken = then path) and the paired stores are
+// issued once with the selected value.
+//
+// A region is converted only when
+//  - both paths are straight-line LD / LDX / VADD / SEL / CMP_LT with stores last,
+//    and the two paths store to the same (buf, imm) slots in the same order
+//    (no predicated store exists, so one-sided stores stay branchy),
+//  - E is the JOIN, the pc after it, or both E and the pc after the JOIN
+//    are HALT (so both paths continue the same way),
+//  - nothing outside the region jumps into it,
+//  - enough unused registers exist for the renaming,
+//  - the predicated code is at most max_instrs instructions. Uniform warps
+//    pay for both paths after conversion, so only short paths are worth it.
+// Nested diamonds are converted inside-out until nothing changes. A converted
+// inner region leaves a CMP_LT on the outer path; the outer region then
+// reissues its own CMP_LT after that path, so it also requires the CMP_LT
+// right before its BRA, no jump to the BRA, and pred not read after the JOIN.
+
+struct If_convert_report {
+    uint32_t regions_converted = 0;
+    uint32_t regions_left = 0;       // BRA..JOIN regions still branchy
+    uint32_t instrs_before = 0;
+    uint32_t instrs_after = 0;
+};
+
+std::vector<Instr> if_convert(const std::vector<Instr>& program,
+                              uint32_t max_instrs = 8,
+                              If_convert_report* report = nullptr);
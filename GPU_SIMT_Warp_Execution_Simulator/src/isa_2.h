@@ -1,17 +1,35 @@
 #pragma once
 #include <cstdint>
 
+// Default warp width. The simulator itself is GPU_SimW<W> (model.h) for W = 16/32/64;
+// GPU_Sim is the warp_size instantiation.
 constexpr static uint8_t warp_size = 32;
 
 enum class Op : uint8_t {
     LD,       // dst = buf[tid + imm]
     ST,       // buf[tid + imm] = reg[a]
+    LDX,      // dst = buf[reg[a] * scale + imm]      (gather)
+    STX,      // buf[reg[b] * scale + imm] = reg[a]   (scatter)
+    LDS,      // dst = shared[reg[a] * scale + imm]   (block shared memory)
+    STS,      // shared[reg[b] * scale + imm] = reg[a]
+    ATOM_ADD, // dst = old; buf[reg[a] * scale + imm] += reg[b]
+    ATOM_MIN, // dst = old; buf[reg[a] * scale + imm] = min(old, reg[b])
+    ATOM_CAS, // dst = old; if (old == reg[b]) buf[reg[a] * scale + imm] = dst (value before the op)
     VADD,     // dst = reg[a] + reg[b]
+    SHFL_IDX, // dst = reg[a] of lane (reg[b] % warp width)
+    SHFL_UP,  // dst = reg[a] of lane - imm   (own value if that is below lane 0)
+    SHFL_DOWN,// dst = reg[a] of lane + imm   (own value if that is past the last lane)
+    SHFL_XOR, // dst = reg[a] of lane ^ imm   (own value if that is past the last lane)
+    BALLOT,   // dst = bitmask of active lanes with pred set (imm = 1: upper 32 lanes at width 64)
+    VOTE_ANY, // pred = any active lane has pred set
+    VOTE_ALL, // pred = every active lane has pred set
+    RED_ADD,  // dst = sum of reg[a] over the active lanes
     CMP_LT,   // pred = (reg[a] < reg[b])
     SEL,      // dst = pred ? reg[a] : reg[b]
     BRA,      // if pred true (per lane), go to target pc (imm)
     JMP,      // unconditional jump to pc (imm)
     JOIN,     // reconvergence point for BRA
+    BAR_SYNC, // wait until every warp of the thread block has arrived
     HALT      // stop warp
 };
 
@@ -24,5 +42,7 @@ struct Instr {
 
     uint8_t buf{0};   // for LD/ST: 0,1,2
     int32_t imm{0};   // for LD/ST: addr = tid + imm
+                      // for LDX/STX/LDS/STS/ATOM_*: addr = reg * scale + imm
                       // for BRA/JMP: imm = absolute target PC (instruction index)
+    uint8_t scale{1}; // for LDX/STX/LDS/STS/ATOM_*: element stride applied to the address register
 };
@@ -0,0 +1,144 @@
+#include "model.h"
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+// ---------------- Multi-SM launch ----------------
+// Each SM owns its resident blocks and their warps and runs them with the
+// same round-robin scheduler as GPU_Sim::run. SMs share only the Buffer
+// (atomics are serialized in step_warp) and the L2, so they run on separate
+// host threads. The order in which threaded SMs reach a shared L2 varies
+// from run to run, and so do its counters; cfg.parallel = false fixes it.
+
+template <uint32_t W>
+void GPU_SimW<W>::run_sm(const std::vector<Instr>& program,
+                         const std::vector<int32_t>& bra_to_join,
+                         Buffer& mem,
+                         const Launch_config& cfg,
+                         const std::vector<uint32_t>& blocks,
+                         uint32_t sm,
+                         Cache* cache,
+                         SM_stats& st,
+                         bool trace) {
+    const uint32_t block_threads = cfg.block.count();
+    const uint32_t warps_per_block = (block_threads + W - 1) / W;
+
+    struct Resident {
+        Block_state<W> block;
+        std::vector<Warp_state<W>> warps;
+    };
+    // heap-allocated so warp / block pointers survive retiring other blocks
+    std::vector<std::unique_ptr<Resident>> resident;
+    std::vector<Warp_state<W>*> ready, next;
+    size_t queued = 0;
+
+    auto admit = [&]() {
+        while (queued < blocks.size() &&
+               resident.size() < cfg.max_blocks_per_sm &&
+               (resident.size() + 1) * warps_per_block <= cfg.max_warps_per_sm) {
+            const uint32_t first_tid = blocks[queued++] * block_threads;
+            auto r = std::make_unique<Resident>();
+            r->block.shared.assign(shared_words, 0);
+            r->block.live_warps = warps_per_block;
+            r->warps.resize(warps_per_block);
+            for (uint32_t i = 0; i < warps_per_block; i++) {
+                Warp_state<W>& w = r->warps[i];
+                init_warp(w, first_tid + i * W, first_tid + block_threads);
+                w.block = &r->block;
+                w.cache = cache;
+                w.sm = sm;
+                ready.push_back(&w);
+            }
+            resident.push_back(std::move(r));
+        }
+        uint32_t n = (uint32_t)resident.size();
+        if (n > st.peak_resident_blocks) st.peak_resident_blocks = n;
+        if (n * warps_per_block > st.peak_resident_warps) st.peak_resident_warps = n * warps_per_block;
+    };
+
+    admit();
+    for (uint64_t round = 0; !resident.empty(); round++) {
+        schedule_round(ready, next, program, bra_to_join, mem, round, st.m, trace);
+        ready.swap(next);
+
+        // retire finished blocks, then fill the freed slots
+        size_t kept = 0;
+        for (size_t b = 0; b < resident.size(); b++) {
+            if (resident[b]->block.live_warps == 0) { st.blocks++; continue; }
+            if (kept != b) resident[kept] = std::move(resident[b]);
+            kept++;
+        }
+        resident.resize(kept);
+        admit();
+    }
+}
+
+template <uint32_t W>
+Launch_metrics GPU_SimW<W>::launch(const std::vector<Instr>& source, Buffer& mem,
+                                   const Launch_config& cfg, bool trace) {
+    const uint32_t n_blocks = cfg.grid.count();
+    const uint32_t block_threads = cfg.block.count();
+    if (cfg.n_sms == 0) throw std::invalid_argument("launch: n_sms must be at least 1");
+    if (block_threads == 0) throw std::invalid_argument("launch: empty thread block");
+    if (cfg.max_blocks_per_sm == 0 || (block_threads + W - 1) / W > cfg.max_warps_per_sm)
+        throw std::invalid_argument("launch: a block does not fit the SM resident limits");
+
+    std::vector<Instr> converted;
+    if (if_conversion) converted = if_convert(source, if_conversion_max_instrs, &if_conversion_report);
+    const std::vector<Instr>& program = if_conversion ? converted : source;
+    const auto bra_to_join = compute_bra_join_map(program);
+
+    // round-robin block distribution : block b runs on SM b % n_sms
+    std::vector<std::vector<uint32_t>> queues(cfg.n_sms);
+    for (uint32_t b = 0; b < n_blocks; b++) queues[b % cfg.n_sms].push_back(b);
+
+    Launch_metrics lm;
+    lm.sm.resize(cfg.n_sms);
+    for (SM_stats& st : lm.sm) st.m.warp_width = W;
+
+    // trace output would interleave, so it keeps the SMs on this thread
+    const bool threaded = cfg.parallel && cfg.n_sms > 1 && !trace;
+    Cache_hierarchy hierarchy(l1_cache, l2_cache, cfg.n_sms, threaded);
+    if (mem_trace) mem_trace->begin_run(W);
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    if (threaded) {
+        std::vector<std::exception_ptr> errors(cfg.n_sms);
+        std::vector<std::thread> threads;
+        threads.reserve(cfg.n_sms);
+        for (uint32_t s = 0; s < cfg.n_sms; s++) {
+            threads.emplace_back([&, s]() {
+                try {
+                    run_sm(program, bra_to_join, mem, cfg, queues[s], s, hierarchy.sm(s), lm.sm[s], false);
+                } catch (...) {
+                    errors[s] = std::current_exception();
+                }
+            });
+        }
+        for (std::thread& t : threads) t.join();
+        for (const std::exception_ptr& e : errors)
+            if (e) std::rethrow_exception(e);
+    } else {
+        for (uint32_t s = 0; s < cfg.n_sms; s++)
+            run_sm(program, bra_to_join, mem, cfg, queues[s], s, hierarchy.sm(s), lm.sm[s], trace);
+    }
+
+    lm.host_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    lm.total.warp_width = W;
+    for (const SM_stats& st : lm.sm) {
+        lm.total += st.m;
+        if (st.m.warp_cycles > lm.elapsed_cycles) lm.elapsed_cycles = st.m.warp_cycles;
+    }
+    return lm;
+}
+
+template Launch_metrics GPU_SimW<16>::launch(const std::vector<Instr>&, Buffer&, const Launch_config&, bool);
+template Launch_metrics GPU_SimW<32>::launch(const std::vector<Instr>&, Buffer&, const Launch_config&, bool);
+template Launch_metrics GPU_SimW<64>::launch(const std::vector<Instr>&, Buffer&, const Launch_config&, bool);
+template void GPU_SimW<16>::run_sm(const std::vector<Instr>&, const std::vector<int32_t>&, Buffer&, const Launch_config&, const std::vector<uint32_t>&, uint32_t, Cache*, SM_stats&, bool);
+template void GPU_SimW<32>::run_sm(const std::vector<Instr>&, const std::vector<int32_t>&, Buffer&, const Launch_config&, const std::vector<uint32_t>&, uint32_t, Cache*, SM_stats&, bool);
+template void GPU_SimW<64>::run_sm(const std::vector<Instr>&, const std::vector<int32_t>&, Buffer&, const Launch_config&, const std::vector<uint32_t>&, uint32_t, Cache*, SM_stats&, bool);
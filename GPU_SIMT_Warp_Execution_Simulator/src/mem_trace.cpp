@@ -0,0 +1,209 @@
+#include "mem_trace.h"
+#include "bit_utils.h"
+#include <cstring>
+#include <stdexcept>
+
+static const char trace_magic[4] = {'S', 'M', 'T', 'R'};
+static const uint8_t trace_version = 1;
+
+// record tags and access flags
+enum : uint8_t {
+    tag_run       = 0x00,
+    tag_access    = 0x01,
+    flag_write    = 0x02,
+    flag_same_mask = 0x04,
+    flag_irregular = 0x08,
+    buf_shift     = 4,      // bits 4..5
+};
+
+static uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+// ---------------- writer ----------------
+Mem_trace_writer::Mem_trace_writer(const std::string& path)
+    : out_(path, std::ios::binary | std::ios::trunc) {
+    if (!out_) throw std::runtime_error("Mem_trace_writer: cannot create " + path);
+    buf_.reserve(1 << 16);
+    buf_.insert(buf_.end(), trace_magic, trace_magic + 4);
+    buf_.push_back(trace_version);
+}
+
+Mem_trace_writer::~Mem_trace_writer() {
+    flush();
+}
+
+void Mem_trace_writer::put_varint(uint64_t v) {
+    while (v >= 0x80) {
+        buf_.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    buf_.push_back((uint8_t)v);
+}
+
+void Mem_trace_writer::put_signed(int64_t v) {
+    put_varint(zigzag(v));
+}
+
+void Mem_trace_writer::flush() {
+    if (buf_.empty()) return;
+    out_.write((const char*)buf_.data(), (std::streamsize)buf_.size());
+    out_.flush();
+    bytes_ += buf_.size();
+    buf_.clear();
+}
+
+void Mem_trace_writer::begin_run(uint32_t warp_width) {
+    std::lock_guard<std::mutex> lock(mu_);
+    buf_.push_back(tag_run);
+    put_varint(warp_width);
+    prev_cycle_ = 0;
+    prev_sm_ = prev_warp_ = prev_pc_ = 0;
+    prev_base_[0] = prev_base_[1] = prev_base_[2] = 0;
+    prev_mask_ = 0;
+}
+
+void Mem_trace_writer::record(uint64_t cycle, uint32_t sm, uint32_t warp, uint32_t pc, uint8_t buf, bool write,
+                              const uint32_t* addr, uint64_t mask) {
+    if (mask == 0) return;
+    std::lock_guard<std::mutex> lock(mu_);
+
+    // strided : every active lane at base + stride * (lane - first lane)
+    const unsigned first = (unsigned)ctz64(mask);
+    const uint32_t base = addr[first];
+    int64_t stride = 0;
+    bool regular = true;
+    if (popcount64(mask) > 1) {
+        const unsigned second = (unsigned)ctz64(mask & (mask - 1));
+        const int64_t step = (int64_t)addr[second] - (int64_t)base;
+        if (step % (int64_t)(second - first) != 0) {
+            regular = false;
+        } else {
+            stride = step / (int64_t)(second - first);
+            for_each_set_bit(mask, [&](unsigned l) {
+                if ((int64_t)addr[l] != (int64_t)base + stride * (int64_t)(l - first)) regular = false;
+            });
+        }
+    }
+
+    uint8_t tag = tag_access | (uint8_t)(buf << buf_shift);
+    if (write) tag |= flag_write;
+    if (mask == prev_mask_) tag |= flag_same_mask;
+    if (!regular) tag |= flag_irregular;
+    buf_.push_back(tag);
+
+    put_signed((int64_t)(cycle - prev_cycle_));
+    put_signed((int64_t)sm - (int64_t)prev_sm_);
+    put_signed((int64_t)warp - (int64_t)prev_warp_);
+    put_signed((int64_t)pc - (int64_t)prev_pc_);
+    put_signed((int64_t)base - (int64_t)prev_base_[buf]);
+    if (mask != prev_mask_) put_varint(mask);
+    if (regular) {
+        put_signed(stride);
+    } else {
+        uint32_t prev = base;
+        for_each_set_bit(mask & (mask - 1), [&](unsigned l) {
+            put_signed((int64_t)addr[l] - (int64_t)prev);
+            prev = addr[l];
+        });
+    }
+
+    prev_cycle_ = cycle;
+    prev_sm_ = sm;
+    prev_warp_ = warp;
+    prev_pc_ = pc;
+    prev_base_[buf] = base;
+    prev_mask_ = mask;
+    accesses_++;
+
+    if (buf_.size() >= (1 << 16) - 1024) {
+        out_.write((const char*)buf_.data(), (std::streamsize)buf_.size());
+        bytes_ += buf_.size();
+        buf_.clear();
+    }
+}
+
+// ---------------- reader ----------------
+Mem_trace_reader::Mem_trace_reader(const std::string& path)
+    : in_(path, std::ios::binary) {
+    if (!in_) throw std::runtime_error("Mem_trace_reader: cannot open " + path);
+    char head[5];
+    if (!in_.read(head, 5) || std::memcmp(head, trace_magic, 4) != 0)
+        throw std::runtime_error("Mem_trace_reader: " + path + " is not a memory trace");
+    if ((uint8_t)head[4] != trace_version)
+        throw std::runtime_error("Mem_trace_reader: unsupported trace version");
+}
+
+int Mem_trace_reader::get() {
+    if (pos_ == buf_.size()) {
+        buf_.resize(1 << 16);
+        in_.read((char*)buf_.data(), (std::streamsize)buf_.size());
+        buf_.resize((size_t)in_.gcount());
+        pos_ = 0;
+        if (buf_.empty()) return -1;
+    }
+    return buf_[pos_++];
+}
+
+uint64_t Mem_trace_reader::get_varint() {
+    uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        int c = get();
+        if (c < 0) throw std::runtime_error("Mem_trace_reader: truncated record");
+        v |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) return v;
+    }
+    throw std::runtime_error("Mem_trace_reader: corrupt varint");
+}
+
+int64_t Mem_trace_reader::get_signed() {
+    return unzigzag(get_varint());
+}
+
+Mem_trace_reader::Record Mem_trace_reader::next(Mem_access& a) {
+    const int tag = get();
+    if (tag < 0) return Record::End;
+
+    if (tag == tag_run) {
+        warp_width = (uint32_t)get_varint();
+        if (warp_width == 0 || warp_width > 64) throw std::runtime_error("Mem_trace_reader: bad warp width");
+        prev_ = Mem_access{};
+        prev_base_[0] = prev_base_[1] = prev_base_[2] = 0;
+        return Record::Run;
+    }
+    if ((tag & 1) != tag_access || warp_width == 0)
+        throw std::runtime_error("Mem_trace_reader: corrupt record");
+
+    a.buf   = (uint8_t)((tag >> buf_shift) & 3);
+    if (a.buf > 2) throw std::runtime_error("Mem_trace_reader: corrupt record");
+    a.write = (tag & flag_write) != 0;
+    a.cycle = prev_.cycle + (uint64_t)get_signed();
+    a.sm    = (uint32_t)((int64_t)prev_.sm + get_signed());
+    a.warp  = (uint32_t)((int64_t)prev_.warp + get_signed());
+    a.pc    = (uint32_t)((int64_t)prev_.pc + get_signed());
+    const uint32_t base = (uint32_t)((int64_t)prev_base_[a.buf] + get_signed());
+    a.mask  = (tag & flag_same_mask) ? prev_.mask : get_varint();
+    if (a.mask == 0) throw std::runtime_error("Mem_trace_reader: empty lane mask");
+
+    const unsigned first = (unsigned)ctz64(a.mask);
+    a.addr[first] = base;
+    if (!(tag & flag_irregular)) {
+        const int64_t stride = get_signed();
+        for_each_set_bit(a.mask, [&](unsigned l) {
+            a.addr[l] = (uint32_t)((int64_t)base + stride * (int64_t)(l - first));
+        });
+    } else {
+        uint32_t prev = base;
+        for_each_set_bit(a.mask & (a.mask - 1), [&](unsigned l) {
+            prev = (uint32_t)((int64_t)prev + get_signed());
+            a.addr[l] = prev;
+        });
+    }
+
+    prev_.cycle = a.cycle;
+    prev_.sm = a.sm;
+    prev_.warp = a.warp;
+    prev_.pc = a.pc;
+    prev_.mask = a.mask;
+    prev_base_[a.buf] = base;
+    return Record::Access;
+}
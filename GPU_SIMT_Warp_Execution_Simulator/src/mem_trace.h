@@ -0,0 +1,88 @@
+#pragma once
+# include <cstdint>
+# include <fstream>
+# include <mutex>
+# include <string>
+# include <vector>
+
+// ---------------- Memory-access trace ----------------
+// Every global warp memory op (LD/ST/LDX/STX/ATOM_*) of an interpreted run
+// can be written to a trace file, then replayed through other cache and
+// coalescing settings without running the program again (app/trace_replay.cpp).
+//
+// File : "SMTR" + format version, then records.
+//  - run record    : a new run starts (caches start cold), with its warp width
+//  - access record : cycle (warp-instructions issued so far by the run's
+//                    SM), sm, warp, pc, buffer, write flag, lane mask and
+//                    the lanes' word addresses
+// Numbers are LEB128 varints, signed ones zigzag-coded, and every field is
+// a delta from the previous access (the base address from the previous
+// access to the same buffer). Addresses are stored as a base (first active
+// lane) plus a stride when they are base + stride * (lane - first lane),
+// which covers every LD/ST, otherwise as per-lane deltas.
+
+struct Mem_access {
+    uint64_t cycle = 0;
+    uint32_t sm = 0;
+    uint32_t warp = 0;
+    uint32_t pc = 0;
+    uint8_t buf = 0;
+    bool write = false;
+    uint64_t mask = 0;          // lanes that accessed memory
+    uint32_t addr[64] = {};     // word address of each lane in mask
+};
+
+class Mem_trace_writer {
+public:
+    // Throws std::runtime_error if the file cannot be created.
+    explicit Mem_trace_writer(const std::string& path);
+    ~Mem_trace_writer();
+
+    void begin_run(uint32_t warp_width);
+    void record(uint64_t cycle, uint32_t sm, uint32_t warp, uint32_t pc, uint8_t buf, bool write,
+                const uint32_t* addr, uint64_t mask);
+    void flush();
+
+    uint64_t accesses() const { return accesses_; }
+    uint64_t bytes() const { return bytes_; }
+
+private:
+    void put_varint(uint64_t v);
+    void put_signed(int64_t v);
+
+    std::ofstream out_;
+    std::vector<uint8_t> buf_;
+    std::mutex mu_;             // SMs of a threaded launch share the writer
+
+    uint64_t prev_cycle_ = 0;
+    uint32_t prev_sm_ = 0, prev_warp_ = 0, prev_pc_ = 0;
+    uint32_t prev_base_[3] = {};
+    uint64_t prev_mask_ = 0;
+    uint64_t accesses_ = 0, bytes_ = 0;
+};
+
+class Mem_trace_reader {
+public:
+    // Throws std::runtime_error if the file is missing or not a trace.
+    explicit Mem_trace_reader(const std::string& path);
+
+    enum class Record : uint8_t { Run, Access, End };
+
+    // Next record. Run sets warp_width, Access fills a.
+    // Throws std::runtime_error on a truncated or corrupt file.
+    Record next(Mem_access& a);
+
+    uint32_t warp_width = 0;
+
+private:
+    int get();
+    uint64_t get_varint();
+    int64_t get_signed();
+
+    std::ifstream in_;
+    std::vector<uint8_t> buf_;
+    size_t pos_ = 0;
+
+    Mem_access prev_;
+    uint32_t prev_base_[3] = {};
+};
@@ -1,18 +1,394 @@
 #include "model.h"
+#include "codegen.h"
+#include "bit_utils.h"   // Bit_utils_library: popcount / ctz / set-bit iteration
+#include <climits>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
 
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+template <uint32_t W>
+static constexpr lane_mask_t<W> full_mask() {
+    return (lane_mask_t<W>)(W == 64 ? ~0ull : ((1ull << W) - 1ull));
+}
+
+// ---------------- lane kernels ----------------
+// Each width gets its own instantiation with a fixed trip count of W, so the
+// compiler emits straight vector code (one 512-bit op per register at W=16).
+// A full mask takes the plain loop; sparse masks (after divergence) visit
+// only the set bits; anything in between blends instead of branching.
+
+template <uint32_t W>
+static inline uint32_t lane_keep(lane_mask_t<W> mask, uint32_t lane) {
+    return 0u - (uint32_t)((mask >> lane) & 1u);   // all ones if lane is active
+}
+
+// Below this many active lanes a ctz walk beats a full-width vector pass.
+template <uint32_t W>
+static inline bool is_sparse(lane_mask_t<W> mask) {
+    return popcount64(mask) <= W / 4;
+}
 
-// local helper (keeps header simpler)
-static inline uint32_t popcount32(uint32_t x) {
-#if defined(_MSC_VER)
-    return (uint32_t)__popcnt(x);
+template <uint32_t W>
+static inline void vadd_lanes(uint32_t* d, const uint32_t* a, const uint32_t* b, lane_mask_t<W> mask) {
+    if (mask == full_mask<W>()) {
+        for (uint32_t l = 0; l < W; l++) d[l] = a[l] + b[l];
+        return;
+    }
+    if (is_sparse<W>(mask)) {
+        for_each_set_bit(mask, [&](unsigned l) { d[l] = a[l] + b[l]; });
+        return;
+    }
+    for (uint32_t l = 0; l < W; l++) {
+        uint32_t keep = lane_keep<W>(mask, l);
+        d[l] = (d[l] & ~keep) | ((a[l] + b[l]) & keep);
+    }
+}
+
+template <uint32_t W>
+static inline void cmp_lt_lanes(bool* p, const uint32_t* a, const uint32_t* b, lane_mask_t<W> mask) {
+    if (mask == full_mask<W>()) {
+        for (uint32_t l = 0; l < W; l++) p[l] = a[l] < b[l];
+        return;
+    }
+    if (is_sparse<W>(mask)) {
+        for_each_set_bit(mask, [&](unsigned l) { p[l] = a[l] < b[l]; });
+        return;
+    }
+    for (uint32_t l = 0; l < W; l++) {
+        bool on = ((mask >> l) & 1u) != 0;
+        p[l] = on ? (a[l] < b[l]) : p[l];
+    }
+}
+
+template <uint32_t W>
+static inline void sel_lanes(uint32_t* d, const bool* p, const uint32_t* a, const uint32_t* b, lane_mask_t<W> mask) {
+    if (mask == full_mask<W>()) {
+        for (uint32_t l = 0; l < W; l++) d[l] = p[l] ? a[l] : b[l];
+        return;
+    }
+    if (is_sparse<W>(mask)) {
+        for_each_set_bit(mask, [&](unsigned l) { d[l] = p[l] ? a[l] : b[l]; });
+        return;
+    }
+    for (uint32_t l = 0; l < W; l++) {
+        uint32_t keep = lane_keep<W>(mask, l);
+        uint32_t v = p[l] ? a[l] : b[l];
+        d[l] = (d[l] & ~keep) | (v & keep);
+    }
+}
+
+// ---------------- memory access helpers ----------------
+// A warp memory op is served in 128-byte segments (32 words). The number of
+// distinct segments it touches is its transaction count; a fully coalesced
+// 32-lane access to consecutive words costs 1 (2 if misaligned).
+constexpr uint32_t segment_shift = 5;
+
+// Distinct segments among the addresses of the lanes in mask.
+template <uint32_t W>
+static uint32_t count_segments(const uint32_t* addr, lane_mask_t<W> mask) {
+    uint32_t seg[W];
+    uint32_t n = 0;
+    for_each_set_bit(mask, [&](unsigned l) {
+        // insertion sort; LD/ST addresses arrive already ordered, so this is linear for them
+        uint32_t s = addr[l] >> segment_shift;
+        uint32_t i = n++;
+        while (i > 0 && seg[i - 1] > s) { seg[i] = seg[i - 1]; i--; }
+        seg[i] = s;
+    });
+
+    uint32_t distinct = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (i == 0 || seg[i] != seg[i - 1]) distinct++;
+    }
+    return distinct;
+}
+
+// Looks up every distinct cache line among the addresses of the lanes in
+// mask once, in address order.
+template <uint32_t W>
+static void cache_lines(Cache& cache, uint8_t buf, const uint32_t* addr, lane_mask_t<W> mask,
+                        bool write, Metrics& m) {
+    const uint32_t shift = cache.line_shift();
+    uint32_t line[W];
+    uint32_t n = 0;
+    for_each_set_bit(mask, [&](unsigned l) {
+        uint32_t s = addr[l] >> shift;
+        uint32_t i = n++;
+        while (i > 0 && line[i - 1] > s) { line[i] = line[i - 1]; i--; }
+        line[i] = s;
+    });
+    for (uint32_t i = 0; i < n; i++) {
+        if (i > 0 && line[i] == line[i - 1]) continue;
+        cache.access(cache_address(buf, line[i] << shift), write, m);
+    }
+}
+
+// Shared memory passes for one warp access : the most distinct words that
+// fall into a single bank (lanes reading the same word share a pass).
+template <uint32_t W>
+static uint32_t bank_conflict_degree(const uint32_t* addr, lane_mask_t<W> mask) {
+    uint32_t words[W];
+    uint32_t n = 0;
+    for_each_set_bit(mask, [&](unsigned l) {
+        uint32_t a = addr[l];
+        uint32_t i = n++;
+        while (i > 0 && words[i - 1] > a) { words[i] = words[i - 1]; i--; }
+        words[i] = a;
+    });
+
+    uint8_t per_bank[shared_banks] = {};
+    uint32_t degree = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (i > 0 && words[i] == words[i - 1]) continue;
+        uint32_t d = ++per_bank[words[i] % shared_banks];
+        if (d > degree) degree = d;
+    }
+    return degree;
+}
+
+// LDX/STX addresses: reg * scale + imm per lane. Returns the active lanes
+// whose address is inside the buffer; the others are left out of the access.
+template <uint32_t W>
+static lane_mask_t<W> indexed_addresses(uint32_t* addr, const uint32_t* r, uint8_t scale, int32_t imm,
+                                        lane_mask_t<W> active, uint64_t size) {
+    uint64_t ok = 0;
+    for (uint32_t l = 0; l < W; l++) {
+        int64_t a64 = (int64_t)r[l] * (int64_t)scale + (int64_t)imm;
+        bool in = (a64 >= 0) && ((uint64_t)a64 < size);
+        addr[l] = in ? (uint32_t)a64 : 0u;
+        ok |= (uint64_t)in << l;
+    }
+    return (lane_mask_t<W>)(ok & active);
+}
+
+// d[l] = base[idx[l]] for the lanes in mask.
+// AVX-512 / AVX2 builds use the hardware gather (16 / 8 lanes per instruction);
+// indices are signed 32-bit there, hence the size check.
+template <uint32_t W>
+static void gather_lanes(uint32_t* d, const uint32_t* base, const uint32_t* idx,
+                         lane_mask_t<W> mask, uint64_t size) {
+#if defined(__AVX512F__)
+    if (size <= (uint64_t)INT32_MAX) {
+        for (uint32_t c = 0; c < W; c += 16) {
+            __mmask16 k = (__mmask16)((uint64_t)mask >> c);
+            if (!k) continue;
+            __m512i vi = _mm512_loadu_si512(idx + c);
+            __m512i vd = _mm512_loadu_si512(d + c);
+            vd = _mm512_mask_i32gather_epi32(vd, k, vi, base, 4);
+            _mm512_storeu_si512(d + c, vd);
+        }
+        return;
+    }
+#elif defined(__AVX2__)
+    if (size <= (uint64_t)INT32_MAX) {
+        const __m256i lane_bit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        for (uint32_t c = 0; c < W; c += 8) {
+            int bits = (int)(((uint64_t)mask >> c) & 0xFFu);
+            if (!bits) continue;
+            __m256i vm = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), lane_bit), lane_bit);
+            __m256i vi = _mm256_loadu_si256((const __m256i*)(idx + c));
+            __m256i vd = _mm256_loadu_si256((const __m256i*)(d + c));
+            vd = _mm256_mask_i32gather_epi32(vd, (const int*)base, vi, vm, 4);
+            _mm256_storeu_si256((__m256i*)(d + c), vd);
+        }
+        return;
+    }
+#endif
+    (void)size;
+    for_each_set_bit(mask, [&](unsigned l) { d[l] = base[idx[l]]; });
+}
+
+// base[idx[l]] = v[l] for the lanes in mask; on a collision the highest lane
+// wins, both in the scalar loop and in the AVX-512 scatter (which orders
+// overlapping writes from the lowest lane to the highest). AVX2 has no scatter.
+template <uint32_t W>
+static void scatter_lanes(uint32_t* base, const uint32_t* idx, const uint32_t* v,
+                          lane_mask_t<W> mask, uint64_t size) {
+#if defined(__AVX512F__)
+    if (size <= (uint64_t)INT32_MAX) {
+        for (uint32_t c = 0; c < W; c += 16) {
+            __mmask16 k = (__mmask16)((uint64_t)mask >> c);
+            if (!k) continue;
+            __m512i vi = _mm512_loadu_si512(idx + c);
+            __m512i vv = _mm512_loadu_si512(v + c);
+            _mm512_mask_i32scatter_epi32(base, k, vi, vv, 4);
+        }
+        return;
+    }
+#endif
+    (void)size;
+    for_each_set_bit(mask, [&](unsigned l) { base[idx[l]] = v[l]; });
+}
+
+// ---------------- atomics ----------------
+// Warp-aggregated: the lanes of one warp that hit the same address form a
+// group, each group is resolved in registers in lane order (lowest first),
+// and memory is read and written once per address. Every lane still gets the
+// old value it would have seen had the lanes gone one after another.
+// Returns the deepest group, i.e. the serialization depth of the instruction.
+template <uint32_t W>
+static uint32_t atomic_lanes(Op op, uint32_t* base, const uint32_t* addr, lane_mask_t<W> mask,
+                             const uint32_t* val, uint32_t* dst) {
+    // lanes ordered by address; lane order is kept inside a group (stable)
+    uint32_t order[W];
+    uint32_t n = 0;
+    for_each_set_bit(mask, [&](unsigned l) {
+        uint32_t i = n++;
+        while (i > 0 && addr[order[i - 1]] > addr[l]) { order[i] = order[i - 1]; i--; }
+        order[i] = l;
+    });
+
+    uint32_t max_depth = 0;
+    for (uint32_t i = 0; i < n;) {
+        const uint32_t a = addr[order[i]];
+        uint32_t cur = base[a];
+        uint32_t j = i;
+
+        for (; j < n && addr[order[j]] == a; j++) {
+            const uint32_t l = order[j];
+            const uint32_t old = cur;
+            switch (op) {
+                case Op::ATOM_ADD: cur = old + val[l]; break;
+                case Op::ATOM_MIN: cur = (val[l] < old) ? val[l] : old; break;
+                case Op::ATOM_CAS: if (old == val[l]) cur = dst[l]; break;
+                default: break;
+            }
+            dst[l] = old;
+        }
+
+        base[a] = cur;
+        if (j - i > max_depth) max_depth = j - i;
+        i = j;
+    }
+    return max_depth;
+}
+
+// Serializes atomic warp-instructions across host threads.
+static std::mutex atomic_mu;
+
+// ---------------- warp intrinsics ----------------
+
+// Pred bits of all lanes as a mask (BALLOT / VOTE). bools are 0/1 bytes, so
+// SSE2 (baseline on x86-64) packs 16 lanes per movemask.
+template <uint32_t W>
+static lane_mask_t<W> pack_pred(const bool* pred) {
+    uint64_t bits = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (uint32_t c = 0; c < W; c += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(pred + c));
+        bits |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(v, zero)) << c;
+    }
 #else
-    return (uint32_t)__builtin_popcount(x);
+    for (uint32_t l = 0; l < W; l++) bits |= (uint64_t)pred[l] << l;
+#endif
+    return (lane_mask_t<W>)bits;
+}
+
+// Source lane of every lane for a SHFL; lanes whose source would fall outside
+// the warp read their own value.
+template <uint32_t W>
+static void shfl_sources(uint32_t* src, Op op, const uint32_t* idx_reg, int32_t imm) {
+    const uint32_t d = (uint32_t)imm;
+    for (uint32_t l = 0; l < W; l++) {
+        switch (op) {
+            case Op::SHFL_IDX:  src[l] = idx_reg[l] & (W - 1); break;
+            case Op::SHFL_UP:   src[l] = (l >= d) ? l - d : l; break;
+            case Op::SHFL_DOWN: src[l] = (d < W - l) ? l + d : l; break;
+            default:            src[l] = ((l ^ d) < W) ? (l ^ d) : l; break;   // SHFL_XOR
+        }
+    }
+}
+
+// out[l] = v[src[l]] : a cross-lane permute of one register.
+// AVX-512 does it in registers: vpermt2d for 16 and 32 lanes, and two
+// vpermt2d plus a blend on index bit 5 for 64.
+template <uint32_t W>
+static void permute_lanes(uint32_t* out, const uint32_t* v, const uint32_t* src) {
+#if defined(__AVX512F__)
+    if constexpr (W == 16) {
+        __m512i idx = _mm512_loadu_si512(src);
+        __m512i all = _mm512_loadu_si512(v);
+        _mm512_storeu_si512(out, _mm512_permutex2var_epi32(all, idx, all));
+        return;
+    } else if constexpr (W == 32) {
+        __m512i lo = _mm512_loadu_si512(v);
+        __m512i hi = _mm512_loadu_si512(v + 16);
+        for (uint32_t c = 0; c < W; c += 16) {
+            __m512i idx = _mm512_loadu_si512(src + c);
+            _mm512_storeu_si512(out + c, _mm512_permutex2var_epi32(lo, idx, hi));
+        }
+        return;
+    } else {
+        __m512i q0 = _mm512_loadu_si512(v);
+        __m512i q1 = _mm512_loadu_si512(v + 16);
+        __m512i q2 = _mm512_loadu_si512(v + 32);
+        __m512i q3 = _mm512_loadu_si512(v + 48);
+        const __m512i bit5 = _mm512_set1_epi32(32);
+        for (uint32_t c = 0; c < W; c += 16) {
+            __m512i idx = _mm512_loadu_si512(src + c);
+            __m512i lo = _mm512_permutex2var_epi32(q0, idx, q1);
+            __m512i hi = _mm512_permutex2var_epi32(q2, idx, q3);
+            __mmask16 upper = _mm512_test_epi32_mask(idx, bit5);
+            _mm512_storeu_si512(out + c, _mm512_mask_blend_epi32(upper, lo, hi));
+        }
+        return;
+    }
 #endif
+    for (uint32_t l = 0; l < W; l++) out[l] = v[src[l]];
+}
+
+// d[l] = v[l] on active lanes, blended so the loop vectorizes
+template <uint32_t W>
+static void write_active(uint32_t* d, const uint32_t* v, lane_mask_t<W> mask) {
+    for (uint32_t l = 0; l < W; l++) {
+        uint32_t keep = lane_keep<W>(mask, l);
+        d[l] = (d[l] & ~keep) | (v[l] & keep);
+    }
+}
+
+// Sum of v over the active lanes (masked vector add + horizontal reduce)
+template <uint32_t W>
+static uint32_t reduce_add_lanes(const uint32_t* v, lane_mask_t<W> mask) {
+    uint32_t sum = 0;
+    for (uint32_t l = 0; l < W; l++) sum += v[l] & lane_keep<W>(mask, l);
+    return sum;
 }
 
 // ---------------- Buffer ----------------
+Metrics& Metrics::operator+=(const Metrics& o) {
+    warp_cycles            += o.warp_cycles;
+    active_lane_cycles     += o.active_lane_cycles;
+    mem_lane_ops           += o.mem_lane_ops;
+    mem_transactions       += o.mem_transactions;
+    divergent_branches     += o.divergent_branches;
+    reconverges            += o.reconverges;
+    atomic_lane_ops        += o.atomic_lane_ops;
+    atomic_serial_depth    += o.atomic_serial_depth;
+    atomic_conflict_cycles += o.atomic_conflict_cycles;
+    shfl_lane_ops          += o.shfl_lane_ops;
+    vote_ops               += o.vote_ops;
+    reduce_ops             += o.reduce_ops;
+    compactions            += o.compactions;
+    shared_lane_ops        += o.shared_lane_ops;
+    bank_conflict_cycles   += o.bank_conflict_cycles;
+    barriers               += o.barriers;
+    barrier_stall_cycles   += o.barrier_stall_cycles;
+    l1_hits                += o.l1_hits;
+    l1_misses              += o.l1_misses;
+    l1_evictions           += o.l1_evictions;
+    l2_hits                += o.l2_hits;
+    l2_misses              += o.l2_misses;
+    l2_evictions           += o.l2_evictions;
+    return *this;
+}
+
 std::vector<uint32_t>& Buffer::get(uint8_t id) {
     switch (id) {
         case 0: return buf0;
@@ -22,22 +398,39 @@ std::vector<uint32_t>& Buffer::get(uint8_t id) {
     }
 };
 
-const char* GPU_Sim::op_name(Op op) {
+template <uint32_t W>
+const char* GPU_SimW<W>::op_name(Op op) {
     switch (op) {
         case Op::LD: return "LD";
         case Op::ST: return "ST";
+        case Op::LDX: return "LDX";
+        case Op::STX: return "STX";
+        case Op::LDS: return "LDS";
+        case Op::STS: return "STS";
+        case Op::ATOM_ADD: return "ATOM_ADD";
+        case Op::ATOM_MIN: return "ATOM_MIN";
+        case Op::ATOM_CAS: return "ATOM_CAS";
         case Op::VADD: return "VADD";
+        case Op::SHFL_IDX: return "SHFL_IDX";
+        case Op::SHFL_UP: return "SHFL_UP";
+        case Op::SHFL_DOWN: return "SHFL_DOWN";
+        case Op::SHFL_XOR: return "SHFL_XOR";
+        case Op::BALLOT: return "BALLOT";
+        case Op::VOTE_ANY: return "VOTE_ANY";
+        case Op::VOTE_ALL: return "VOTE_ALL";
+        case Op::RED_ADD: return "RED_ADD";
         case Op::CMP_LT: return "CMP_LT";
         case Op::SEL: return "SEL";
         case Op::BRA: return "BRA";
         case Op::JMP: return "JMP";
         case Op::JOIN: return "JOIN";
+        case Op::BAR_SYNC: return "BAR_SYNC";
         case Op::HALT: return "HALT";
         default: return "?";
     }
 }
 
-std::vector<int32_t> GPU_Sim::compute_bra_join_map(const std::vector<Instr>& program) const {
+std::vector<int32_t> compute_bra_join_map(const std::vector<Instr>& program) {
     std::vector<int32_t> bra_to_join(program.size(), -1);
     std::vector<uint32_t> stack; // holds BRA pcs waiting for a JOIN
 
@@ -57,31 +450,31 @@ std::vector<int32_t> GPU_Sim::compute_bra_join_map(const std::vector<Instr>& pro
 }
 
 
-void GPU_Sim::init_warp(Warp_state& w, uint32_t warp_base_tid, uint32_t n_threads) {
-    w.base_mask = 0;
-    for (int lane = 0; lane < warp_size; lane++) {
-        uint32_t tid = warp_base_tid + (uint32_t)lane;
-        if (tid < n_threads) w.base_mask |= (1u << lane);
-    }
+template <uint32_t W>
+void GPU_SimW<W>::init_warp(Warp_state<W>& w, uint32_t warp_base_tid, uint32_t n_threads) {
+    // lanes with tid < n_threads are the low (n_threads - warp_base_tid) bits
+    uint32_t live = (n_threads > warp_base_tid) ? n_threads - warp_base_tid : 0;
+    w.base_mask = (live >= W) ? full_mask<W>() : (mask_t)(((mask_t)1 << live) - 1u);
 
     w.active_mask = w.base_mask;
     w.pc = 0;
     w.halted = false;
+    w.at_barrier = false;
     w.stack.clear();
 
-    for (int lane = 0; lane < warp_size; lane++) {
-        w.pred[lane] = false;
-        for (int r = 0; r < 16; r++) w.regs[lane][r] = 0;
-    }
+    w.pred.fill(false);
+    for (auto& r : w.regs) r.fill(0);
+    for (uint32_t l = 0; l < W; l++) w.tid[l] = warp_base_tid + l;
+    w.warp_id = warp_base_tid / W;
 }
 
-void GPU_Sim::step_warp(Warp_state& w,
-                        const std::vector<Instr>& program,
-                        const std::vector<int32_t>& bra_to_join,
-                        Buffer& mem,
-                        uint32_t warp_base_tid,
-                        Metrics& m,
-                        bool trace) {
+template <uint32_t W>
+void GPU_SimW<W>::step_warp(Warp_state<W>& w,
+                            const std::vector<Instr>& program,
+                            const std::vector<int32_t>& bra_to_join,
+                            Buffer& mem,
+                            Metrics& m,
+                            bool trace) {
     if (w.halted) return;
     if (w.active_mask == 0) { w.halted = true; return; }
     if (w.pc >= program.size()) { w.halted = true; return; }
@@ -89,95 +482,229 @@ void GPU_Sim::step_warp(Warp_state& w,
     const Instr& ins = program[w.pc];
 
     m.warp_cycles++;
-    m.active_lane_cycles += (uint64_t)popcount32(w.active_mask);
+    m.active_lane_cycles += (uint64_t)popcount64(w.active_mask);
 
     if (trace) {
         std::cout << "pc=" << w.pc
                   << " op=" << op_name(ins.op)
-                  << " mask=0x" << std::hex << w.active_mask << std::dec
+                  << " mask=0x" << std::hex << (uint64_t)w.active_mask << std::dec
                   << " stack=" << w.stack.size()
                   << "\n";
     }
 
-    auto lane_active = [&](int lane) -> bool {
-        return ((w.active_mask >> lane) & 1u) != 0;
-    };
-
     switch (ins.op) {
         case Op::LD: {
-            m.mem_lane_ops += (uint64_t)popcount32(w.active_mask);
+            m.mem_lane_ops += (uint64_t)popcount64(w.active_mask);
             const auto& B = mem.get(ins.buf);
+            auto& D = w.regs[ins.dst];
+            uint32_t addrs[W];
+            mask_t touched = 0;
 
-            for (int lane = 0; lane < warp_size; lane++) {
-                if (!lane_active(lane)) continue;
-
-                uint32_t tid = warp_base_tid + (uint32_t)lane;
+            for_each_set_bit(w.active_mask, [&](unsigned lane) {
+                uint32_t tid = w.tid[lane];
                 int64_t addr64 = (int64_t)tid + (int64_t)ins.imm;
-                if (addr64 < 0) continue;
+                if (addr64 < 0) return;
                 uint32_t addr = (uint32_t)addr64;
 
-                if (addr < B.size()) w.regs[lane][ins.dst] = B[addr];
-            }
+                if (addr < B.size()) {
+                    D[lane] = B[addr];
+                    addrs[lane] = addr;
+                    touched |= (mask_t)((mask_t)1 << lane);
+                }
+            });
+            m.mem_transactions += count_segments<W>(addrs, touched);
+            if (w.cache) cache_lines<W>(*w.cache, ins.buf, addrs, touched, false, m);
+            if (mem_trace) mem_trace->record(m.warp_cycles, w.sm, w.warp_id, w.pc, ins.buf, false, addrs, (uint64_t)touched);
             w.pc++;
             break;
         }
 
         case Op::ST: {
-            m.mem_lane_ops += (uint64_t)popcount32(w.active_mask);
+            m.mem_lane_ops += (uint64_t)popcount64(w.active_mask);
             auto& B = mem.get(ins.buf);
+            const auto& S = w.regs[ins.a];
+            uint32_t addrs[W];
+            mask_t touched = 0;
 
-            for (int lane = 0; lane < warp_size; lane++) {
-                if (!lane_active(lane)) continue;
-
-                uint32_t tid = warp_base_tid + (uint32_t)lane;
+            for_each_set_bit(w.active_mask, [&](unsigned lane) {
+                uint32_t tid = w.tid[lane];
                 int64_t addr64 = (int64_t)tid + (int64_t)ins.imm;
-                if (addr64 < 0) continue;
+                if (addr64 < 0) return;
                 uint32_t addr = (uint32_t)addr64;
 
-                if (addr < B.size()) B[addr] = w.regs[lane][ins.a];
+                if (addr < B.size()) {
+                    B[addr] = S[lane];
+                    addrs[lane] = addr;
+                    touched |= (mask_t)((mask_t)1 << lane);
+                }
+            });
+            m.mem_transactions += count_segments<W>(addrs, touched);
+            if (w.cache) cache_lines<W>(*w.cache, ins.buf, addrs, touched, true, m);
+            if (mem_trace) mem_trace->record(m.warp_cycles, w.sm, w.warp_id, w.pc, ins.buf, true, addrs, (uint64_t)touched);
+            w.pc++;
+            break;
+        }
+
+        case Op::LDX: {
+            m.mem_lane_ops += (uint64_t)popcount64(w.active_mask);
+            const auto& B = mem.get(ins.buf);
+            uint32_t addrs[W];
+
+            mask_t in = indexed_addresses<W>(addrs, w.regs[ins.a].data(), ins.scale, ins.imm,
+                                             w.active_mask, B.size());
+            m.mem_transactions += count_segments<W>(addrs, in);
+            if (w.cache) cache_lines<W>(*w.cache, ins.buf, addrs, in, false, m);
+            if (mem_trace) mem_trace->record(m.warp_cycles, w.sm, w.warp_id, w.pc, ins.buf, false, addrs, (uint64_t)in);
+            gather_lanes<W>(w.regs[ins.dst].data(), B.data(), addrs, in, B.size());
+            w.pc++;
+            break;
+        }
+
+        case Op::STX: {
+            m.mem_lane_ops += (uint64_t)popcount64(w.active_mask);
+            auto& B = mem.get(ins.buf);
+            uint32_t addrs[W];
+
+            mask_t in = indexed_addresses<W>(addrs, w.regs[ins.b].data(), ins.scale, ins.imm,
+                                             w.active_mask, B.size());
+            m.mem_transactions += count_segments<W>(addrs, in);
+            if (w.cache) cache_lines<W>(*w.cache, ins.buf, addrs, in, true, m);
+            if (mem_trace) mem_trace->record(m.warp_cycles, w.sm, w.warp_id, w.pc, ins.buf, true, addrs, (uint64_t)in);
+            scatter_lanes<W>(B.data(), addrs, w.regs[ins.a].data(), in, B.size());
+            w.pc++;
+            break;
+        }
+
+        case Op::LDS:
+        case Op::STS: {
+            if (!w.block) throw std::runtime_error("LDS/STS outside a thread block");
+            auto& S = w.block->shared;
+            const bool store = (ins.op == Op::STS);
+            uint32_t addrs[W];
+
+            mask_t in = indexed_addresses<W>(addrs, w.regs[store ? ins.b : ins.a].data(), ins.scale, ins.imm,
+                                             w.active_mask, S.size());
+            m.shared_lane_ops += (uint64_t)popcount64(w.active_mask);
+            uint32_t degree = bank_conflict_degree<W>(addrs, in);
+            if (degree > 1) m.bank_conflict_cycles += degree - 1;
+
+            if (store) scatter_lanes<W>(S.data(), addrs, w.regs[ins.a].data(), in, S.size());
+            else       gather_lanes<W>(w.regs[ins.dst].data(), S.data(), addrs, in, S.size());
+            w.pc++;
+            break;
+        }
+
+        case Op::ATOM_ADD:
+        case Op::ATOM_MIN:
+        case Op::ATOM_CAS: {
+            m.mem_lane_ops += (uint64_t)popcount64(w.active_mask);
+            auto& B = mem.get(ins.buf);
+            uint32_t addrs[W];
+
+            mask_t in = indexed_addresses<W>(addrs, w.regs[ins.a].data(), ins.scale, ins.imm,
+                                             w.active_mask, B.size());
+            m.mem_transactions += count_segments<W>(addrs, in);
+            if (w.cache) cache_lines<W>(*w.cache, ins.buf, addrs, in, true, m);
+            if (mem_trace) mem_trace->record(m.warp_cycles, w.sm, w.warp_id, w.pc, ins.buf, true, addrs, (uint64_t)in);
+
+            uint32_t depth;
+            {
+                // SMs of a launch() may run on different host threads
+                std::lock_guard<std::mutex> lock(atomic_mu);
+                depth = atomic_lanes<W>(ins.op, B.data(), addrs, in,
+                                        w.regs[ins.b].data(), w.regs[ins.dst].data());
             }
+            m.atomic_lane_ops += (uint64_t)popcount64(in);
+            m.atomic_serial_depth += depth;
+            if (depth > 1) m.atomic_conflict_cycles += depth - 1;
             w.pc++;
             break;
         }
 
         case Op::VADD: {
-            for (int lane = 0; lane < warp_size; lane++) {
-                if (!lane_active(lane)) continue;
-                w.regs[lane][ins.dst] = w.regs[lane][ins.a] + w.regs[lane][ins.b];
+            vadd_lanes<W>(w.regs[ins.dst].data(), w.regs[ins.a].data(), w.regs[ins.b].data(), w.active_mask);
+            w.pc++;
+            break;
+        }
+
+        case Op::SHFL_IDX:
+        case Op::SHFL_UP:
+        case Op::SHFL_DOWN:
+        case Op::SHFL_XOR: {
+            m.shfl_lane_ops += (uint64_t)popcount64(w.active_mask);
+            alignas(64) uint32_t src[W];
+            alignas(64) uint32_t moved[W];
+
+            // all sources are read before dst is written, so dst may equal a
+            shfl_sources<W>(src, ins.op, w.regs[ins.b].data(), ins.imm);
+            permute_lanes<W>(moved, w.regs[ins.a].data(), src);
+            write_active<W>(w.regs[ins.dst].data(), moved, w.active_mask);
+            w.pc++;
+            break;
+        }
+
+        case Op::BALLOT: {
+            m.vote_ops++;
+            uint64_t ballot = (uint64_t)(pack_pred<W>(w.pred.data()) & w.active_mask);
+            uint32_t word = (uint32_t)(ballot >> (ins.imm == 1 ? 32 : 0));
+
+            auto& D = w.regs[ins.dst];
+            for (uint32_t l = 0; l < W; l++) {
+                uint32_t keep = lane_keep<W>(w.active_mask, l);
+                D[l] = (D[l] & ~keep) | (word & keep);
             }
             w.pc++;
             break;
         }
 
-        case Op::CMP_LT: {
-            for (int lane = 0; lane < warp_size; lane++) {
-                if (!lane_active(lane)) continue;
-                w.pred[lane] = (w.regs[lane][ins.a] < w.regs[lane][ins.b]);
+        case Op::VOTE_ANY:
+        case Op::VOTE_ALL: {
+            m.vote_ops++;
+            mask_t ballot = (mask_t)(pack_pred<W>(w.pred.data()) & w.active_mask);
+            bool vote = (ins.op == Op::VOTE_ANY) ? (ballot != 0) : (ballot == w.active_mask);
+
+            for (uint32_t l = 0; l < W; l++) {
+                bool on = ((w.active_mask >> l) & 1u) != 0;
+                w.pred[l] = on ? vote : w.pred[l];
             }
             w.pc++;
             break;
         }
 
-        case Op::SEL: {
-            for (int lane = 0; lane < warp_size; lane++) {
-                if (!lane_active(lane)) continue;
-                uint32_t A = w.regs[lane][ins.a];
-                uint32_t B = w.regs[lane][ins.b];
-                w.regs[lane][ins.dst] = w.pred[lane] ? A : B;
+        case Op::RED_ADD: {
+            m.reduce_ops++;
+            uint32_t sum = reduce_add_lanes<W>(w.regs[ins.a].data(), w.active_mask);
+
+            auto& D = w.regs[ins.dst];
+            for (uint32_t l = 0; l < W; l++) {
+                uint32_t keep = lane_keep<W>(w.active_mask, l);
+                D[l] = (D[l] & ~keep) | (sum & keep);
             }
             w.pc++;
             break;
         }
 
+        case Op::CMP_LT: {
+            cmp_lt_lanes<W>(w.pred.data(), w.regs[ins.a].data(), w.regs[ins.b].data(), w.active_mask);
+            w.pc++;
+            break;
+        }
+
+        case Op::SEL: {
+            sel_lanes<W>(w.regs[ins.dst].data(), w.pred.data(),
+                         w.regs[ins.a].data(), w.regs[ins.b].data(), w.active_mask);
+            w.pc++;
+            break;
+        }
+
         case Op::BRA: {
-            uint32_t taken = 0;
-            uint32_t not_taken = 0;
+            mask_t taken = 0;
+            mask_t not_taken = 0;
 
-            for (int lane = 0; lane < warp_size; lane++) {
-                if (!lane_active(lane)) continue;
-                if (w.pred[lane]) taken |= (1u << lane);
-                else              not_taken |= (1u << lane);
-            }
+            for_each_set_bit(w.active_mask, [&](unsigned lane) {
+                if (w.pred[lane]) taken |= (mask_t)((mask_t)1 << lane);
+            });
+            not_taken = (mask_t)(w.active_mask & ~taken);
 
             bool diverged = (taken != 0) && (not_taken != 0);
             if (diverged) m.divergent_branches++;
@@ -195,13 +722,13 @@ void GPU_Sim::step_warp(Warp_state& w,
             }
 
             // Diverged : execute taken now, defer not-taken
-            StackFrame fr;
+            StackFrame<W> fr;
             fr.deferred_mask = not_taken;
             fr.deferred_pc   = fallthrough_pc;
             fr.join_pc       = (uint32_t)join_pc;
+            fr.reconv_mask   = w.active_mask;
             w.stack.push_back(fr);
 
-
             w.active_mask = taken;
             w.pc = target_pc;
             break;
@@ -214,18 +741,33 @@ void GPU_Sim::step_warp(Warp_state& w,
 
         case Op::JOIN: {
             if (!w.stack.empty() && w.stack.back().join_pc == w.pc) {
-                StackFrame fr = w.stack.back();
-                w.stack.pop_back();
-
-                w.active_mask = fr.deferred_mask;
-                w.pc = fr.deferred_pc;
-                m.reconverges++;
+                StackFrame<W>& fr = w.stack.back();
+
+                if (fr.deferred_mask != 0) {
+                    // first path done : run the deferred one up to this JOIN
+                    w.active_mask = fr.deferred_mask;
+                    w.pc = fr.deferred_pc;
+                    fr.deferred_mask = 0;
+                    m.reconverges++;
+                } else {
+                    // both paths done : continue with every lane of the BRA
+                    w.active_mask = fr.reconv_mask;
+                    w.stack.pop_back();
+                    w.pc++;
+                }
             } else {
                 w.pc++;
             }
             break;
         }
 
+        case Op::BAR_SYNC: {
+            // the scheduler parks the warp until its block has arrived
+            w.at_barrier = true;
+            w.pc++;
+            break;
+        }
+
         case Op::HALT:
         default:
             w.halted = true;
@@ -233,30 +775,129 @@ void GPU_Sim::step_warp(Warp_state& w,
     }
 }
 
-Metrics GPU_Sim::run(const std::vector<Instr>& program, Buffer& mem, uint32_t n_threads, bool trace) {
+template <uint32_t W>
+void GPU_SimW<W>::schedule_round(std::vector<Warp_state<W>*>& ready,
+                                 std::vector<Warp_state<W>*>& next,
+                                 const std::vector<Instr>& program,
+                                 const std::vector<int32_t>& bra_to_join,
+                                 Buffer& mem,
+                                 uint64_t round,
+                                 Metrics& m,
+                                 bool trace) {
+    next.clear();
+    for (Warp_state<W>* w : ready) {
+        step_warp(*w, program, bra_to_join, mem, m, trace);
+
+        Block_state<W>* b = w->block;
+        if (w->halted) {
+            b->live_warps--;
+        } else if (w->at_barrier) {
+            b->parked.push_back(w);
+            b->parked_at.push_back(round);
+        } else {
+            next.push_back(w);
+            continue;
+        }
+
+        // last live warp arrived (or the one missing halted) : release the block
+        if (!b->parked.empty() && b->parked.size() == b->live_warps) {
+            for (size_t i = 0; i < b->parked.size(); i++) {
+                b->parked[i]->at_barrier = false;
+                m.barrier_stall_cycles += round - b->parked_at[i];
+                next.push_back(b->parked[i]);
+            }
+            b->parked.clear();
+            b->parked_at.clear();
+            m.barriers++;
+        }
+    }
+}
+
+template <uint32_t W>
+Metrics GPU_SimW<W>::run_native(const std::vector<Instr>& program,
+                                const std::vector<int32_t>& bra_to_join,
+                                Buffer& mem,
+                                uint32_t n_threads) {
+    native_kernel_fn kernel = Kernel_Cache::instance().get(program, bra_to_join, W);
+
+    uint32_t* bufs[3]  = { mem.buf0.data(), mem.buf1.data(), mem.buf2.data() };
+    uint64_t sizes[3]  = { mem.buf0.size(), mem.buf1.size(), mem.buf2.size() };
+    uint64_t counters[NM_COUNT] = {};
+
+    kernel(bufs, sizes, n_threads, counters);
+
+    Metrics m;
+    m.warp_width         = W;
+    m.warp_cycles        = counters[NM_WARP_CYCLES];
+    m.active_lane_cycles = counters[NM_ACTIVE_LANE_CYCLES];
+    m.mem_lane_ops       = counters[NM_MEM_LANE_OPS];
+    m.mem_transactions   = counters[NM_MEM_TRANSACTIONS];
+    m.divergent_branches = counters[NM_DIVERGENT_BRANCHES];
+    m.reconverges        = counters[NM_RECONVERGES];
+    return m;
+}
+
+template <uint32_t W>
+Metrics GPU_SimW<W>::run(const std::vector<Instr>& source, Buffer& mem, uint32_t n_threads, bool trace) {
     Metrics m;
+    m.warp_width = W;
     if (n_threads == 0) return m;
 
-    uint32_t n_warps = ((n_threads - 1) / warp_size) + 1;
-    std::vector<Warp_state> warps(n_warps);
+    std::vector<Instr> converted;
+    if (if_conversion) converted = if_convert(source, if_conversion_max_instrs, &if_conversion_report);
+    const std::vector<Instr>& program = if_conversion ? converted : source;
 
     auto bra_to_join = compute_bra_join_map(program);
 
-    for (uint32_t wid = 0; wid < n_warps; wid++) {
-        init_warp(warps[wid], wid * warp_size, n_threads);
+    if (compaction != Compaction::Off) {
+        return run_compacted(program, bra_to_join, mem, n_threads, trace);
     }
 
-    bool any_running = true;
-    while (any_running) {
-        any_running = false;
-
-        for (uint32_t wid = 0; wid < n_warps; wid++) {
-            if (warps[wid].halted) continue;
-            any_running = true;
-
-            step_warp(warps[wid], program, bra_to_join, mem, wid * warp_size, m, trace);
+    // trace needs the per-instruction hook, so it always goes through the interpreter.
+    // The generated scheduler groups warps over all threads (base = wid * W), which is
+    // the block grouping below only when blocks are whole warps.
+    const bool whole_warp_blocks = block_threads == 0 || block_threads % W == 0;
+    const bool interp_only = l1_cache.enabled() || l2_cache.enabled() || mem_trace || !whole_warp_blocks;
+    if (backend == Backend::Native && !trace && !interp_only && native_supported(program)) {
+        return run_native(program, bra_to_join, mem, n_threads);
+    }
+    Cache_hierarchy hierarchy(l1_cache, l2_cache, 1, false);
+    Cache* cache = hierarchy.sm(0);
+    if (mem_trace) mem_trace->begin_run(W);
+
+    // thread blocks : warps never straddle one, so a block whose size is not a
+    // multiple of W ends in a partial warp
+    const uint32_t bt = (block_threads == 0 || block_threads > n_threads) ? n_threads : block_threads;
+    const uint32_t n_blocks = ((n_threads - 1) / bt) + 1;
+    const uint32_t warps_per_block = ((bt - 1) / W) + 1;
+
+    std::vector<Block_state<W>> blocks(n_blocks);
+    std::vector<Warp_state<W>> warps(n_blocks * warps_per_block);
+    std::vector<Warp_state<W>*> ready, next;
+
+    for (uint32_t b = 0; b < n_blocks; b++) {
+        const uint32_t first = b * bt;
+        const uint32_t limit = (n_threads - first < bt) ? n_threads : first + bt;
+        blocks[b].shared.assign(shared_words, 0);
+        for (uint32_t i = 0; i < warps_per_block && first + i * W < limit; i++) {
+            Warp_state<W>& w = warps[b * warps_per_block + i];
+            init_warp(w, first + i * W, limit);
+            w.block = &blocks[b];
+            w.cache = cache;
+            blocks[b].live_warps++;
+            ready.push_back(&w);
         }
     }
 
+    // halted and parked warps leave the ready list instead of being polled
+    for (uint64_t round = 0; !ready.empty(); round++) {
+        schedule_round(ready, next, program, bra_to_join, mem, round, m, trace);
+        ready.swap(next);
+    }
+
     return m;
 }
+
+template class GPU_SimW<16>;
+template class GPU_SimW<32>;
+template class GPU_SimW<64>;
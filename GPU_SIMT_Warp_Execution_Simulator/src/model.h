@@ -1,9 +1,12 @@
-
+#pragma once
 # include <array>
 # include <cstdint>
 # include <vector>
 # include <stdexcept>
 # include "isa_2.h"
+# include "if_convert.h"
+# include "cache.h"
+# include "mem_trace.h"
 
 // ---------------- Memory ----------------
 struct Buffer {
@@ -16,49 +19,272 @@ struct Metrics {
     uint64_t warp_cycles = 0;
     uint64_t active_lane_cycles = 0;
     uint64_t mem_lane_ops = 0;
+    uint64_t mem_transactions = 0;    // 128B segments touched by warp memory ops (coalescing)
     uint64_t divergent_branches = 0;
     uint64_t reconverges = 0;
+
+    // atomics (ATOM_*): lanes that performed one, the deepest same-address
+    // chain of each atomic warp-instruction summed over the run, and the extra
+    // cycles that serializing those chains costs (depth - 1 per instruction)
+    uint64_t atomic_lane_ops = 0;
+    uint64_t atomic_serial_depth = 0;
+    uint64_t atomic_conflict_cycles = 0;
+
+    // warp intrinsics: active lanes moved by SHFL_*, BALLOT/VOTE_* and
+    // RED_ADD warp-instructions (kept apart from mem_lane_ops so shuffle- and
+    // memory-based reductions can be compared)
+    uint64_t shfl_lane_ops = 0;
+    uint64_t vote_ops = 0;
+    uint64_t reduce_ops = 0;
+
+    // thread-block compaction: warp re-formations at divergent BRA / JOIN
+    uint64_t compactions = 0;
+
+    // shared memory (LDS/STS): active lanes, and the extra cycles bank
+    // conflicts cost (conflict degree - 1 per warp-instruction)
+    uint64_t shared_lane_ops = 0;
+    uint64_t bank_conflict_cycles = 0;
+
+    // BAR_SYNC: completed block barriers, and warp-rounds spent parked at one
+    uint64_t barriers = 0;
+    uint64_t barrier_stall_cycles = 0;
+
+    // cache hierarchy (cache.h): line lookups per level; an eviction is a
+    // valid line replaced by a fill
+    uint64_t l1_hits = 0;
+    uint64_t l1_misses = 0;
+    uint64_t l1_evictions = 0;
+    uint64_t l2_hits = 0;
+    uint64_t l2_misses = 0;
+    uint64_t l2_evictions = 0;
+
+    uint32_t warp_width = warp_size;  // lanes per warp of the run (for utilization)
+
+    // sums every counter (per-SM metrics into a launch total)
+    Metrics& operator+=(const Metrics& o);
 };
 
+// ---------------- Warp width ----------------
+// One mask bit per lane, so the mask type follows the warp width.
+template <uint32_t W> struct Warp_traits;
+template <> struct Warp_traits<16> { using mask_t = uint16_t; };
+template <> struct Warp_traits<32> { using mask_t = uint32_t; };
+template <> struct Warp_traits<64> { using mask_t = uint64_t; };
+
+template <uint32_t W>
+using lane_mask_t = typename Warp_traits<W>::mask_t;
+
 // ---------------- SIMT Stack Frame ----------------
+// Pushed by a divergent BRA. The first arrival at join_pc switches to the
+// deferred path (deferred_mask becomes 0); the second restores reconv_mask,
+// the lanes that were active at the BRA, and falls through the JOIN.
+template <uint32_t W>
 struct StackFrame {
-    uint32_t deferred_mask = 0;
+    lane_mask_t<W> deferred_mask = 0;
     uint32_t deferred_pc = 0;
     uint32_t join_pc = 0;
+    lane_mask_t<W> reconv_mask = 0;
 };
 
+template <uint32_t W> struct Block_state;
+
 // ---------------- Warp State ----------------
+template <uint32_t W>
 struct Warp_state {
-    std::array<std::array<uint32_t, 16>, warp_size> regs{};
-    std::array<bool, warp_size> pred{};
+    // register-major: regs[r] holds register r of every lane contiguously,
+    // so per-lane loops run over a fixed-width array and vectorize
+    std::array<std::array<uint32_t, W>, 16> regs{};
+    std::array<bool, W> pred{};
+    std::array<uint32_t, W> tid{};   // thread id of each lane (compaction moves threads between warps)
 
-    uint32_t base_mask = 0;    // lanes with tid < n_threads
-    uint32_t active_mask = 0;  // dynamic lanes executing current path
+    lane_mask_t<W> base_mask = 0;    // lanes with tid < n_threads
+    lane_mask_t<W> active_mask = 0;  // dynamic lanes executing current path
 
     uint32_t pc = 0;
     bool halted = false;
+    bool at_barrier = false;         // parked at BAR_SYNC, not scheduled
+
+    std::vector<StackFrame<W>> stack;
+
+    Block_state<W>* block = nullptr; // thread block (shared memory, barrier)
+    Cache* cache = nullptr;          // first cache level of the warp's SM, nullptr : off
+    uint32_t warp_id = 0;            // first tid / W (memory trace)
+    uint32_t sm = 0;                 // SM the warp runs on (memory trace)
+};
+
+// ---------------- Thread block ----------------
+// Shared memory is 32 banks of 4-byte words; a warp access costs one pass
+// per distinct word in its most loaded bank.
+constexpr uint32_t shared_banks = 32;
+
+template <uint32_t W>
+struct Block_state {
+    std::vector<uint32_t> shared;        // LDS / STS words
+    uint32_t live_warps = 0;             // warps not halted
+    std::vector<Warp_state<W>*> parked;  // at BAR_SYNC, in arrival order
+    std::vector<uint64_t> parked_at;     // scheduler round of each arrival
+};
+
+// For structured programs : each BRA reconverges at the next JOIN after it.
+// Entry pc of a BRA holds its JOIN pc, every other entry is -1.
+std::vector<int32_t> compute_bra_join_map(const std::vector<Instr>& program);
+
+// ---------------- Launch configuration (multi-SM) ----------------
+// Threads are numbered block by block : tid = block * block_threads + thread,
+// so LD/ST (tid + imm) see the same flat index space as GPU_Sim::run.
+struct Dim3 {
+    uint32_t x = 1, y = 1, z = 1;
+    uint32_t count() const { return x * y * z; }
+};
+
+struct Launch_config {
+    Dim3 grid;                          // blocks
+    Dim3 block;                         // threads per block
+    uint32_t n_sms = 1;
+    uint32_t max_blocks_per_sm = 8;     // resident-block limit
+    uint32_t max_warps_per_sm = 64;     // resident-warp limit
+    bool parallel = true;               // one host thread per SM
+};
+
+// An SM issues one warp-instruction per cycle, so its busy time is m.warp_cycles.
+struct SM_stats {
+    Metrics m;
+    uint32_t blocks = 0;                // blocks run to completion
+    uint32_t peak_resident_blocks = 0;
+    uint32_t peak_resident_warps = 0;
+};
 
-    std::vector<StackFrame> stack;
+struct Launch_metrics {
+    Metrics total;                      // sum over SMs
+    std::vector<SM_stats> sm;
+    uint64_t elapsed_cycles = 0;        // busiest SM
+    double host_seconds = 0.0;
 };
 
-class GPU_Sim {
+// Streams of kernel launches and buffer copies (stream.h)
+class Stream;
+struct Device_config;
+struct Stream_report;
+
+// ---------------- Execution backend ----------------
+// Interp : step_warp decodes every instruction (default, supports trace)
+// Native : program compiled to a shared object once (codegen.h), then run natively
+enum class Backend : uint8_t { Interp, Native };
+
+// ---------------- Thread-block compaction ----------------
+// Off         : one SIMT stack per warp (baseline)
+// LaneAligned : threads keep their lane (register bank) when warps are re-formed
+// Ideal       : threads may move to any lane (upper bound, full crossbar)
+// See compaction.cpp.
+enum class Compaction : uint8_t { Off, LaneAligned, Ideal };
+
+// Bumped whenever a change alters the Metrics or buffers of any run, so
+// stored results (result_cache.h) are not reused.
+constexpr uint32_t simulator_version = 1;
+
+// W = lanes per warp. Instantiated for 16, 32 and 64 in model.cpp.
+template <uint32_t W>
+class GPU_SimW {
 public:
+    using mask_t = lane_mask_t<W>;
+    static constexpr uint32_t width = W;
+
     Metrics run(const std::vector<Instr>& program, Buffer& mem, uint32_t n_threads, bool trace=false);
 
+    // Grid of thread blocks on cfg.n_sms SMs (launch.cpp). Blocks are dealt to
+    // SMs round-robin; each SM keeps up to its resident limits and admits its
+    // next block when one finishes. Interpreter only; if_conversion applies.
+    Launch_metrics launch(const std::vector<Instr>& program, Buffer& mem,
+                          const Launch_config& cfg, bool trace=false);
+
+    // Plays every stream on one device (stream.cpp) : warps of concurrent
+    // kernels share the SMs, copies run on the copy engines. Also replays
+    // the ops one at a time on a copy of mem for the serial baseline.
+    Stream_report run_streams(const std::vector<Stream>& streams, Buffer& mem,
+                              const Device_config& dev);
+
+    Backend backend = Backend::Interp;
+
+    // Optional pre-launch pass (if_convert.h): short BRA..JOIN diamonds are
+    // replaced by CMP/SEL code before the warps start. The report of the
+    // last such run is kept in if_conversion_report.
+    bool if_conversion = false;
+    uint32_t if_conversion_max_instrs = 8;
+    If_convert_report if_conversion_report;
+
+    // Regroup threads of compaction_block_warps warps into dense warps at
+    // divergent branches (interpreter only).
+    Compaction compaction = Compaction::Off;
+    uint32_t compaction_block_warps = 4;
+
+    // Thread blocks of run() for LDS/STS/BAR_SYNC (0 : all threads are one
+    // block; launch() uses cfg.block). shared_words is per block.
+    uint32_t block_threads = 0;
+    uint32_t shared_words = 4096;
+
+    // L1 per SM and shared L2 for LD/ST/LDX/STX/atomics (cache.h); both off
+    // by default. Counters only, so timing is the same with them on. The
+    // native backend has no cache model and falls back to the interpreter.
+    Cache_config l1_cache;
+    Cache_config l2_cache;
+
+    // When set, every global memory op is recorded (mem_trace.h), one run
+    // record per run / launch / stream pass. Interpreter only, like caches.
+    Mem_trace_writer* mem_trace = nullptr;
+
 private:
-    // For structured programs : each BRA reconverges at the next JOIN after it.
-    std::vector<int32_t> compute_bra_join_map(const std::vector<Instr>& program) const;
+    Metrics run_native(const std::vector<Instr>& program,
+                       const std::vector<int32_t>& bra_to_join,
+                       Buffer& mem,
+                       uint32_t n_threads);
+
+    Metrics run_compacted(const std::vector<Instr>& program,
+                          const std::vector<int32_t>& bra_to_join,
+                          Buffer& mem,
+                          uint32_t n_threads,
+                          bool trace);
 
-    void init_warp(Warp_state& w, uint32_t warp_base_tid, uint32_t n_threads);
+    void run_sm(const std::vector<Instr>& program,
+                const std::vector<int32_t>& bra_to_join,
+                Buffer& mem,
+                const Launch_config& cfg,
+                const std::vector<uint32_t>& blocks,
+                uint32_t sm,
+                Cache* cache,
+                SM_stats& st,
+                bool trace);
+
+    Stream_report play_streams(const std::vector<Stream>& streams, Buffer& mem,
+                               const Device_config& dev, bool serial);
+
+    // One scheduler round over the ready warps : steps each one, drops the
+    // halted, parks warps that reached BAR_SYNC and, once a block's live
+    // warps have all arrived, puts its parked warps back into next.
+    void schedule_round(std::vector<Warp_state<W>*>& ready,
+                        std::vector<Warp_state<W>*>& next,
+                        const std::vector<Instr>& program,
+                        const std::vector<int32_t>& bra_to_join,
+                        Buffer& mem,
+                        uint64_t round,
+                        Metrics& m,
+                        bool trace);
+
+    void init_warp(Warp_state<W>& w, uint32_t warp_base_tid, uint32_t n_threads);
 
     // Execute one instruction for one warp (one warp-cycle).
-    void step_warp(Warp_state& w,
+    void step_warp(Warp_state<W>& w,
                    const std::vector<Instr>& program,
                    const std::vector<int32_t>& bra_to_join,
                    Buffer& mem,
-                   uint32_t warp_base_tid,
                    Metrics& m,
                    bool trace);
 
     static const char* op_name(Op op);
 };
+
+extern template class GPU_SimW<16>;
+extern template class GPU_SimW<32>;
+extern template class GPU_SimW<64>;
+
+// The default 32-lane simulator.
+using GPU_Sim = GPU_SimW<warp_size>;
@@ -0,0 +1,231 @@
+#include "result_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static const char cache_magic[4] = {'S', 'M', 'R', 'C'};
+static const uint32_t cache_format = 1;
+
+// Every Metrics counter, in file order (warp_width is stored after them).
+static uint64_t Metrics::* const metric_fields[] = {
+    &Metrics::warp_cycles, &Metrics::active_lane_cycles, &Metrics::mem_lane_ops,
+    &Metrics::mem_transactions, &Metrics::divergent_branches, &Metrics::reconverges,
+    &Metrics::atomic_lane_ops, &Metrics::atomic_serial_depth, &Metrics::atomic_conflict_cycles,
+    &Metrics::shfl_lane_ops, &Metrics::vote_ops, &Metrics::reduce_ops, &Metrics::compactions,
+    &Metrics::shared_lane_ops, &Metrics::bank_conflict_cycles,
+    &Metrics::barriers, &Metrics::barrier_stall_cycles,
+    &Metrics::l1_hits, &Metrics::l1_misses, &Metrics::l1_evictions,
+    &Metrics::l2_hits, &Metrics::l2_misses, &Metrics::l2_evictions,
+};
+static_assert(sizeof(Metrics) == (sizeof(metric_fields) / sizeof(metric_fields[0]) + 1) * sizeof(uint64_t),
+              "a Metrics counter is missing from metric_fields");
+
+static const std::vector<uint32_t>& buffer_of(const Buffer& mem, uint8_t b) {
+    return b == 0 ? mem.buf0 : (b == 1 ? mem.buf1 : mem.buf2);
+}
+
+// ---------------- Run_key ----------------
+Run_key& Run_key::add(uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        h_ ^= (v >> (8 * i)) & 0xFF;
+        h_ *= 1099511628211ull;
+    }
+    return *this;
+}
+
+Run_key& Run_key::add(const std::string& s) {
+    add(s.size());
+    for (unsigned char c : s) {
+        h_ ^= c;
+        h_ *= 1099511628211ull;
+    }
+    return *this;
+}
+
+Run_key& Run_key::add(const std::vector<uint32_t>& words) {
+    add(words.size());
+    for (uint32_t w : words) {
+        for (int i = 0; i < 4; i++) {
+            h_ ^= (w >> (8 * i)) & 0xFF;
+            h_ *= 1099511628211ull;
+        }
+    }
+    return *this;
+}
+
+Run_key& Run_key::add(const std::vector<Instr>& program) {
+    add(program.size());
+    for (const Instr& ins : program) {
+        add((uint64_t)ins.op).add(ins.dst).add(ins.a).add(ins.b).add(ins.buf);
+        add((uint32_t)ins.imm).add(ins.scale);
+    }
+    return *this;
+}
+
+Run_key& Run_key::add(const Buffer& mem) {
+    return add(mem.buf0).add(mem.buf1).add(mem.buf2);
+}
+
+Run_key& Run_key::add(const Cache_config& c) {
+    add(c.size_bytes).add(c.line_bytes).add(c.ways);
+    return add((uint64_t)c.replacement).add((uint64_t)c.write);
+}
+
+// ---------------- file helpers ----------------
+namespace {
+
+struct Writer {
+    std::ofstream& out;
+    void u8(uint8_t v) { out.put((char)v); }
+    void u32(uint32_t v) { out.write((const char*)&v, 4); }
+    void u64(uint64_t v) { out.write((const char*)&v, 8); }
+    void words(const std::vector<uint32_t>& v) {
+        u64(v.size());
+        out.write((const char*)v.data(), (std::streamsize)(v.size() * 4));
+    }
+};
+
+struct Reader {
+    std::ifstream& in;
+    uint64_t file_size;
+    void need(bool ok) { if (!ok) throw std::runtime_error("Result_cache: truncated or corrupt cache file"); }
+    uint8_t u8() { char c; need((bool)in.get(c)); return (uint8_t)c; }
+    uint32_t u32() { uint32_t v; need((bool)in.read((char*)&v, 4)); return v; }
+    uint64_t u64() { uint64_t v; need((bool)in.read((char*)&v, 8)); return v; }
+    // an element count that fits in the rest of the file (a corrupt one must not allocate)
+    uint64_t count(uint64_t n, uint64_t bytes_each) {
+        need(n <= (file_size - (uint64_t)in.tellg()) / bytes_each);
+        return n;
+    }
+    std::vector<uint32_t> words() {
+        std::vector<uint32_t> v(count(u64(), 4));
+        need((bool)in.read((char*)v.data(), (std::streamsize)(v.size() * 4)));
+        return v;
+    }
+};
+
+} // namespace
+
+// ---------------- Result_cache ----------------
+Result_cache::Result_cache(std::string path) : path_(std::move(path)) {
+    std::ifstream in(path_, std::ios::binary);
+    if (!in) return;   // no cache yet
+
+    char magic[4];
+    if (!in.read(magic, 4) || std::memcmp(magic, cache_magic, 4) != 0)
+        throw std::runtime_error("Result_cache: " + path_ + " is not a result cache");
+    in.seekg(0, std::ios::end);
+    const uint64_t file_size = (uint64_t)in.tellg();
+    in.seekg(4);
+    Reader rd{in, file_size};
+    if (rd.u32() != cache_format || rd.u32() != simulator_version) return;   // stale : start empty
+
+    // A truncated or corrupt file keeps the entries before the damage; the rest is simulated again.
+    try {
+        const uint64_t n = rd.u64();
+        for (uint64_t i = 0; i < n; i++) {
+            const uint64_t key = rd.u64();
+            Entry e;
+            for (auto field : metric_fields) e.r.m.*field = rd.u64();
+            e.r.m.warp_width = rd.u32();
+            e.r.extra.resize(rd.count(rd.u32(), 8));
+            for (uint64_t& x : e.r.extra) x = rd.u64();
+            bool valid = true;
+            for (Buffer_delta& d : e.buf) {
+                d.mode = rd.u8();
+                rd.need(d.mode <= 2);   // the rest cannot be parsed
+                if (d.mode == 1) d.index = rd.words();
+                if (d.mode != 0) d.value = rd.words();
+                valid = valid && d.index.size() == (d.mode == 1 ? d.value.size() : 0);
+            }
+            if (valid) entries_[key] = std::move(e);   // else dropped : the run is simulated again
+        }
+    } catch (const std::runtime_error&) {
+    }
+}
+
+bool Result_cache::lookup(uint64_t key, Cached_result& r, Buffer& mem) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) { misses++; return false; }
+
+    // a changed-word index outside the buffer (key collision) : a miss, mem untouched
+    const Entry& e = it->second;
+    for (uint8_t b = 0; b < 3; b++) {
+        const Buffer_delta& d = e.buf[b];
+        if (d.mode != 1) continue;
+        for (uint32_t i : d.index) {
+            if (i >= mem.get(b).size()) { misses++; return false; }
+        }
+    }
+    hits++;
+
+    r = e.r;
+    for (uint8_t b = 0; b < 3; b++) {
+        const Buffer_delta& d = e.buf[b];
+        std::vector<uint32_t>& B = mem.get(b);
+        if (d.mode == 2) {
+            B = d.value;
+        } else if (d.mode == 1) {
+            for (size_t i = 0; i < d.index.size(); i++) B[d.index[i]] = d.value[i];
+        }
+    }
+    return true;
+}
+
+void Result_cache::store(uint64_t key, const Cached_result& r, const Buffer& before, const Buffer& after) {
+    Entry e;
+    e.r = r;
+    for (uint8_t b = 0; b < 3; b++) {
+        const std::vector<uint32_t>& x = buffer_of(before, b);
+        const std::vector<uint32_t>& y = buffer_of(after, b);
+        Buffer_delta& d = e.buf[b];
+        if (x.size() != y.size()) {
+            d.mode = 2;
+            d.value = y;
+            continue;
+        }
+        for (size_t i = 0; i < x.size(); i++) {
+            if (x[i] == y[i]) continue;
+            d.index.push_back((uint32_t)i);
+            d.value.push_back(y[i]);
+        }
+        if (d.index.size() * 2 > y.size()) {   // mostly rewritten : keep it whole
+            d.mode = 2;
+            d.index.clear();
+            d.value = y;
+        } else {
+            d.mode = d.index.empty() ? 0 : 1;
+        }
+    }
+    entries_[key] = std::move(e);
+}
+
+void Result_cache::save() const {
+    const std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Result_cache: cannot write " + tmp);
+        out.write(cache_magic, 4);
+        Writer wr{out};
+        wr.u32(cache_format);
+        wr.u32(simulator_version);
+        wr.u64(entries_.size());
+        for (const auto& kv : entries_) {
+            const Entry& e = kv.second;
+            wr.u64(kv.first);
+            for (auto field : metric_fields) wr.u64(e.r.m.*field);
+            wr.u32(e.r.m.warp_width);
+            wr.u32((uint32_t)e.r.extra.size());
+            for (uint64_t x : e.r.extra) wr.u64(x);
+            for (const Buffer_delta& d : e.buf) {
+                wr.u8(d.mode);
+                if (d.mode == 1) wr.words(d.index);
+                if (d.mode != 0) wr.words(d.value);
+            }
+        }
+        if (!out) throw std::runtime_error("Result_cache: cannot write " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path_.c_str()) != 0)
+        throw std::runtime_error("Result_cache: cannot replace " + path_);
+}
@@ -0,0 +1,82 @@
+#pragma once
+# include <cstdint>
+# include <string>
+# include <unordered_map>
+# include <vector>
+# include "model.h"
+
+// ---------------- Result cache ----------------
+// Persistent store of simulation results for sweep drivers (main_analysis).
+// A result is keyed by a hash of everything that decides it : simulator
+// version, warp width and simulator settings, the program, the launch size
+// and the input buffers. Besides the Metrics it keeps a few extra numbers
+// (e.g. elapsed cycles of a launch) and the changes the run made to the
+// buffers, so a hit leaves mem exactly as the run would have.
+//
+// File : "SMRC", format version, simulator_version, then the entries. A
+// file written by another simulator_version is ignored as a whole; a
+// truncated or corrupt one keeps only the entries before the damage.
+
+// FNV-1a, fed field by field (never raw structs, which carry padding).
+class Run_key {
+public:
+    Run_key& add(uint64_t v);
+    Run_key& add(const std::string& s);
+    Run_key& add(const std::vector<uint32_t>& words);
+    Run_key& add(const std::vector<Instr>& program);
+    Run_key& add(const Buffer& mem);
+    Run_key& add(const Cache_config& c);
+
+    // width and every GPU_SimW setting that changes results (not backend)
+    template <uint32_t W>
+    Run_key& add_sim(const GPU_SimW<W>& sim) {
+        add(W).add(sim.if_conversion).add(sim.if_conversion_max_instrs);
+        add((uint64_t)sim.compaction).add(sim.compaction_block_warps);
+        add(sim.block_threads).add(sim.shared_words);
+        return add(sim.l1_cache).add(sim.l2_cache);
+    }
+
+    uint64_t value() const { return h_; }
+
+private:
+    uint64_t h_ = 1469598103934665603ull;
+};
+
+struct Cached_result {
+    Metrics m;
+    std::vector<uint64_t> extra;
+};
+
+class Result_cache {
+public:
+    // Loads path if it exists. Throws std::runtime_error if it exists but
+    // is not a result cache.
+    explicit Result_cache(std::string path);
+
+    // On a hit : r gets the stored result and mem the stored changes. An
+    // entry whose changed words fall outside mem (a key collision) is a miss.
+    bool lookup(uint64_t key, Cached_result& r, Buffer& mem);
+
+    // Records r and how the run changed the buffers (before -> after).
+    void store(uint64_t key, const Cached_result& r, const Buffer& before, const Buffer& after);
+
+    // Writes every entry to path (through a temporary file, then rename).
+    void save() const;
+
+    size_t size() const { return entries_.size(); }
+    uint64_t hits = 0, misses = 0;
+
+private:
+    struct Buffer_delta {
+        uint8_t mode = 0;                   // 0 unchanged, 1 changed words, 2 whole buffer
+        std::vector<uint32_t> index;        // mode 1
+        std::vector<uint32_t> value;        // mode 1 : new words, mode 2 : the buffer
+    };
+    struct Entry {
+        Cached_result r;
+        Buffer_delta buf[3];
+    };
+
+    std::string path_;
+    std::unordered_map<uint64_t, Entry> entries_;
+};
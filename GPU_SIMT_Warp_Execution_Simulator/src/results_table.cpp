@@ -0,0 +1,178 @@
+#include "results_table.h"
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+static const char table_magic[4] = {'S', 'M', 'R', 'T'};
+static const uint32_t table_version = 1;
+
+static size_t value_bytes(Column_type t) {
+    return (t == Column_type::U64 || t == Column_type::F64) ? 8 : 4;
+}
+
+template <typename T>
+static void put(std::vector<uint8_t>& v, T x) {
+    const uint8_t* p = (const uint8_t*)&x;
+    v.insert(v.end(), p, p + sizeof(T));
+}
+
+static std::vector<uint8_t> header_bytes(const std::vector<Column>& columns) {
+    std::vector<uint8_t> h(table_magic, table_magic + 4);
+    put<uint32_t>(h, table_version);
+    put<uint32_t>(h, (uint32_t)columns.size());
+    for (const Column& c : columns) {
+        h.push_back((uint8_t)c.type);
+        put<uint16_t>(h, (uint16_t)c.name.size());
+        h.insert(h.end(), c.name.begin(), c.name.end());
+    }
+    return h;
+}
+
+Results_table_writer::Results_table_writer(const std::string& path, std::vector<Column> columns,
+                                           bool append, uint32_t chunk_rows)
+    : columns_(std::move(columns)), chunk_rows_(chunk_rows ? chunk_rows : 1), data_(columns_.size()) {
+    if (columns_.empty()) throw std::invalid_argument("Results_table_writer: no columns");
+    for (const Column& c : columns_)
+        if (c.name.empty() || c.name.size() > 0xFFFF)
+            throw std::invalid_argument("Results_table_writer: bad column name");
+
+    const bool exists = append && std::filesystem::exists(path);
+    if (exists) load(path);
+    out_.open(path, std::ios::binary | (exists ? std::ios::app : std::ios::trunc));
+    if (!out_) throw std::runtime_error("Results_table_writer: cannot write " + path);
+    if (!exists) {
+        const std::vector<uint8_t> h = header_bytes(columns_);
+        out_.write((const char*)h.data(), (std::streamsize)h.size());
+    }
+}
+
+Results_table_writer::~Results_table_writer() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // a destructor must not throw; call flush() to see the error
+    }
+}
+
+// Checks the columns of an existing file, rebuilds its dictionary and cuts
+// off a trailing partial chunk.
+void Results_table_writer::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Results_table_writer: cannot open " + path);
+
+    const std::vector<uint8_t> want = header_bytes(columns_);
+    std::vector<uint8_t> got(want.size());
+    if (!in.read((char*)got.data(), (std::streamsize)got.size()) || std::memcmp(got.data(), table_magic, 4) != 0)
+        throw std::runtime_error("Results_table_writer: " + path + " is not a results table");
+    if (got != want)
+        throw std::runtime_error("Results_table_writer: " + path + " has other columns");
+
+    size_t row_bytes = 0;
+    for (const Column& c : columns_) row_bytes += value_bytes(c.type);
+
+    const uint64_t file_size = std::filesystem::file_size(path);
+    uint64_t good = want.size();   // end of the last whole chunk
+    auto corrupt = [&] { return std::runtime_error("Results_table_writer: " + path + " has a corrupt chunk"); };
+    for (;;) {
+        uint64_t size;
+        if (!in.read((char*)&size, 8) || size > file_size - good - 8) break;
+        std::vector<uint8_t> chunk(size);
+        if (!in.read((char*)chunk.data(), (std::streamsize)size)) break;
+
+        if (size < 8) throw corrupt();
+        uint32_t n_rows, n_names;
+        std::memcpy(&n_rows, chunk.data(), 4);
+        std::memcpy(&n_names, chunk.data() + 4, 4);
+        size_t pos = 8;
+        for (uint32_t i = 0; i < n_names; i++) {
+            uint16_t len;
+            if (pos + 2 > size) throw corrupt();
+            std::memcpy(&len, chunk.data() + pos, 2);
+            if (pos + 2 + len > size) throw corrupt();
+            std::string name((const char*)chunk.data() + pos + 2, len);
+            pos += 2 + len;
+            dict_.emplace(std::move(name), (uint32_t)dict_.size());
+        }
+        if (pos + (uint64_t)n_rows * row_bytes != size) throw corrupt();
+        rows_ += n_rows;
+        good += 8 + size;
+    }
+    in.close();
+    if (good != file_size) std::filesystem::resize_file(path, good);
+}
+
+void Results_table_writer::check(Column_type got) {
+    if (col_ >= columns_.size())
+        throw std::invalid_argument("Results_table_writer: too many values in a row");
+    if (columns_[col_].type != got && !(got == Column_type::U64 && columns_[col_].type == Column_type::U32))
+        throw std::invalid_argument("Results_table_writer: wrong type for column " + columns_[col_].name);
+}
+
+Results_table_writer& Results_table_writer::add(uint64_t v) {
+    check(Column_type::U64);
+    if (columns_[col_].type == Column_type::U32) {
+        if (v > 0xFFFFFFFFull)
+            throw std::invalid_argument("Results_table_writer: " + columns_[col_].name + " does not fit u32");
+        put<uint32_t>(data_[col_], (uint32_t)v);
+    } else {
+        put<uint64_t>(data_[col_], v);
+    }
+    col_++;
+    return *this;
+}
+
+Results_table_writer& Results_table_writer::add(double v) {
+    check(Column_type::F64);
+    put<double>(data_[col_], v);
+    col_++;
+    return *this;
+}
+
+Results_table_writer& Results_table_writer::add(const std::string& name) {
+    check(Column_type::Dict);
+    if (name.size() > 0xFFFF) throw std::invalid_argument("Results_table_writer: name too long");
+    auto it = dict_.find(name);
+    if (it == dict_.end()) {
+        it = dict_.emplace(name, (uint32_t)dict_.size()).first;
+        new_names_.push_back(name);
+    }
+    put<uint32_t>(data_[col_], it->second);
+    col_++;
+    return *this;
+}
+
+void Results_table_writer::end_row() {
+    if (col_ != columns_.size())
+        throw std::invalid_argument("Results_table_writer: row is missing values");
+    col_ = 0;
+    chunk_n_++;
+    rows_++;
+    if (chunk_n_ == chunk_rows_) flush();
+}
+
+void Results_table_writer::flush() {
+    if (col_ != 0) throw std::invalid_argument("Results_table_writer: flush inside a row");
+    if (chunk_n_ == 0) return;
+
+    std::vector<uint8_t> head;
+    put<uint32_t>(head, chunk_n_);
+    put<uint32_t>(head, (uint32_t)new_names_.size());
+    for (const std::string& s : new_names_) {
+        put<uint16_t>(head, (uint16_t)s.size());
+        head.insert(head.end(), s.begin(), s.end());
+    }
+    uint64_t size = head.size();
+    for (size_t c = 0; c < columns_.size(); c++) size += data_[c].size();
+
+    out_.write((const char*)&size, 8);
+    out_.write((const char*)head.data(), (std::streamsize)head.size());
+    for (size_t c = 0; c < columns_.size(); c++) {
+        out_.write((const char*)data_[c].data(), (std::streamsize)data_[c].size());
+        data_[c].clear();
+    }
+    out_.flush();
+    if (!out_) throw std::runtime_error("Results_table_writer: write failed");
+
+    chunk_n_ = 0;
+    new_names_.clear();
+}
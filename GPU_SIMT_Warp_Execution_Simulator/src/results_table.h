@@ -0,0 +1,64 @@
+#pragma once
+# include <cstdint>
+# include <fstream>
+# include <string>
+# include <unordered_map>
+# include <vector>
+
+// ---------------- Columnar results table ----------------
+// Binary alternative to results.csv : values are stored as they are
+// (no text formatting / parsing), one typed array per column, in chunks of
+// rows. Read from Python with analysis/results_table.py.
+//
+// File : "SMRT", format version, the columns (type + name), then chunks.
+// A chunk is its byte size, its row count, the workload names it adds to
+// the dictionary, then each column's values for its rows, column after
+// column. Numbers are little-endian; Dict columns hold u32 ids into the
+// dictionary (names in order of first use over the whole file).
+//
+// New chunks can be appended to an existing file with the same columns;
+// a chunk cut short (e.g. by a crash) is dropped at the next append.
+
+enum class Column_type : uint8_t { U32 = 0, U64 = 1, F64 = 2, Dict = 3 };
+
+struct Column {
+    std::string name;
+    Column_type type;
+};
+
+class Results_table_writer {
+public:
+    // Creates path, or with append = true adds to it (creating it if
+    // missing). Throws std::runtime_error if the file cannot be written or,
+    // when appending, is not a table or has other columns.
+    Results_table_writer(const std::string& path, std::vector<Column> columns,
+                         bool append = false, uint32_t chunk_rows = 4096);
+    ~Results_table_writer();
+
+    // Values of a row, in column order; then end_row(). Throws
+    // std::invalid_argument on a type that does not match the column.
+    Results_table_writer& add(uint64_t v);
+    Results_table_writer& add(double v);
+    Results_table_writer& add(const std::string& name);
+    void end_row();
+
+    // Writes the rows of the open chunk.
+    void flush();
+
+    uint64_t rows() const { return rows_; }
+
+private:
+    void check(Column_type got);
+    void load(const std::string& path);
+
+    std::vector<Column> columns_;
+    std::ofstream out_;
+    uint32_t chunk_rows_;
+    size_t col_ = 0;                                 // next column of the row
+
+    std::vector<std::vector<uint8_t>> data_;         // open chunk, per column
+    uint32_t chunk_n_ = 0;
+    std::unordered_map<std::string, uint32_t> dict_;
+    std::vector<std::string> new_names_;             // added in the open chunk
+    uint64_t rows_ = 0;
+};
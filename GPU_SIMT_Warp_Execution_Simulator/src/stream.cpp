@@ -0,0 +1,352 @@
+#include "stream.h"
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+
+// ---------------- Streams ----------------
+// Each cycle :
+//  1. copies that reach their end cycle complete (their effect on the
+//     Buffer / host vector happens here),
+//  2. every idle stream starts its next op : a kernel becomes eligible for
+//     block dispatch, a copy joins its copy engine's FIFO,
+//  3. idle copy engines start their next copy,
+//  4. blocks are dispatched one per SM in turn while they fit, oldest
+//     kernel first (a later kernel fills what the oldest leaves free),
+//  5. every SM issues one warp-instruction from its ready warps, round-robin
+//     over all its resident warps whatever kernel they belong to.
+// When no SM has a ready warp the clock jumps to the next copy completion.
+
+void Stream::launch(std::string op_name, std::vector<Instr> program, Dim3 grid, Dim3 block,
+                    uint32_t first_tid) {
+    Stream_op op;
+    op.kind = Stream_op::Kind::Kernel;
+    op.name = std::move(op_name);
+    op.program = std::move(program);
+    op.grid = grid;
+    op.block = block;
+    op.first_tid = first_tid;
+    ops.push_back(std::move(op));
+}
+
+void Stream::copy_to_device(std::string op_name, std::vector<uint32_t> data, uint8_t buf,
+                            uint64_t offset) {
+    Stream_op op;
+    op.kind = Stream_op::Kind::Copy;
+    op.name = std::move(op_name);
+    op.dir = Copy_dir::HostToDevice;
+    op.buf = buf;
+    op.offset = offset;
+    op.words = data.size();
+    op.data = std::move(data);
+    ops.push_back(std::move(op));
+}
+
+void Stream::copy_to_host(std::string op_name, uint8_t buf, uint64_t offset, uint64_t words,
+                          std::vector<uint32_t>& host) {
+    Stream_op op;
+    op.kind = Stream_op::Kind::Copy;
+    op.name = std::move(op_name);
+    op.dir = Copy_dir::DeviceToHost;
+    op.buf = buf;
+    op.offset = offset;
+    op.words = words;
+    op.host = &host;
+    ops.push_back(std::move(op));
+}
+
+namespace {
+
+struct Kernel_run {
+    size_t op = 0;                      // index into the flat op list
+    size_t queue = 0;
+    std::vector<Instr> program;
+    std::vector<int32_t> bra_to_join;
+    uint32_t first_tid = 0, n_blocks = 0, block_threads = 0, warps_per_block = 0;
+    uint32_t next_block = 0, blocks_done = 0;
+    Metrics m;
+};
+
+struct Copy_engine {
+    std::deque<size_t> waiting;         // flat op indices
+    bool busy = false;
+    size_t op = 0;
+    uint64_t end = 0;
+};
+
+} // namespace
+
+template <uint32_t W>
+Stream_report GPU_SimW<W>::play_streams(const std::vector<Stream>& streams, Buffer& mem,
+                                        const Device_config& dev, bool serial) {
+    struct Flat { const Stream_op* op; size_t stream; };
+    std::vector<Flat> flat;
+    for (size_t s = 0; s < streams.size(); s++)
+        for (const Stream_op& op : streams[s].ops) flat.push_back({&op, s});
+
+    // queues of flat indices : one per stream, or a single one when serial
+    std::vector<std::vector<size_t>> queues(serial ? 1 : streams.size());
+    for (size_t i = 0; i < flat.size(); i++) queues[serial ? 0 : flat[i].stream].push_back(i);
+    std::vector<size_t> head(queues.size(), 0);
+    std::vector<bool> queue_busy(queues.size(), false);
+
+    Stream_report rep;
+    rep.total.warp_width = W;
+    rep.ops.resize(flat.size());
+    for (size_t i = 0; i < flat.size(); i++) {
+        rep.ops[i].stream = streams[flat[i].stream].name;
+        rep.ops[i].name = flat[i].op->name;
+        rep.ops[i].kernel = flat[i].op->kind == Stream_op::Kind::Kernel;
+        rep.ops[i].m.warp_width = W;
+    }
+
+    struct Resident {
+        Kernel_run* k = nullptr;
+        Block_state<W> block;
+        std::vector<Warp_state<W>> warps;
+    };
+    struct Entry { Warp_state<W>* w; Resident* r; };
+    struct SM {
+        std::vector<std::unique_ptr<Resident>> resident;
+        std::deque<Entry> ready;
+        uint32_t warps = 0;
+        Cache* cache = nullptr;
+        uint32_t id = 0;
+    };
+    std::vector<SM> sms(dev.n_sms);
+    Cache_hierarchy hierarchy(l1_cache, l2_cache, dev.n_sms, false);
+    for (uint32_t s = 0; s < dev.n_sms; s++) {
+        sms[s].cache = hierarchy.sm(s);
+        sms[s].id = s;
+    }
+    if (mem_trace) mem_trace->begin_run(W);
+
+    std::vector<std::unique_ptr<Kernel_run>> kernels;   // running, in start order
+    std::vector<Copy_engine> engines(dev.copy_engines);
+    size_t remaining = flat.size();
+    uint64_t cycle = 0;
+
+    auto finish = [&](size_t op, size_t queue, uint64_t end) {
+        rep.ops[op].end = end;
+        queue_busy[queue] = false;
+        remaining--;
+        if (end > rep.cycles) rep.cycles = end;
+    };
+
+    auto copy_cycles = [&](const Stream_op& op) {
+        const double bytes = (double)op.words * sizeof(uint32_t);
+        return dev.copy_latency + (uint64_t)((bytes + dev.copy_bytes_per_cycle - 1.0) / dev.copy_bytes_per_cycle);
+    };
+
+    auto try_admit = [&](SM& sm) {
+        if (sm.resident.size() >= dev.max_blocks_per_sm) return false;
+        for (auto& kp : kernels) {
+            Kernel_run& k = *kp;
+            if (k.next_block >= k.n_blocks) continue;
+            if (sm.warps + k.warps_per_block > dev.max_warps_per_sm) continue;
+
+            const uint32_t first_tid = k.first_tid + k.next_block++ * k.block_threads;
+            auto r = std::make_unique<Resident>();
+            r->k = &k;
+            r->block.shared.assign(shared_words, 0);
+            r->block.live_warps = k.warps_per_block;
+            r->warps.resize(k.warps_per_block);
+            for (uint32_t i = 0; i < k.warps_per_block; i++) {
+                Warp_state<W>& w = r->warps[i];
+                init_warp(w, first_tid + i * W, first_tid + k.block_threads);
+                w.block = &r->block;
+                w.cache = sm.cache;
+                w.sm = sm.id;
+                sm.ready.push_back({&w, r.get()});
+            }
+            sm.warps += k.warps_per_block;
+            sm.resident.push_back(std::move(r));
+            return true;
+        }
+        return false;
+    };
+
+    while (remaining > 0) {
+        // 1. copy completions
+        for (Copy_engine& e : engines) {
+            if (!e.busy || cycle < e.end) continue;
+            const Stream_op& op = *flat[e.op].op;
+            std::vector<uint32_t>& b = mem.get(op.buf);
+            if (op.dir == Copy_dir::HostToDevice) {
+                if (b.size() < op.offset + op.words) b.resize(op.offset + op.words, 0);
+                std::copy(op.data.begin(), op.data.end(), b.begin() + op.offset);
+            } else if (!serial) {
+                const uint64_t from = std::min<uint64_t>(op.offset, b.size());
+                const uint64_t to = std::min<uint64_t>(op.offset + op.words, b.size());
+                op.host->assign(b.begin() + from, b.begin() + to);
+            }
+            e.busy = false;
+            finish(e.op, serial ? 0 : flat[e.op].stream, cycle);
+        }
+
+        // 2. idle streams start their next op
+        for (size_t q = 0; q < queues.size(); q++) {
+            if (queue_busy[q] || head[q] >= queues[q].size()) continue;
+            const size_t i = queues[q][head[q]++];
+            const Stream_op& op = *flat[i].op;
+            queue_busy[q] = true;
+            rep.ops[i].start = cycle;
+
+            if (op.kind == Stream_op::Kind::Copy) {
+                const size_t e = (engines.size() == 1 || op.dir == Copy_dir::HostToDevice) ? 0 : 1;
+                engines[e].waiting.push_back(i);
+                continue;
+            }
+            auto k = std::make_unique<Kernel_run>();
+            k->op = i;
+            k->queue = q;
+            k->program = if_conversion
+                ? if_convert(op.program, if_conversion_max_instrs, &if_conversion_report)
+                : op.program;
+            k->bra_to_join = compute_bra_join_map(k->program);
+            k->first_tid = op.first_tid;
+            k->n_blocks = op.grid.count();
+            k->block_threads = op.block.count();
+            k->warps_per_block = (k->block_threads + W - 1) / W;
+            k->m.warp_width = W;
+            if (k->n_blocks == 0) { finish(i, q, cycle); continue; }
+            kernels.push_back(std::move(k));
+        }
+
+        // 3. idle copy engines start their next copy
+        for (Copy_engine& e : engines) {
+            if (e.busy || e.waiting.empty()) continue;
+            e.op = e.waiting.front();
+            e.waiting.pop_front();
+            e.busy = true;
+            e.end = cycle + copy_cycles(*flat[e.op].op);
+            rep.ops[e.op].start = cycle;   // queueing time is not copy time
+        }
+
+        // 4. block dispatch, one block per SM in turn
+        for (bool admitted = true; admitted;) {
+            admitted = false;
+            for (SM& sm : sms) admitted |= try_admit(sm);
+        }
+
+        // 5. one warp-instruction per SM
+        bool issued = false;
+        for (SM& sm : sms) {
+            if (sm.ready.empty()) continue;
+            issued = true;
+            const Entry e = sm.ready.front();
+            sm.ready.pop_front();
+            Kernel_run& k = *e.r->k;
+            step_warp(*e.w, k.program, k.bra_to_join, mem, k.m, false);
+
+            Block_state<W>* b = e.w->block;
+            if (e.w->halted) {
+                b->live_warps--;
+            } else if (e.w->at_barrier) {
+                b->parked.push_back(e.w);
+                b->parked_at.push_back(cycle);
+            } else {
+                sm.ready.push_back(e);
+                continue;
+            }
+
+            if (!b->parked.empty() && b->parked.size() == b->live_warps) {
+                for (size_t i = 0; i < b->parked.size(); i++) {
+                    b->parked[i]->at_barrier = false;
+                    k.m.barrier_stall_cycles += cycle - b->parked_at[i];
+                    sm.ready.push_back({b->parked[i], e.r});
+                }
+                b->parked.clear();
+                b->parked_at.clear();
+                k.m.barriers++;
+            }
+
+            if (b->live_warps == 0) {
+                sm.warps -= k.warps_per_block;
+                sm.resident.erase(std::find_if(sm.resident.begin(), sm.resident.end(),
+                    [&](const std::unique_ptr<Resident>& r) { return r.get() == e.r; }));
+                if (++k.blocks_done == k.n_blocks) {
+                    rep.ops[k.op].m = k.m;
+                    rep.total += k.m;
+                    finish(k.op, k.queue, cycle + 1);
+                    kernels.erase(std::find_if(kernels.begin(), kernels.end(),
+                        [&](const std::unique_ptr<Kernel_run>& p) { return p.get() == &k; }));
+                }
+            }
+        }
+
+        if (issued) { cycle++; continue; }
+
+        // nothing to issue : jump to the next copy completion
+        uint64_t next = UINT64_MAX;
+        for (const Copy_engine& e : engines)
+            if (e.busy) next = std::min(next, e.end);
+        if (next == UINT64_MAX) {
+            // a stream went idle this cycle : its next op starts right away
+            if (remaining == 0 || kernels.empty()) continue;
+            throw std::runtime_error("run_streams: no op can make progress");
+        }
+        cycle = std::max(next, cycle + 1);
+    }
+
+    return rep;
+}
+
+template <uint32_t W>
+Stream_report GPU_SimW<W>::run_streams(const std::vector<Stream>& streams, Buffer& mem,
+                                       const Device_config& dev) {
+    if (dev.n_sms == 0) throw std::invalid_argument("run_streams: n_sms must be at least 1");
+    if (dev.copy_engines != 1 && dev.copy_engines != 2)
+        throw std::invalid_argument("run_streams: copy_engines must be 1 or 2");
+    if (!(dev.copy_bytes_per_cycle > 0.0))
+        throw std::invalid_argument("run_streams: copy bandwidth must be positive");
+    for (const Stream& s : streams) {
+        for (const Stream_op& op : s.ops) {
+            if (op.kind == Stream_op::Kind::Copy) {
+                if (op.buf > 2) throw std::out_of_range("run_streams: copy to unknown buffer");
+                continue;
+            }
+            const uint32_t block_threads = op.block.count();
+            if (block_threads == 0) throw std::invalid_argument("run_streams: empty thread block");
+            if (dev.max_blocks_per_sm == 0 || (block_threads + W - 1) / W > dev.max_warps_per_sm)
+                throw std::invalid_argument("run_streams: a block does not fit the SM resident limits");
+        }
+    }
+
+    Stream_report serial;
+    {
+        Buffer scratch = mem;
+        serial = play_streams(streams, scratch, dev, true);
+    }
+    Stream_report rep = play_streams(streams, mem, dev, false);
+
+    // lower bound : no stream runs faster than its ops back to back, and no
+    // copy engine faster than its copies back to back
+    rep.serial_cycles = serial.cycles;
+    std::vector<uint64_t> engine_busy(dev.copy_engines, 0);
+    size_t i = 0;
+    for (size_t s = 0; s < streams.size(); s++) {
+        uint64_t stream_busy = 0;
+        for (const Stream_op& op : streams[s].ops) {
+            rep.ops[i].alone = serial.ops[i].end - serial.ops[i].start;
+            stream_busy += rep.ops[i].alone;
+            if (op.kind == Stream_op::Kind::Copy)
+                engine_busy[(dev.copy_engines == 1 || op.dir == Copy_dir::HostToDevice) ? 0 : 1] += rep.ops[i].alone;
+            i++;
+        }
+        rep.bound_cycles = std::max(rep.bound_cycles, stream_busy);
+    }
+    for (uint64_t busy : engine_busy) rep.bound_cycles = std::max(rep.bound_cycles, busy);
+
+    rep.overlap_efficiency = (rep.serial_cycles > rep.bound_cycles)
+        ? ((double)rep.serial_cycles - (double)rep.cycles) / (double)(rep.serial_cycles - rep.bound_cycles)
+        : 1.0;
+    return rep;
+}
+
+template Stream_report GPU_SimW<16>::run_streams(const std::vector<Stream>&, Buffer&, const Device_config&);
+template Stream_report GPU_SimW<32>::run_streams(const std::vector<Stream>&, Buffer&, const Device_config&);
+template Stream_report GPU_SimW<64>::run_streams(const std::vector<Stream>&, Buffer&, const Device_config&);
+template Stream_report GPU_SimW<16>::play_streams(const std::vector<Stream>&, Buffer&, const Device_config&, bool);
+template Stream_report GPU_SimW<32>::play_streams(const std::vector<Stream>&, Buffer&, const Device_config&, bool);
+template Stream_report GPU_SimW<64>::play_streams(const std::vector<Stream>&, Buffer&, const Device_config&, bool);
@@ -0,0 +1,81 @@
+#pragma once
+# include <cstdint>
+# include <string>
+# include <vector>
+# include "model.h"
+
+// ---------------- Streams ----------------
+// A Stream is an ordered queue of kernel launches and buffer copies. Ops of
+// one stream run one after another; ops of different streams may overlap.
+// GPU_Sim::run_streams plays all streams on one simulated device, cycle by
+// cycle : every SM issues one warp-instruction per cycle from any resident
+// warp of any running kernel, and copies occupy a copy engine for
+// latency + bytes / bandwidth cycles.
+
+enum class Copy_dir : uint8_t { HostToDevice, DeviceToHost };
+
+struct Stream_op {
+    enum class Kind : uint8_t { Kernel, Copy };
+    Kind kind = Kind::Kernel;
+    std::string name;
+
+    // Kernel : threads are numbered from first_tid, so kernels of several
+    // streams can each work on their own chunk of the buffers
+    std::vector<Instr> program;
+    Dim3 grid, block;
+    uint32_t first_tid = 0;
+
+    // Copy of words words at buf[offset], applied when the copy completes :
+    // HostToDevice writes data there (growing the buffer if needed),
+    // DeviceToHost reads them into *host
+    Copy_dir dir = Copy_dir::HostToDevice;
+    uint8_t buf = 0;
+    uint64_t offset = 0;
+    uint64_t words = 0;
+    std::vector<uint32_t> data;
+    std::vector<uint32_t>* host = nullptr;
+};
+
+class Stream {
+public:
+    explicit Stream(std::string name) : name(std::move(name)) {}
+
+    void launch(std::string op_name, std::vector<Instr> program, Dim3 grid, Dim3 block,
+                uint32_t first_tid = 0);
+    void copy_to_device(std::string op_name, std::vector<uint32_t> data, uint8_t buf,
+                        uint64_t offset = 0);
+    void copy_to_host(std::string op_name, uint8_t buf, uint64_t offset, uint64_t words,
+                      std::vector<uint32_t>& host);
+
+    std::string name;
+    std::vector<Stream_op> ops;
+};
+
+struct Device_config {
+    uint32_t n_sms = 4;
+    uint32_t max_blocks_per_sm = 8;
+    uint32_t max_warps_per_sm = 64;
+    double copy_bytes_per_cycle = 16.0;   // per copy engine
+    uint64_t copy_latency = 0;            // cycles added to every copy
+    uint32_t copy_engines = 2;            // 2 : one per direction, 1 : shared
+};
+
+struct Op_timing {
+    std::string stream, name;
+    bool kernel = false;
+    uint64_t start = 0, end = 0;          // cycles, end exclusive
+    uint64_t alone = 0;                   // cycles when run by itself
+    Metrics m;                            // kernels only
+};
+
+struct Stream_report {
+    std::vector<Op_timing> ops;           // in stream order
+    Metrics total;                        // all kernels
+    uint64_t cycles = 0;                  // makespan of the concurrent run
+    uint64_t serial_cycles = 0;           // every op alone, back to back
+    uint64_t bound_cycles = 0;            // longest stream or busiest copy engine, ops alone
+    // share of the possible overlap achieved : (serial - cycles) /
+    // (serial - bound), 1 when nothing could overlap, below 0 when sharing
+    // the SMs made the concurrent run slower than the serial one
+    double overlap_efficiency = 0.0;
+};
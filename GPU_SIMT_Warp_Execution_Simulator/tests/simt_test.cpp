@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "model.h"
+
+// Simulator behaviour checks (googletest). Programs are kept in this file so a
+// change to the sweep workloads in main_analysis does not move the expectations.
+
+namespace {
+
+// if (r0 < r1) r2 = r1 + r1 else r2 = r0 + r0; then, after the JOIN, every lane stores r2
+std::vector<Instr> diamond_then_store() {
+    return {
+        {Op::LD,     0,0,0, 0, 0},   // 0: r0 = buf0
+        {Op::LD,     1,0,0, 1, 0},   // 1: r1 = buf1
+        {Op::CMP_LT, 0,0,1, 0, 0},   // 2: pred = r0 < r1
+        {Op::BRA,    0,0,0, 0, 6},   // 3
+        {Op::VADD,   2,0,0, 0, 0},   // 4: else : r2 = r0 + r0
+        {Op::JMP,    0,0,0, 0, 7},   // 5
+        {Op::VADD,   2,1,1, 0, 0},   // 6: then : r2 = r1 + r1
+        {Op::JOIN,   0,0,0, 0, 0},   // 7
+        {Op::ST,     0,2,0, 2, 0},   // 8: buf2 = r2, both paths' lanes
+        {Op::HALT,   0,0,0, 0, 0},   // 9
+    };
+}
+
+// 48 threads : warp 0 splits 16 / 16, warp 1 (16 lanes) is uniformly taken
+Buffer diamond_buffers(uint32_t N) {
+    Buffer mem;
+    mem.buf0.resize(N);
+    mem.buf1.resize(N);
+    mem.buf2.assign(N, 0xDEADu);
+    for (uint32_t i = 0; i < N; i++) {
+        mem.buf0[i] = i;
+        mem.buf1[i] = (i < 16) ? 0 : 1000;
+    }
+    return mem;
+}
+
+// nested_div of main_analysis : outer diamond whose taken path holds an inner one
+std::vector<Instr> nested_div() {
+    return {
+        {Op::LD,     0,0,0, 0, 0},   // 0: r0 = buf0 (tid)
+        {Op::LD,     1,0,0, 1, 0},   // 1: r1 = buf1 (outer threshold)
+        {Op::LD,     2,0,0, 2, 0},   // 2: r2 = buf2 (inner threshold)
+        {Op::CMP_LT, 0,1,0, 0, 0},   // 3: pred1 = (r1 < r0)
+        {Op::BRA,    0,0,0, 0, 8},   // 4: outer taken -> pc=8
+        {Op::ST,     0,1,0, 2, 0},   // 5: outer else writes r1
+        {Op::JMP,    0,0,0, 0, 15},  // 6
+        {Op::JMP,    0,0,0, 0, 15},  // 7 padding
+        {Op::CMP_LT, 0,2,0, 0, 0},   // 8: pred2 = (r2 < r0)
+        {Op::BRA,    0,0,0, 0, 12},  // 9: inner taken -> pc=12
+        {Op::ST,     0,2,0, 2, 0},   // 10: inner else writes r2
+        {Op::JMP,    0,0,0, 0, 14},  // 11
+        {Op::ST,     0,0,0, 2, 0},   // 12: inner taken writes r0
+        {Op::JMP,    0,0,0, 0, 14},  // 13
+        {Op::JOIN,   0,0,0, 0, 0},   // 14: inner join
+        {Op::JOIN,   0,0,0, 0, 0},   // 15: outer join
+        {Op::HALT,   0,0,0, 0, 0}    // 16
+    };
+}
+
+// thresholds at an arbitrary lane per warp, so some warps split on both levels and some do not
+Buffer nested_buffers(uint32_t N, uint32_t seed) {
+    Buffer mem;
+    mem.buf0.resize(N);
+    mem.buf1.resize(N);
+    mem.buf2.resize(N);
+    uint32_t x = seed;
+    for (uint32_t tid = 0; tid < N; tid++) {
+        if (tid % 32 == 0) x = x * 1664525u + 1013904223u;
+        const uint32_t base = tid / 32 * 32;
+        mem.buf0[tid] = tid;
+        mem.buf1[tid] = base + (x >> 8) % 40;
+        mem.buf2[tid] = base + (x >> 16) % 40;
+    }
+    return mem;
+}
+
+} // namespace
+
+// Both paths run up to the JOIN, then every lane of the BRA continues past it
+TEST(SIMT_Reconvergence, JoinRestoresBranchMask) {
+    const uint32_t N = 48;
+    Buffer mem = diamond_buffers(N);
+    GPU_SimW<32> sim;
+    const Metrics m = sim.run(diamond_then_store(), mem, N);
+
+    for (uint32_t i = 0; i < N; i++) {
+        const uint32_t expect = (mem.buf0[i] < mem.buf1[i]) ? 2 * mem.buf1[i] : 2 * mem.buf0[i];
+        ASSERT_EQ(mem.buf2[i], expect) << "tid " << i;
+    }
+    EXPECT_EQ(m.divergent_branches, 1u);
+    EXPECT_EQ(m.reconverges, 1u);
+
+    // warp 0 : 4 x 32 up to the BRA, 16 lanes through VADD, JOIN (taken) and VADD, JMP, JOIN
+    // (deferred), 32 again for ST and HALT; warp 1 : 8 instructions on its 16 lanes
+    EXPECT_EQ(m.active_lane_cycles, 4u * 32 + 5u * 16 + 2u * 32 + 8u * 16);
+}
+
+// The native backend emits the same two-arrival JOIN
+TEST(SIMT_Reconvergence, NativeMatchesInterpreter) {
+    const uint32_t N = 48;
+    Buffer interp_mem = diamond_buffers(N), native_mem = diamond_buffers(N);
+    GPU_SimW<32> interp, native;
+    native.backend = Backend::Native;
+
+    const Metrics a = interp.run(diamond_then_store(), interp_mem, N);
+    const Metrics b = native.run(diamond_then_store(), native_mem, N);
+
+    EXPECT_EQ(native_mem.buf2, interp_mem.buf2);
+    EXPECT_EQ(b.warp_cycles, a.warp_cycles);
+    EXPECT_EQ(b.active_lane_cycles, a.active_lane_cycles);
+    EXPECT_EQ(b.reconverges, a.reconverges);
+}
+
+// The inner diamond is converted first; the outer one, whose taken path now holds the
+// inner CMP_LT / SEL, is converted in the next round with its compare issued again
+TEST(SIMT_IfConversion, NestedDiamondsFullyConverted) {
+    If_convert_report rep;
+    const std::vector<Instr> out = if_convert(nested_div(), 8, &rep);
+
+    EXPECT_EQ(rep.regions_converted, 2u);
+    EXPECT_EQ(rep.regions_left, 0u);
+    for (const Instr& ins : out) {
+        EXPECT_NE(ins.op, Op::BRA);
+        EXPECT_NE(ins.op, Op::JOIN);
+    }
+
+    const uint32_t N = 200;
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        Buffer branchy = nested_buffers(N, seed), predicated = nested_buffers(N, seed);
+        GPU_SimW<32> sim;
+        sim.run(nested_div(), branchy, N);
+        sim.if_conversion = true;
+        const Metrics m = sim.run(nested_div(), predicated, N);
+
+        ASSERT_EQ(predicated.buf2, branchy.buf2) << "seed " << seed;
+        EXPECT_EQ(m.divergent_branches, 0u);
+    }
+}